@@ -0,0 +1,72 @@
+#pragma once
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// flags
+#define BASE64_URL 0x01 // URL-safe alphabet ('-' and '_' instead of '+' and '/')
+#define BASE64_NO_PADDING 0x02 // no '=' padding for encoding
+
+size_t base64_get_encoded_length(const size_t input_sz, const int flags);
+// maximum decoded length
+size_t base64_get_decoded_length(const size_t buff_sz);
+
+// return processed input bytes or -1.
+// The last not full group is encoded only if whole input fits to buff
+long base64_stream_to_base64(const unsigned char* p_input,
+                             const size_t input_sz,
+                             char* buff,
+                             const size_t buff_sz,
+                             const int flags);
+// Padded and not padded data is decoded.
+// return processed input chars or -1 (for invalid char too, its offset is saved to perror_pos if it is set)
+long base64_stream_from_base64(const char* buff,
+                               const size_t buff_sz,
+                               unsigned char* p_output,
+                               const size_t output_sz,
+                               const int flags,
+                               size_t* perror_pos);
+
+// Stream context for input of any chunks size (with the same output as for whole input).
+// It keeps not full group of input for the next call
+typedef struct
+{
+    int flags;
+    unsigned char carry[4];
+    size_t carry_sz;
+    size_t position; // processed input for error offsets
+    BOOL finished; // padding is decoded
+} base64_stream_ctx_t;
+
+BOOL base64_stream_ctx_init(base64_stream_ctx_t* pctx, const int flags);
+
+// output size required for base64_stream_ctx_encode/base64_stream_ctx_decode with input_sz
+size_t base64_stream_ctx_get_encode_length(const base64_stream_ctx_t* pctx, const size_t input_sz);
+size_t base64_stream_ctx_get_decode_length(const base64_stream_ctx_t* pctx, const size_t input_sz);
+
+// whole input is processed. return written output bytes or -1
+long base64_stream_ctx_encode(base64_stream_ctx_t* pctx,
+                              const unsigned char* p_input,
+                              const size_t input_sz,
+                              char* buff,
+                              const size_t buff_sz);
+// return written output chars (up to 4) or -1
+long base64_stream_ctx_finish_encode(base64_stream_ctx_t* pctx, char* buff, const size_t buff_sz);
+
+// whole input is processed. return written output bytes or -1
+// (for invalid char too, its offset in stream is saved to perror_pos if it is set)
+long base64_stream_ctx_decode(base64_stream_ctx_t* pctx,
+                              const char* buff,
+                              const size_t buff_sz,
+                              unsigned char* p_output,
+                              const size_t output_sz,
+                              size_t* perror_pos);
+// return written output bytes (up to 2) or -1 (for incomplete input)
+long base64_stream_ctx_finish_decode(base64_stream_ctx_t* pctx, unsigned char* p_output, const size_t output_sz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,6 +3,7 @@
 #include "common.h"
 
 #include <stdint.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,14 +15,29 @@ typedef struct
     uint32_t S[4][256];
 } blowfish_ctx_t;
 
+// encrypt is int (not BOOL) to have the same layout for C and C++ code
+typedef struct
+{
+    blowfish_ctx_t* ctx;
+    int encrypt;
+    unsigned char carry[8]; // input tail that is not full block yet
+    size_t carry_sz;
+} blowfish_stream_ctx_t;
+
 BOOL blowfish_init(blowfish_ctx_t* ctx, uint8_t* key, int32_t keyLen);
 BOOL blowfish_encrypt_chunk(blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr);
 BOOL blowfish_decrypt_chunk(blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr);
 BOOL blowfish_destroy(blowfish_ctx_t* pctx);
 
+// Process blocks_n chunks at once. pblocks is array of (xl, xr) pairs in host byte order
+// (2 * blocks_n items). Results are the same as for blowfish_encrypt_chunk/blowfish_decrypt_chunk
+BOOL blowfish_encrypt_blocks(blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n);
+BOOL blowfish_decrypt_blocks(blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n);
+
 size_t blowfish_get_min_chunk_length(void);
 size_t blowfish_get_stream_output_length(size_t input_long);
 
+// Input and output can be the same buffer (in-place processing).
 // return processed input bytes or -1
 long blowfish_stream_encrypt(blowfish_ctx_t* ctx,
                              const unsigned char* p_input,
@@ -34,6 +50,132 @@ long blowfish_stream_decrypt(blowfish_ctx_t* ctx,
                              unsigned char* p_output,
                              const size_t output_sz);
 
+// Scatter/gather variants of blowfish_stream_encrypt/blowfish_stream_decrypt.
+// Fragments are processed as one contiguous buffer (blocks can straddle fragment bounds)
+// with the same result. Input and output can be the same iovec array (in-place processing).
+// return processed input bytes or -1
+long blowfish_stream_encryptv(blowfish_ctx_t* ctx,
+                              const struct iovec* p_input_iov,
+                              const size_t input_iov_n,
+                              const struct iovec* p_output_iov,
+                              const size_t output_iov_n);
+long blowfish_stream_decryptv(blowfish_ctx_t* ctx,
+                              const struct iovec* p_input_iov,
+                              const size_t input_iov_n,
+                              const struct iovec* p_output_iov,
+                              const size_t output_iov_n);
+
+// Job for blowfish_stream_encrypt/blowfish_stream_decrypt with own key
+typedef struct
+{
+    blowfish_ctx_t* ctx;
+    const unsigned char* p_input;
+    size_t input_sz;
+    unsigned char* p_output;
+    size_t output_sz;
+    long processed; // result: processed input bytes or -1
+} blowfish_stream_job_t;
+
+// Blocks of different jobs (keys) are processed together to hide memory latency.
+// Every job result is the same as for single stream call
+BOOL blowfish_stream_encrypt_batch(blowfish_stream_job_t* pjobs, const size_t jobs_n);
+BOOL blowfish_stream_decrypt_batch(blowfish_stream_job_t* pjobs, const size_t jobs_n);
+
+// CTR mode. Keystream block for 'offset' is encrypted counter (nonce + offset / 8),
+// where nonce is big-endian 64-bit number (blowfish_get_nonce_length bytes).
+// There is no padding (output size is equal to input size) and
+// any range of data can be processed independently by its 'offset' in the stream.
+// Input and output can be the same buffer
+
+size_t blowfish_get_nonce_length(void);
+
+// return processed input bytes or -1
+long blowfish_ctr_encrypt(blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const uint64_t offset,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz);
+long blowfish_ctr_decrypt(blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const uint64_t offset,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz);
+
+// Split data between threads_n threads (0 - by CPU number).
+// return processed input bytes or -1
+long blowfish_ctr_encrypt_mt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_nonce,
+                             const uint64_t offset,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             const size_t threads_n);
+long blowfish_ctr_decrypt_mt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_nonce,
+                             const uint64_t offset,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             const size_t threads_n);
+
+// CBC mode with big-endian blocks (compatible with other BF-CBC implementations).
+// p_iv (blowfish_get_min_chunk_length bytes) is updated by the last ciphertext block
+// to continue chain by the next call.
+// Encryption pads the tail by zeros like blowfish_stream_encrypt and
+// decryption processes full blocks only.
+// Input and output can be the same buffer
+
+// return processed input bytes or -1
+long blowfish_cbc_encrypt(blowfish_ctx_t* ctx,
+                          unsigned char* p_iv,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz);
+long blowfish_cbc_decrypt(blowfish_ctx_t* ctx,
+                          unsigned char* p_iv,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz);
+
+// Split decryption between threads_n threads (0 - by CPU number).
+// return processed input bytes or -1
+long blowfish_cbc_decrypt_mt(blowfish_ctx_t* ctx,
+                             unsigned char* p_iv,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             const size_t threads_n);
+
+// Stream context for input of any chunks size (with the same output as blowfish_stream_encrypt/
+// blowfish_stream_decrypt for whole input). It emits full blocks only and keeps the rest
+// of input for the next call. Padding is added by blowfish_stream_ctx_finish
+
+BOOL blowfish_stream_ctx_init(blowfish_stream_ctx_t* pstream, blowfish_ctx_t* ctx, const BOOL encrypt);
+BOOL blowfish_stream_ctx_destroy(blowfish_stream_ctx_t* pstream);
+
+// output size required for blowfish_stream_ctx_update with input_sz
+size_t blowfish_stream_ctx_get_output_length(const blowfish_stream_ctx_t* pstream, const size_t input_sz);
+
+// whole input is processed. return written output bytes or -1
+// Input and output can be the same buffer (in-place processing) if it fits
+// blowfish_stream_ctx_get_output_length bytes. Other overlapping is not allowed
+long blowfish_stream_ctx_update(blowfish_stream_ctx_t* pstream,
+                                const unsigned char* p_input,
+                                const size_t input_sz,
+                                unsigned char* p_output,
+                                const size_t output_sz);
+// return written output bytes (0 or 8 for padded block) or -1 (for incomplete ciphertext)
+long blowfish_stream_ctx_finish(blowfish_stream_ctx_t* pstream, unsigned char* p_output, const size_t output_sz);
+
 #ifdef __cplusplus
 }
 #endif
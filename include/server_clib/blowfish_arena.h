@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.h"
+#include "blowfish.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// context slots are aligned by cache line
+#define BLOWFISH_ARENA_ALIGN_SZ 64
+
+// Thread-safe pool of session contexts in one memory mapping (slab).
+// Pages are populated on first usage. Released contexts are zeroized
+// like blowfish_destroy does and are reused first
+typedef struct
+{
+    unsigned char* pmem;
+    size_t map_sz;
+    size_t slot_sz;
+    size_t capacity;
+    size_t used_n; // slots never used before have index >= used_n
+    uint32_t* pfree; // stack of released slot indexes
+    size_t free_n;
+    uint64_t* pbusy; // bitmap of allocated slots
+    size_t allocated_n; // changed under lock, read by atomic load
+    BOOL hugetlb; // mapping is made by explicit huge pages
+    pthread_mutex_t lock;
+} blowfish_arena_t;
+
+// If hugepages is set explicit huge pages are tried first and transparent huge pages
+// are advised otherwise
+BOOL blowfish_arena_init(blowfish_arena_t* parena, const size_t capacity, const BOOL hugepages);
+// all contexts are zeroized
+BOOL blowfish_arena_destroy(blowfish_arena_t* parena);
+
+// return zeroed context (for blowfish_init) or NULL if arena is full
+blowfish_ctx_t* blowfish_arena_alloc(blowfish_arena_t* parena);
+// context is zeroized and returned to arena
+BOOL blowfish_arena_free(blowfish_arena_t* parena, blowfish_ctx_t* ctx);
+
+size_t blowfish_arena_get_capacity(const blowfish_arena_t* parena);
+size_t blowfish_arena_get_allocated(const blowfish_arena_t* parena);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "common.h"
+#include "blowfish.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// blowfish_init uses only this number of key bytes
+#define BLOWFISH_CACHE_KEY_MAX_SZ 72
+// entries number with the same digest slot
+#define BLOWFISH_CACHE_WAYS_N 4
+
+typedef struct
+{
+    uint64_t digest;
+    uint64_t tick; // last usage
+    int32_t key_sz; // 0 for empty entry
+    uint8_t key[BLOWFISH_CACHE_KEY_MAX_SZ];
+    blowfish_ctx_t ctx;
+} blowfish_cache_entry_t;
+
+// Bounded thread-safe cache of expanded keys (set-associative with LRU replacement)
+typedef struct
+{
+    blowfish_cache_entry_t* pentries;
+    size_t sets_n;
+    uint64_t tick;
+    size_t hits;
+    size_t misses;
+    pthread_rwlock_t lock;
+} blowfish_cache_ctx_t;
+
+// capacity is rounded up to BLOWFISH_CACHE_WAYS_N
+BOOL blowfish_cache_init(blowfish_cache_ctx_t* pcache, const size_t capacity);
+// all cached keys are destroyed
+BOOL blowfish_cache_destroy(blowfish_cache_ctx_t* pcache);
+
+// Copy of expanded key to ctx. It is the same as blowfish_init(ctx, key, keyLen)
+// but key expansion is made only for keys that are not in cache
+BOOL blowfish_cache_get(blowfish_cache_ctx_t* pcache, blowfish_ctx_t* ctx, const uint8_t* key, const int32_t keyLen);
+
+size_t blowfish_cache_get_capacity(const blowfish_cache_ctx_t* pcache);
+size_t blowfish_cache_get_hits(const blowfish_cache_ctx_t* pcache);
+size_t blowfish_cache_get_misses(const blowfish_cache_ctx_t* pcache);
+
+#ifdef __cplusplus
+}
+#endif
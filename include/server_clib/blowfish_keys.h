@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+#include "blowfish.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary blob of expanded keys: header (BLOWFISH_KEYS_HEADER_SZ bytes) and array of blowfish_ctx_t
+// in host byte order. Array is aligned by header size so mapped file can be used as is
+
+#define BLOWFISH_KEYS_VERSION 1
+#define BLOWFISH_KEYS_HEADER_SZ 64
+
+typedef struct
+{
+    char magic[4]; // "BFKS"
+    uint16_t version;
+    uint16_t byte_order; // 0x0102 in writer byte order
+    uint32_t ctx_sz; // sizeof(blowfish_ctx_t)
+    uint32_t reserved;
+    uint64_t ctx_n;
+} blowfish_keys_header_t;
+
+size_t blowfish_keys_get_export_length(const size_t ctx_n);
+
+// return written bytes or -1
+long blowfish_keys_export(const blowfish_ctx_t* pctxs,
+                          const size_t ctx_n,
+                          unsigned char* p_output,
+                          const size_t output_sz);
+// Blob with foreign byte order is converted.
+// return imported contexts number or -1
+long blowfish_keys_import(const unsigned char* p_input,
+                          const size_t input_sz,
+                          blowfish_ctx_t* pctxs,
+                          const size_t ctx_n);
+
+// Contexts from blob without copying (input should be aligned and have host byte order).
+// return NULL for wrong blob
+const blowfish_ctx_t* blowfish_keys_view(const unsigned char* p_input, const size_t input_sz, size_t* pctx_n);
+
+typedef struct
+{
+    void* pmap;
+    size_t map_sz;
+    blowfish_ctx_t* pctxs; // copy-on-write mapped contexts
+    size_t ctx_n;
+} blowfish_keys_map_t;
+
+// File is created with owner only access (0600) and replaced atomically
+BOOL blowfish_keys_save(const char* path, const blowfish_ctx_t* pctxs, const size_t ctx_n);
+
+BOOL blowfish_keys_map(blowfish_keys_map_t* pmap, const char* path);
+BOOL blowfish_keys_unmap(blowfish_keys_map_t* pmap);
+
+#ifdef __cplusplus
+}
+#endif
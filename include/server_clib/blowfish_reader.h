@@ -0,0 +1,53 @@
+#pragma once
+
+#include "common.h"
+#include "blowfish.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// decrypted pages size for cache
+#define BLOWFISH_READER_PAGE_SZ 4096
+
+// Random access reader of mapped file with data encrypted by blowfish_ctr_encrypt
+// (from offset 0 of data that starts after data_offset bytes of file header).
+// Only requested ranges are decrypted. Reader with cache is not thread-safe
+typedef struct
+{
+    blowfish_ctx_t* ctx;
+    unsigned char nonce[8];
+    void* pmap;
+    size_t map_sz;
+    const unsigned char* pdata;
+    size_t data_sz;
+    unsigned char* pcache; // direct-mapped cache of decrypted pages
+    uint64_t* pcache_tags; // page index + 1 (0 for empty slot)
+    size_t cache_pages_n;
+    size_t hits;
+    size_t misses;
+} blowfish_reader_t;
+
+// cache_pages_n = 0 to decrypt every read from file
+BOOL blowfish_reader_open(blowfish_reader_t* preader,
+                          const char* path,
+                          blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const size_t data_offset,
+                          const size_t cache_pages_n);
+// cached plain text is zeroized
+BOOL blowfish_reader_close(blowfish_reader_t* preader);
+
+size_t blowfish_reader_get_length(const blowfish_reader_t* preader);
+
+// return read bytes (less than output_sz at the end of data) or -1
+long blowfish_reader_read(blowfish_reader_t* preader, const uint64_t offset, unsigned char* p_output, const size_t output_sz);
+
+size_t blowfish_reader_get_hits(const blowfish_reader_t* preader);
+size_t blowfish_reader_get_misses(const blowfish_reader_t* preader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHACHA20_KEY_SZ 32
+#define CHACHA20_NONCE_SZ 12
+#define CHACHA20_BLOCK_SZ 64
+
+// ChaCha20 (RFC 8439) with SSE2/AVX2 kernels selected at runtime
+typedef struct
+{
+    uint32_t state[16]; // constants, key, initial block counter, nonce
+    uint64_t position; // stream position for chacha20_stream_encrypt/chacha20_stream_decrypt
+} chacha20_ctx_t;
+
+BOOL chacha20_init(chacha20_ctx_t* ctx, const uint8_t* key, const uint8_t* p_nonce, const uint32_t counter);
+BOOL chacha20_destroy(chacha20_ctx_t* ctx);
+
+// Encryption and decryption are XOR with keystream starting from byte 'offset'.
+// There is no padding (output size is equal to input size). Input and output can be the same buffer.
+// Block counter is 32-bit, so keystream ends after (2^32 - initial counter) blocks (256 GB for 0)
+// and input reaching beyond it is rejected.
+// return processed input bytes or -1
+long chacha20_xor(const chacha20_ctx_t* ctx,
+                  const uint64_t offset,
+                  const unsigned char* p_input,
+                  const size_t input_sz,
+                  unsigned char* p_output,
+                  const size_t output_sz);
+
+// Continue from current stream position (input of any chunks size).
+// return processed input bytes or -1 (position is not changed then)
+long chacha20_stream_encrypt(chacha20_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz);
+long chacha20_stream_decrypt(chacha20_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CRC32 (gzip/zlib compatible) and CRC32C (Castagnoli, iSCSI/ext4).
+// Checksums are incremental: pass 0 for the first chunk and the previous result for the next ones
+// (as for zlib crc32()), so it can be calculated alongside zip_stream_* and blowfish_stream_* calls.
+// Vectorized versions (PCLMULQDQ for CRC32 and SSE4.2 crc32 for CRC32C) are selected at runtime.
+
+uint32_t checksum_crc32(const uint32_t crc, const void* p_input, const size_t input_sz);
+uint32_t checksum_crc32c(const uint32_t crc, const void* p_input, const size_t input_sz);
+
+// Checksum of joined chunks A and B from their checksums and length of B
+// (for chunks processed in parallel)
+uint32_t checksum_crc32_combine(const uint32_t crc_a, const uint32_t crc_b, const uint64_t b_sz);
+uint32_t checksum_crc32c_combine(const uint32_t crc_a, const uint32_t crc_b, const uint64_t b_sz);
+
+#ifdef __cplusplus
+}
+#endif
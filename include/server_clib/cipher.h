@@ -0,0 +1,78 @@
+#pragma once
+
+#include "common.h"
+#include "blowfish.h"
+#include "chacha20.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    CIPHER_BLOWFISH = 0, // blowfish_stream_encrypt/blowfish_stream_decrypt
+    CIPHER_CHACHA20, // chacha20_stream_encrypt/chacha20_stream_decrypt
+} cipher_type_t;
+
+// Stream functions of cipher implementation
+typedef struct
+{
+    const char* name;
+    size_t (*get_output_length)(const size_t input_sz);
+    long (*encrypt)(void* pimpl,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz);
+    long (*decrypt)(void* pimpl,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz);
+    BOOL (*destroy)(void* pimpl);
+} cipher_vtable_t;
+
+typedef struct
+{
+    const cipher_vtable_t* pvtable;
+    union
+    {
+        blowfish_ctx_t blowfish;
+        chacha20_ctx_t chacha20;
+    } impl;
+} cipher_ctx_t;
+
+// Key is any (up to 72 bytes are used) for blowfish and CHACHA20_KEY_SZ bytes for chacha20.
+// Nonce is CHACHA20_NONCE_SZ bytes for chacha20 (it is ignored for blowfish)
+BOOL cipher_init(cipher_ctx_t* pctx,
+                 const cipher_type_t type,
+                 const uint8_t* key,
+                 const size_t key_sz,
+                 const uint8_t* p_nonce);
+BOOL cipher_destroy(cipher_ctx_t* pctx);
+
+// "blowfish" or "chacha20" (for configuration)
+BOOL cipher_get_type_by_name(const char* name, cipher_type_t* ptype);
+const char* cipher_get_name(const cipher_ctx_t* pctx);
+
+size_t cipher_get_output_length(const cipher_ctx_t* pctx, const size_t input_sz);
+
+// Stream cipher (chacha20) keeps position between calls,
+// so encryption and decryption require different contexts.
+// return processed input bytes or -1
+long cipher_encrypt(cipher_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz);
+long cipher_decrypt(cipher_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz);
+
+#ifdef __cplusplus
+}
+#endif
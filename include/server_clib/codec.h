@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common.h"
+#include "lz.h"
+#include "zip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    CODEC_NONE = 0, // stored data (it is used by frames for incompressible input)
+    CODEC_ZLIB, // zip_ctx_pack_best_speed/zip_ctx_unpack (ZLIB format)
+    CODEC_LZ, // lz_pack/lz_unpack
+    CODEC_TYPES_N
+} codec_type_t;
+
+// Block functions of codec implementation. Unpacked size should be known by caller
+// (it is kept in frame header)
+typedef struct
+{
+    const char* name;
+    size_t (*get_bound)(const size_t input_sz);
+    long (*pack)(void* pimpl,
+                 const unsigned char* p_input,
+                 const size_t input_sz,
+                 unsigned char* p_output,
+                 const size_t output_sz);
+    long (*unpack)(void* pimpl,
+                   const unsigned char* p_input,
+                   const size_t input_sz,
+                   unsigned char* p_output,
+                   const size_t output_sz);
+    BOOL (*destroy)(void* pimpl);
+} codec_vtable_t;
+
+// Codec state is reused by all calls (one context per stream or per thread).
+// Context is not thread-safe
+typedef struct
+{
+    const codec_vtable_t* pvtable;
+    codec_type_t type;
+    union
+    {
+        zip_ctx_t zip;
+        lz_ctx_t lz;
+    } impl;
+} codec_ctx_t;
+
+BOOL codec_init(codec_ctx_t* pctx, const codec_type_t type);
+BOOL codec_destroy(codec_ctx_t* pctx);
+
+// "none", "zlib" or "lz" (for configuration)
+BOOL codec_get_type_by_name(const char* name, codec_type_t* ptype);
+const char* codec_get_name(const codec_ctx_t* pctx);
+
+size_t codec_get_bound(const codec_ctx_t* pctx, const size_t input_sz);
+
+// Raw block without header.
+// return packed size (unpacked size) or -1
+long codec_pack(codec_ctx_t* pctx,
+                const unsigned char* p_input,
+                const size_t input_sz,
+                unsigned char* p_output,
+                const size_t output_sz);
+long codec_unpack(codec_ctx_t* pctx,
+                  const unsigned char* p_input,
+                  const size_t input_sz,
+                  unsigned char* p_output,
+                  const size_t output_sz);
+
+// Frame is "SC" magic, codec type byte, reserved (zero) byte, unpacked and packed sizes
+// (32-bit LE) and packed block. Frames are self-described, so messages (or chunks of stream)
+// packed by different codecs are unpacked by the same call.
+// Input is stored (CODEC_NONE) if codec does not reduce its size. Frame input is up to 4 GB
+#define CODEC_FRAME_HEADER_SZ 12
+
+size_t codec_frame_get_bound(const codec_ctx_t* pctx, const size_t input_sz);
+
+// return frame size or -1
+long codec_frame_pack(codec_ctx_t* pctx,
+                      const unsigned char* p_input,
+                      const size_t input_sz,
+                      unsigned char* p_output,
+                      const size_t output_sz);
+
+// Parse frame header at the start of input (pointers can be NULL).
+// Input can be partial: it is enough to have the header
+BOOL codec_frame_get_info(const unsigned char* p_input,
+                          const size_t input_sz,
+                          codec_type_t* ptype,
+                          size_t* punpacked_sz,
+                          size_t* pframe_sz);
+
+// Context is used if it has the codec of frame, otherwise (or for NULL) temporary state is used.
+// Input can have next frames after the first one (see codec_frame_get_info for frame size).
+// return unpacked size or -1
+long codec_frame_unpack(codec_ctx_t* pctx,
+                        const unsigned char* p_input,
+                        const size_t input_sz,
+                        unsigned char* p_output,
+                        const size_t output_sz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fast seeded 64-bit non-cryptographic hash (wyhash-like: 128-bit multiply folding).
+// It is for hash tables, caches and sharding, not for untrusted input where collisions must be hard to find
+uint64_t hash64(const void* p_input, const size_t input_sz, const uint64_t seed);
+
+// Stream context for input of any chunks size (with the same result as hash64 for whole input)
+typedef struct
+{
+    uint64_t seed;
+    uint64_t see1;
+    uint64_t see2;
+    uint64_t total_sz;
+    uint8_t buff[64]; // last 16 processed bytes and not processed ones
+    size_t buff_sz;
+} hash64_stream_ctx_t;
+
+BOOL hash64_stream_init(hash64_stream_ctx_t* pctx, const uint64_t seed);
+BOOL hash64_stream_update(hash64_stream_ctx_t* pctx, const void* p_input, const size_t input_sz);
+// context is not changed, so update can be continued
+uint64_t hash64_stream_final(const hash64_stream_ctx_t* pctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "common.h"
+#include "rubber.h"
+
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,8 +11,48 @@ extern "C" {
 
 // return processed input bytes or -1
 long hex_stream_to_hex(const unsigned char* p_input, const size_t input_sz, char* buff, const size_t buff_sz);
+// invalid chars are decoded as 0
 long hex_stream_from_hex(const char* buff, const size_t buff_sz, unsigned char* p_output, const size_t output_sz);
 
+// return processed input chars or -1 (for invalid char too, its offset is saved to perror_pos if it is set)
+long hex_stream_from_hex_strict(const char* buff,
+                                const size_t buff_sz,
+                                unsigned char* p_output,
+                                const size_t output_sz,
+                                size_t* perror_pos);
+
+// Stream context to decode input of any chunks size. Odd char is kept for the next call
+// Flags are int (not BOOL) to have the same layout for C and C++ code
+typedef struct
+{
+    int strict;
+    int has_carry;
+    char carry;
+    size_t position; // processed input for error offsets
+} hex_stream_ctx_t;
+
+// strict - to stop on invalid char like hex_stream_from_hex_strict (not to decode it as 0)
+BOOL hex_stream_ctx_init(hex_stream_ctx_t* pctx, const BOOL strict);
+
+// output size required for hex_stream_ctx_from_hex with buff_sz
+size_t hex_stream_ctx_get_output_length(const hex_stream_ctx_t* pctx, const size_t buff_sz);
+
+// whole input is processed. return written output bytes or -1
+// (for invalid char in strict mode too, its offset in stream is saved to perror_pos if it is set)
+long hex_stream_ctx_from_hex(hex_stream_ctx_t* pctx,
+                             const char* buff,
+                             const size_t buff_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             size_t* perror_pos);
+// return false for kept odd char
+BOOL hex_stream_ctx_finish(hex_stream_ctx_t* pctx);
+
+// Format like 'hexdump -C' (offset, 16 bytes rows, ASCII column, the last line with data size)
+// without squeezing of repeated rows. Offsets start from 'offset'.
+// Text is appended to rubber with terminating '\0'. return written chars (without '\0') or -1
+long hex_dump(const unsigned char* p_input, const size_t input_sz, const uint64_t offset, rubber_ctx_t* prubber);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fast byte-oriented LZ77 codec (LZ4 block format): sequences of literals and matches
+// with 64K window, no entropy coding. It packs 3-5 times faster than zlib best speed
+// and unpacks at memory copy speed, the ratio is lower than zlib.
+// Block is independent, its unpacked size is kept by caller (see codec_frame_*)
+
+#define LZ_HASH_BITS 12
+
+// Match finder state (16 KB), it is reset by every pack call
+typedef struct
+{
+    uint32_t table[1 << LZ_HASH_BITS];
+} lz_ctx_t;
+
+// Upper bound of packed size (incompressible input)
+size_t lz_get_bound(const size_t input_sz);
+
+// return packed size or -1 (output is too small)
+long lz_pack(lz_ctx_t* pctx,
+             const unsigned char* p_input,
+             const size_t input_sz,
+             unsigned char* p_output,
+             const size_t output_sz);
+// Input is checked, invalid data never reads/writes out of buffers.
+// return unpacked size or -1 (invalid data or output is too small)
+long lz_unpack(const unsigned char* p_input, const size_t input_sz, unsigned char* p_output, const size_t output_sz);
+
+#ifdef __cplusplus
+}
+#endif
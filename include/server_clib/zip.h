@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include "rubber.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,117 @@ BOOL zip_unpack(const unsigned char* p_input,
                 size_t* output_sz,
                 const BOOL allocate_buffer);
 
+// The same with preset dictionary (see zip_build_dictionary). Data packed with dictionary
+// is unpacked only with the same dictionary
+BOOL zip_pack_best_speed_with_dictionary(const unsigned char* p_input,
+                                         const size_t input_sz,
+                                         unsigned char** p_output,
+                                         size_t* output_sz,
+                                         const BOOL allocate_buffer,
+                                         const unsigned char* p_dict,
+                                         const size_t dict_sz);
+BOOL zip_pack_best_size_with_dictionary(const unsigned char* p_input,
+                                        const size_t input_sz,
+                                        unsigned char** p_output,
+                                        size_t* output_sz,
+                                        const BOOL allocate_buffer,
+                                        const unsigned char* p_dict,
+                                        const size_t dict_sz);
+BOOL zip_unpack_with_dictionary(const unsigned char* p_input,
+                                const size_t input_sz,
+                                unsigned char** p_output,
+                                size_t* output_sz,
+                                const BOOL allocate_buffer,
+                                const unsigned char* p_dict,
+                                const size_t dict_sz);
+
+// Window size of deflate (the longest useful dictionary)
+#define ZIP_DICTIONARY_MAX_SZ (32 * 1024)
+
+// Build dictionary from samples of typical messages: substrings shared by the most samples
+// with the most useful ones at the end (the shortest distances).
+// return dictionary size (up to dict_sz) or 0
+size_t zip_build_dictionary(const unsigned char* const* pp_samples,
+                            const size_t* p_samples_sz,
+                            const size_t samples_n,
+                            unsigned char* p_dict,
+                            const size_t dict_sz);
+
+// Reusable zlib states for many small buffers (the same output as for functions above).
+// States are allocated at the first pack/unpack and only reset for the next ones.
+// Context is not thread-safe
+typedef struct
+{
+    void* pdeflate;
+    void* pinflate;
+    int level; // current level of pdeflate
+    const unsigned char* p_dict;
+    size_t dict_sz;
+} zip_ctx_t;
+
+BOOL zip_ctx_init(zip_ctx_t* pctx);
+BOOL zip_ctx_destroy(zip_ctx_t* pctx);
+// Preset dictionary for next pack/unpack calls (NULL to reset). It is not copied
+BOOL zip_ctx_set_dictionary(zip_ctx_t* pctx, const unsigned char* p_dict, const size_t dict_sz);
+
+BOOL zip_ctx_pack_best_speed(zip_ctx_t* pctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char** p_output,
+                             size_t* output_sz,
+                             const BOOL allocate_buffer);
+BOOL zip_ctx_pack_best_size(zip_ctx_t* pctx,
+                            const unsigned char* p_input,
+                            const size_t input_sz,
+                            unsigned char** p_output,
+                            size_t* output_sz,
+                            const BOOL allocate_buffer);
+BOOL zip_ctx_unpack(zip_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char** p_output,
+                    size_t* output_sz,
+                    const BOOL allocate_buffer);
+
+// The same with context of calling thread (it is kept until thread exit or zip_tls_release)
+BOOL zip_pack_best_speed_tls(const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char** p_output,
+                             size_t* output_sz,
+                             const BOOL allocate_buffer);
+BOOL zip_pack_best_size_tls(const unsigned char* p_input,
+                            const size_t input_sz,
+                            unsigned char** p_output,
+                            size_t* output_sz,
+                            const BOOL allocate_buffer);
+BOOL zip_unpack_tls(const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char** p_output,
+                    size_t* output_sz,
+                    const BOOL allocate_buffer);
+// free context of calling thread
+void zip_tls_release(void);
+
+// Pack/unpack to the end of rubber buffer (raw data mode, string_mode is not supported).
+// Unpacked size is not required: buffer grows geometrically and data is unpacked in one pass.
+// return bytes number added to rubber or -1 (part of output can be added for invalid data)
+long zip_pack_best_speed_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber);
+long zip_pack_best_size_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber);
+long zip_unpack_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber);
+
+long zip_ctx_pack_best_speed_to_rubber(zip_ctx_t* pctx,
+                                       const unsigned char* p_input,
+                                       const size_t input_sz,
+                                       rubber_ctx_t* prubber);
+long zip_ctx_pack_best_size_to_rubber(zip_ctx_t* pctx,
+                                      const unsigned char* p_input,
+                                      const size_t input_sz,
+                                      rubber_ctx_t* prubber);
+long zip_ctx_unpack_to_rubber(zip_ctx_t* pctx,
+                              const unsigned char* p_input,
+                              const size_t input_sz,
+                              rubber_ctx_t* prubber);
+
 #ifdef __cplusplus
 }
 #endif
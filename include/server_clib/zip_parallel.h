@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "rubber.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default block for parallel packing. Each block is packed with 32 KB of previous data as dictionary
+#define ZIP_PARALLEL_BLOCK_SZ (128 * 1024)
+
+// Pack buffer to a single GZIP member by blocks on up to threads_n threads (0 - by CPU number).
+// Blocks are joined by sync flush points, checksum is combined from checksums of blocks.
+// level is zlib level (0 - stored, 1 - best speed .. 9 - best size), block_sz 0 is for ZIP_PARALLEL_BLOCK_SZ.
+// return bytes number added to rubber (raw data mode) or -1
+long zip_parallel_pack_to_rubber(const unsigned char* p_input,
+                                 const size_t input_sz,
+                                 const int level,
+                                 const size_t block_sz,
+                                 const size_t threads_n,
+                                 rubber_ctx_t* prubber);
+
+// Unpack concatenated GZIP members on up to threads_n threads (0 - by CPU number).
+// Member boundaries are found by header signature. Candidates from the current end of the members chain
+// are unpacked concurrently by window of 2 * threads_n ones, the output is joined in members order.
+// Threads are started once per call and take the next candidate while the chain end is unpacked.
+// Candidates found to be off the chain are cancelled. The whole input should be valid GZIP members.
+// return bytes number added to rubber (raw data mode) or -1
+long zip_parallel_unpack_to_rubber(const unsigned char* p_input,
+                                   const size_t input_sz,
+                                   const size_t threads_n,
+                                   rubber_ctx_t* prubber);
+
+#ifdef __cplusplus
+}
+#endif
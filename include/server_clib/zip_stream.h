@@ -14,12 +14,54 @@ typedef struct
 {
     unsigned char z_stream[ZIP_STREAM_PREDICTED_ZLIB_CTX_SIZE];
     void* pz_stream;
+    const unsigned char* p_dict; // dictionary for unpacking
+    size_t dict_sz;
 } zip_stream_ctx_t;
 
+// Allocator for zlib state (window and hash tables). Signatures are the same as zlib alloc_func/free_func.
+// Pack state is allocated by init, unpack window is allocated at the first unpacked chunk.
+// alloc_f returns NULL for failure
+typedef struct
+{
+    void* (*alloc_f)(void* opaque, unsigned int items_n, unsigned int item_sz);
+    void (*free_f)(void* opaque, void* p);
+    void* opaque;
+} zip_allocator_t;
+
+// Upper bounds of zlib state size for streams below (memory for zip_fixed_memory_t)
+#define ZIP_STREAM_PACK_MEMORY_SZ (320 * 1024)
+#define ZIP_STREAM_UNPACK_MEMORY_SZ (48 * 1024)
+
+// Allocator from caller memory block (bump allocation). Memory is reused after all allocated
+// blocks are freed (stream is destroyed). It is not thread-safe, so one block is for one stream
+typedef struct
+{
+    unsigned char* pmem;
+    size_t mem_sz;
+    size_t used_sz;
+    size_t allocated_n;
+} zip_fixed_memory_t;
+
+BOOL zip_fixed_memory_init(zip_fixed_memory_t* pmemory, void* pmem, const size_t mem_sz);
+BOOL zip_fixed_memory_get_allocator(zip_fixed_memory_t* pmemory, zip_allocator_t* pallocator);
+
 // Pack/unpack stream buffer to GZIP format
 
 BOOL zip_stream_pack_init(zip_stream_ctx_t* pctx);
 BOOL zip_stream_unpack_init(zip_stream_ctx_t* pctx);
+// allocator (copied to context) is used until stream destroy
+BOOL zip_stream_pack_init_with_allocator(zip_stream_ctx_t* pctx, const zip_allocator_t* pallocator);
+BOOL zip_stream_unpack_init_with_allocator(zip_stream_ctx_t* pctx, const zip_allocator_t* pallocator);
+// Preset dictionary streams are in ZLIB format (GZIP format does not support dictionary).
+// Dictionary is not copied and it should be valid until destroy, pallocator can be NULL
+BOOL zip_stream_pack_init_with_dictionary(zip_stream_ctx_t* pctx,
+                                          const unsigned char* p_dict,
+                                          const size_t dict_sz,
+                                          const zip_allocator_t* pallocator);
+BOOL zip_stream_unpack_init_with_dictionary(zip_stream_ctx_t* pctx,
+                                            const unsigned char* p_dict,
+                                            const size_t dict_sz,
+                                            const zip_allocator_t* pallocator);
 BOOL zip_stream_pack_destroy(zip_stream_ctx_t* pctx);
 BOOL zip_stream_unpack_destroy(zip_stream_ctx_t* pctx);
 
@@ -0,0 +1,400 @@
+#include <server_clib/base64.h>
+
+#include "priv_base64.h"
+#include "priv_cpu.h"
+
+#include <stdint.h>
+
+static const char base64_abc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64url_abc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+size_t base64_get_encoded_length(const size_t input_sz, const int flags)
+{
+    size_t rest = input_sz % 3;
+    if (flags & BASE64_NO_PADDING)
+        return 4 * (input_sz / 3) + (rest ? rest + 1 : 0);
+    return 4 * ((input_sz + 2) / 3);
+}
+
+size_t base64_get_decoded_length(const size_t buff_sz)
+{
+    size_t rest = buff_sz % 4;
+    return 3 * (buff_sz / 4) + (rest > 1 ? rest - 1 : 0);
+}
+
+static void encode_groups(const unsigned char* p_input, const size_t groups_n, char* buff, const int flags)
+{
+    const BOOL url = (flags & BASE64_URL) != 0;
+    const char* abc = url ? base64url_abc : base64_abc;
+
+    size_t g = 0;
+    if (groups_n >= 10 && cpu_is_supported(CPU_FEATURE_AVX2))
+        g = base64_avx2_encode(p_input, groups_n, buff, url);
+    if (groups_n - g >= 6 && cpu_is_supported(CPU_FEATURE_SSSE3))
+        g += base64_ssse3_encode(p_input + 3 * g, groups_n - g, buff + 4 * g, url);
+
+    for (; g < groups_n; ++g)
+    {
+        const unsigned char* in = p_input + 3 * g;
+        char* out = buff + 4 * g;
+        out[0] = abc[in[0] >> 2];
+        out[1] = abc[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+        out[2] = abc[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+        out[3] = abc[in[2] & 0x3f];
+    }
+}
+
+// not full group of rest_sz (1 or 2) bytes. return written chars
+static size_t encode_tail(const unsigned char* p_input, const size_t rest_sz, char* buff, const int flags)
+{
+    const char* abc = (flags & BASE64_URL) ? base64url_abc : base64_abc;
+
+    unsigned char in1 = (rest_sz > 1) ? p_input[1] : 0;
+    buff[0] = abc[p_input[0] >> 2];
+    buff[1] = abc[((p_input[0] & 0x03) << 4) | (in1 >> 4)];
+    if (rest_sz > 1)
+        buff[2] = abc[(in1 & 0x0f) << 2];
+
+    if (flags & BASE64_NO_PADDING)
+        return rest_sz + 1;
+
+    if (rest_sz < 2)
+        buff[2] = '=';
+    buff[3] = '=';
+    return 4;
+}
+
+static int char_from_base64(const char c, const BOOL url)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == (url ? '-' : '+'))
+        return 62;
+    if (c == (url ? '_' : '/'))
+        return 63;
+    return -1;
+}
+
+// Decode 2-4 chars (without padding) of one group. return decoded bytes or -1 (invalid char offset is saved)
+static long decode_group(const char* buff, const size_t chars_n, unsigned char* p_output, const BOOL url, size_t* perror_pos)
+{
+    int values[4] = { 0, 0, 0, 0 };
+    for (size_t ci = 0; ci < chars_n; ++ci)
+    {
+        values[ci] = char_from_base64(buff[ci], url);
+        if (values[ci] < 0)
+        {
+            *perror_pos = ci;
+            return -1;
+        }
+    }
+
+    uint32_t word = ((uint32_t)values[0] << 18) | ((uint32_t)values[1] << 12) | ((uint32_t)values[2] << 6)
+                    | (uint32_t)values[3];
+    p_output[0] = (unsigned char)(word >> 16);
+    if (chars_n > 2)
+        p_output[1] = (unsigned char)(word >> 8);
+    if (chars_n > 3)
+        p_output[2] = (unsigned char)word;
+    return (long)chars_n - 1;
+}
+
+// Decode whole groups. The last one can be padded (*ppadded is set).
+// return decoded bytes or -1 (invalid char offset is saved)
+static long decode_groups(const char* buff,
+                          const size_t groups_n,
+                          unsigned char* p_output,
+                          const int flags,
+                          size_t* perror_pos,
+                          BOOL* ppadded)
+{
+    const BOOL url = (flags & BASE64_URL) != 0;
+
+    *ppadded = false;
+
+    // vectorized kernels stop before invalid char or padding
+    size_t g = 0;
+    if (groups_n >= 12 && cpu_is_supported(CPU_FEATURE_AVX2))
+        g = base64_avx2_decode(buff, groups_n, p_output, url);
+    if (groups_n - g >= 7 && cpu_is_supported(CPU_FEATURE_SSSE3))
+        g += base64_ssse3_decode(buff + 4 * g, groups_n - g, p_output + 3 * g, url);
+
+    size_t decoded = 3 * g;
+    for (; g < groups_n; ++g)
+    {
+        const char* in = buff + 4 * g;
+
+        // "xx==" or "xxx=" for the last group only
+        size_t chars_n = 4;
+        if (in[3] == '=')
+            chars_n = (in[2] == '=') ? 2 : 3;
+        if (chars_n < 4 && g + 1 < groups_n)
+        {
+            *perror_pos = 4 * g + chars_n;
+            return -1;
+        }
+
+        size_t error_pos = 0;
+        long r = decode_group(in, chars_n, p_output + decoded, url, &error_pos);
+        if (r < 0)
+        {
+            *perror_pos = 4 * g + error_pos;
+            return -1;
+        }
+        decoded += (size_t)r;
+        *ppadded = chars_n < 4;
+    }
+
+    return (long)decoded;
+}
+
+long base64_stream_to_base64(const unsigned char* p_input,
+                             const size_t input_sz,
+                             char* buff,
+                             const size_t buff_sz,
+                             const int flags)
+{
+    if (!p_input || !input_sz || !buff || !buff_sz)
+        return -1;
+
+    size_t groups_n = SRV_C_MIN(input_sz / 3, buff_sz / 4);
+    encode_groups(p_input, groups_n, buff, flags);
+
+    size_t processed = 3 * groups_n;
+    size_t written = 4 * groups_n;
+
+    size_t rest_sz = input_sz - processed;
+    if (rest_sz && rest_sz < 3 && buff_sz - written >= ((flags & BASE64_NO_PADDING) ? rest_sz + 1 : 4))
+    {
+        written += encode_tail(p_input + processed, rest_sz, buff + written, flags);
+        processed = input_sz;
+    }
+
+    // terminator only for whole input
+    if (processed == input_sz && written < buff_sz)
+        buff[written] = 0;
+
+    return (long)processed;
+}
+
+long base64_stream_from_base64(const char* buff,
+                               const size_t buff_sz,
+                               unsigned char* p_output,
+                               const size_t output_sz,
+                               const int flags,
+                               size_t* perror_pos)
+{
+    if (!buff || !buff_sz || !p_output || !output_sz)
+        return -1;
+
+    size_t error_pos = 0;
+    if (!perror_pos)
+        perror_pos = &error_pos;
+
+    size_t groups_n = SRV_C_MIN(buff_sz / 4, output_sz / 3);
+    BOOL padded = false;
+    long decoded = decode_groups(buff, groups_n, p_output, flags, perror_pos, &padded);
+    if (decoded < 0)
+        return -1;
+
+    size_t processed = 4 * groups_n;
+    if (padded)
+    {
+        // nothing is allowed after padding
+        if (processed < buff_sz)
+        {
+            *perror_pos = processed;
+            return -1;
+        }
+        return (long)processed;
+    }
+
+    // not padded tail
+    size_t rest_sz = buff_sz - processed;
+    if (rest_sz > 1 && rest_sz < 4 && output_sz - (size_t)decoded >= rest_sz - 1)
+    {
+        if (decode_group(buff + processed, rest_sz, p_output + decoded, (flags & BASE64_URL) != 0, &error_pos) < 0)
+        {
+            *perror_pos = processed + error_pos;
+            return -1;
+        }
+        processed = buff_sz;
+    }
+
+    return (long)processed;
+}
+
+BOOL base64_stream_ctx_init(base64_stream_ctx_t* pctx, const int flags)
+{
+    if (!pctx)
+        return false;
+
+    bzero(pctx, sizeof(base64_stream_ctx_t));
+    pctx->flags = flags;
+    return true;
+}
+
+size_t base64_stream_ctx_get_encode_length(const base64_stream_ctx_t* pctx, const size_t input_sz)
+{
+    if (!pctx)
+        return 0;
+    return 4 * ((pctx->carry_sz + input_sz) / 3);
+}
+
+size_t base64_stream_ctx_get_decode_length(const base64_stream_ctx_t* pctx, const size_t input_sz)
+{
+    if (!pctx)
+        return 0;
+    return 3 * ((pctx->carry_sz + input_sz) / 4);
+}
+
+long base64_stream_ctx_encode(base64_stream_ctx_t* pctx,
+                              const unsigned char* p_input,
+                              const size_t input_sz,
+                              char* buff,
+                              const size_t buff_sz)
+{
+    if (!pctx || (!p_input && input_sz) || (!buff && buff_sz))
+        return -1;
+
+    if (buff_sz < base64_stream_ctx_get_encode_length(pctx, input_sz))
+        return -1;
+
+    size_t pos = 0;
+    size_t written = 0;
+
+    if (pctx->carry_sz)
+    {
+        for (; pctx->carry_sz < 3 && pos < input_sz; ++pos)
+            pctx->carry[pctx->carry_sz++] = p_input[pos];
+        if (pctx->carry_sz < 3)
+            return 0;
+
+        encode_groups(pctx->carry, 1, buff, pctx->flags);
+        written = 4;
+        pctx->carry_sz = 0;
+    }
+
+    size_t groups_n = (input_sz - pos) / 3;
+    encode_groups(p_input + pos, groups_n, buff + written, pctx->flags);
+    pos += 3 * groups_n;
+    written += 4 * groups_n;
+
+    memcpy(pctx->carry, p_input + pos, input_sz - pos);
+    pctx->carry_sz = input_sz - pos;
+
+    return (long)written;
+}
+
+long base64_stream_ctx_finish_encode(base64_stream_ctx_t* pctx, char* buff, const size_t buff_sz)
+{
+    if (!pctx)
+        return -1;
+
+    if (!pctx->carry_sz)
+        return 0;
+
+    if (!buff || buff_sz < ((pctx->flags & BASE64_NO_PADDING) ? pctx->carry_sz + 1 : 4))
+        return -1;
+
+    size_t written = encode_tail(pctx->carry, pctx->carry_sz, buff, pctx->flags);
+    pctx->carry_sz = 0;
+    return (long)written;
+}
+
+long base64_stream_ctx_decode(base64_stream_ctx_t* pctx,
+                              const char* buff,
+                              const size_t buff_sz,
+                              unsigned char* p_output,
+                              const size_t output_sz,
+                              size_t* perror_pos)
+{
+    if (!pctx || (!buff && buff_sz) || (!p_output && output_sz))
+        return -1;
+
+    size_t error_pos = 0;
+    if (!perror_pos)
+        perror_pos = &error_pos;
+
+    if (pctx->finished && buff_sz)
+    {
+        *perror_pos = pctx->position;
+        return -1;
+    }
+
+    if (output_sz < base64_stream_ctx_get_decode_length(pctx, buff_sz))
+        return -1;
+
+    // stream offset of buff
+    size_t start = pctx->position;
+    size_t pos = 0;
+    long written = 0;
+    BOOL padded = false;
+
+    if (pctx->carry_sz)
+    {
+        for (; pctx->carry_sz < 4 && pos < buff_sz; ++pos)
+            pctx->carry[pctx->carry_sz++] = (unsigned char)buff[pos];
+        if (pctx->carry_sz < 4)
+        {
+            pctx->position += buff_sz;
+            return 0;
+        }
+
+        written = decode_groups((const char*)pctx->carry, 1, p_output, pctx->flags, perror_pos, &padded);
+        if (written < 0)
+        {
+            *perror_pos += start + pos - 4;
+            return -1;
+        }
+        pctx->carry_sz = 0;
+    }
+
+    size_t groups_n = (buff_sz - pos) / 4;
+    if (!padded && groups_n)
+    {
+        long r = decode_groups(buff + pos, groups_n, p_output + written, pctx->flags, perror_pos, &padded);
+        if (r < 0)
+        {
+            *perror_pos += start + pos;
+            return -1;
+        }
+        written += r;
+        pos += 4 * groups_n;
+    }
+
+    if (padded && pos < buff_sz)
+    {
+        *perror_pos = start + pos;
+        return -1;
+    }
+
+    memcpy(pctx->carry, buff + pos, buff_sz - pos);
+    pctx->carry_sz = buff_sz - pos;
+    pctx->position += buff_sz;
+    pctx->finished = padded;
+
+    return written;
+}
+
+long base64_stream_ctx_finish_decode(base64_stream_ctx_t* pctx, unsigned char* p_output, const size_t output_sz)
+{
+    if (!pctx)
+        return -1;
+
+    if (!pctx->carry_sz)
+        return 0;
+
+    if (pctx->carry_sz < 2 || !p_output || output_sz < pctx->carry_sz - 1)
+        return -1;
+
+    size_t error_pos = 0;
+    long r = decode_group((const char*)pctx->carry, pctx->carry_sz, p_output, (pctx->flags & BASE64_URL) != 0,
+                          &error_pos);
+    pctx->carry_sz = 0;
+    return r;
+}
@@ -0,0 +1,192 @@
+#include "priv_base64.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+// Encoding: bytes (b0, b1, b2) of every group are shuffled to 32-bit word (b1, b0, b2, b1),
+// four 6-bit indexes are moved to separate bytes by multiplications
+// and indexes are converted to chars by offsets for alphabet ranges.
+
+#define ENCODE_OFFSETS(url)                                                                                            \
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,     \
+        ((url) ? '-' : '+') - 62, ((url) ? '_' : '/') - 63, 'A', 0, 0
+
+SSSE3_TARGET size_t base64_ssse3_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url)
+{
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i offsets = _mm_setr_epi8(ENCODE_OFFSETS(url));
+
+    size_t g = 0;
+    // 16 bytes are read for 4 groups
+    for (; 3 * g + 16 <= 3 * groups_n; g += 4)
+    {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p_input + 3 * g)), shuffle);
+
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i indexes = _mm_or_si128(t0, t1);
+
+        // 0 for [26, 51], 1..12 for [52, 63], 13 for [0, 25]
+        __m128i ranges = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+        ranges = _mm_or_si128(ranges, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+
+        __m128i chars = _mm_add_epi8(indexes, _mm_shuffle_epi8(offsets, ranges));
+        _mm_storeu_si128((__m128i*)(buff + 4 * g), chars);
+    }
+    return g;
+}
+
+AVX2_TARGET size_t base64_avx2_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5,
+                                             4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(ENCODE_OFFSETS(url), ENCODE_OFFSETS(url));
+
+    size_t g = 0;
+    // 12 + 16 bytes are read for 8 groups
+    for (; 3 * g + 28 <= 3 * groups_n; g += 8)
+    {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p_input + 3 * g))),
+            _mm_loadu_si128((const __m128i*)(p_input + 3 * g + 12)), 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                        _mm256_set1_epi32(0x01000010));
+        __m256i indexes = _mm256_or_si256(t0, t1);
+
+        __m256i ranges = _mm256_subs_epu8(indexes, _mm256_set1_epi8(51));
+        ranges = _mm256_or_si256(
+            ranges, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indexes), _mm256_set1_epi8(13)));
+
+        __m256i chars = _mm256_add_epi8(indexes, _mm256_shuffle_epi8(offsets, ranges));
+        _mm256_storeu_si256((__m256i*)(buff + 4 * g), chars);
+    }
+    return g;
+}
+
+// Decoding: chars are classified by alphabet ranges (unsigned x - low <= n - 1),
+// four 6-bit values of every group are joined by multiply-add
+// and 3 bytes of every 32-bit word are packed by shuffle.
+
+static inline SSSE3_TARGET __m128i ssse3_in_range(const __m128i c, const char low, const char n, __m128i* pdelta)
+{
+    *pdelta = _mm_sub_epi8(c, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(*pdelta, _mm_set1_epi8((char)(n - 1))), *pdelta);
+}
+
+static inline SSSE3_TARGET __m128i ssse3_from_base64(const __m128i c, const BOOL url, __m128i* pvalid)
+{
+    __m128i upper_d, lower_d, digit_d;
+    __m128i upper = ssse3_in_range(c, 'A', 26, &upper_d);
+    __m128i lower = ssse3_in_range(c, 'a', 26, &lower_d);
+    __m128i digit = ssse3_in_range(c, '0', 10, &digit_d);
+    __m128i c62 = _mm_cmpeq_epi8(c, _mm_set1_epi8(url ? '-' : '+'));
+    __m128i c63 = _mm_cmpeq_epi8(c, _mm_set1_epi8(url ? '_' : '/'));
+
+    *pvalid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+
+    __m128i values = _mm_and_si128(upper, upper_d);
+    values = _mm_or_si128(values, _mm_and_si128(lower, _mm_add_epi8(lower_d, _mm_set1_epi8(26))));
+    values = _mm_or_si128(values, _mm_and_si128(digit, _mm_add_epi8(digit_d, _mm_set1_epi8(52))));
+    values = _mm_or_si128(values, _mm_and_si128(c62, _mm_set1_epi8(62)));
+    return _mm_or_si128(values, _mm_and_si128(c63, _mm_set1_epi8(63)));
+}
+
+SSSE3_TARGET size_t base64_ssse3_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url)
+{
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t g = 0;
+    // 16 bytes are written for 4 groups
+    for (; 3 * g + 16 <= 3 * groups_n; g += 4)
+    {
+        __m128i valid;
+        __m128i values = ssse3_from_base64(_mm_loadu_si128((const __m128i*)(buff + 4 * g)), url, &valid);
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+
+        __m128i words = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)),
+                                       _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(p_output + 3 * g), _mm_shuffle_epi8(words, pack));
+    }
+    return g;
+}
+
+static inline AVX2_TARGET __m256i avx2_in_range(const __m256i c, const char low, const char n, __m256i* pdelta)
+{
+    *pdelta = _mm256_sub_epi8(c, _mm256_set1_epi8(low));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(*pdelta, _mm256_set1_epi8((char)(n - 1))), *pdelta);
+}
+
+static inline AVX2_TARGET __m256i avx2_from_base64(const __m256i c, const BOOL url, __m256i* pvalid)
+{
+    __m256i upper_d, lower_d, digit_d;
+    __m256i upper = avx2_in_range(c, 'A', 26, &upper_d);
+    __m256i lower = avx2_in_range(c, 'a', 26, &lower_d);
+    __m256i digit = avx2_in_range(c, '0', 10, &digit_d);
+    __m256i c62 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(url ? '-' : '+'));
+    __m256i c63 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(url ? '_' : '/'));
+
+    *pvalid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+
+    __m256i values = _mm256_and_si256(upper, upper_d);
+    values = _mm256_or_si256(values, _mm256_and_si256(lower, _mm256_add_epi8(lower_d, _mm256_set1_epi8(26))));
+    values = _mm256_or_si256(values, _mm256_and_si256(digit, _mm256_add_epi8(digit_d, _mm256_set1_epi8(52))));
+    values = _mm256_or_si256(values, _mm256_and_si256(c62, _mm256_set1_epi8(62)));
+    return _mm256_or_si256(values, _mm256_and_si256(c63, _mm256_set1_epi8(63)));
+}
+
+AVX2_TARGET size_t base64_avx2_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url)
+{
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+                                          10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    // 12 bytes of both 128-bit lanes together
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    size_t g = 0;
+    // 32 bytes are written for 8 groups
+    for (; 3 * g + 32 <= 3 * groups_n; g += 8)
+    {
+        __m256i valid;
+        __m256i values = avx2_from_base64(_mm256_loadu_si256((const __m256i*)(buff + 4 * g)), url, &valid);
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+
+        __m256i words = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+                                          _mm256_set1_epi32(0x00011000));
+        words = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, pack), join);
+        _mm256_storeu_si256((__m256i*)(p_output + 3 * g), words);
+    }
+    return g;
+}
+
+#else // x86_64
+
+size_t base64_ssse3_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url)
+{
+    return 0;
+}
+
+size_t base64_avx2_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url)
+{
+    return 0;
+}
+
+size_t base64_ssse3_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url)
+{
+    return 0;
+}
+
+size_t base64_avx2_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url)
+{
+    return 0;
+}
+
+#endif
@@ -1,28 +1,56 @@
 #include <server_clib/blowfish.h>
 
 #include "blowfish_tables.h"
+#include "priv_parallel.h"
+#include "priv_blowfish.h"
 
 #include <arpa/inet.h>
 
 #define ROUND_N 16
 
-static uint32_t F(blowfish_ctx_t* ctx, uint32_t x)
+// Round function
+#define BF_F(ctx, x)                                                                                                   \
+    ((((ctx)->S[0][(x) >> 24] + (ctx)->S[1][((x) >> 16) & 0xFF]) ^ (ctx)->S[2][((x) >> 8) & 0xFF])                  \
+     + (ctx)->S[3][(x)&0xFF])
+
+// Independent blocks processed together to hide S-box lookup latency
+#define BLOCKS_LANES_N 4
+// AVX2 kernel processes 2 x 8 blocks by gathers
+#define BLOCKS_AVX2_MIN_N 16
+// Staging buffer for in-place stream context update (multiple of block size)
+#define STREAM_CTX_STAGE_SZ 512
+
+// The loop is unrolled by two rounds to avoid Xl/Xr exchanging
+static inline void encrypt_block(const blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr)
 {
-    uint16_t a, b, c, d;
-    uint32_t y;
+    uint32_t l = *xl, r = *xr;
+    int i;
+
+    for (i = 0; i < ROUND_N; i += 2)
+    {
+        l ^= ctx->P[i];
+        r ^= BF_F(ctx, l) ^ ctx->P[i + 1];
+        l ^= BF_F(ctx, r);
+    }
 
-    d = (uint16_t)(x & 0xFF);
-    x >>= 8;
-    c = (uint16_t)(x & 0xFF);
-    x >>= 8;
-    b = (uint16_t)(x & 0xFF);
-    x >>= 8;
-    a = (uint16_t)(x & 0xFF);
-    y = ctx->S[0][a] + ctx->S[1][b];
-    y = y ^ ctx->S[2][c];
-    y = y + ctx->S[3][d];
+    *xl = r ^ ctx->P[ROUND_N + 1];
+    *xr = l ^ ctx->P[ROUND_N];
+}
+
+static inline void decrypt_block(const blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr)
+{
+    uint32_t l = *xl, r = *xr;
+    int i;
+
+    for (i = ROUND_N + 1; i > 1; i -= 2)
+    {
+        l ^= ctx->P[i];
+        r ^= BF_F(ctx, l) ^ ctx->P[i - 1];
+        l ^= BF_F(ctx, r);
+    }
 
-    return y;
+    *xl = r ^ ctx->P[0];
+    *xr = l ^ ctx->P[1];
 }
 
 BOOL blowfish_init(blowfish_ctx_t* ctx, uint8_t* key, int32_t keyLen)
@@ -58,7 +86,7 @@ BOOL blowfish_init(blowfish_ctx_t* ctx, uint8_t* key, int32_t keyLen)
 
     for (i = 0; i < ROUND_N + 2; i += 2)
     {
-        blowfish_encrypt_chunk(ctx, &datal, &datar);
+        encrypt_block(ctx, &datal, &datar);
         ctx->P[i] = datal;
         ctx->P[i + 1] = datar;
     }
@@ -67,7 +95,7 @@ BOOL blowfish_init(blowfish_ctx_t* ctx, uint8_t* key, int32_t keyLen)
     {
         for (j = 0; j < 256; j += 2)
         {
-            blowfish_encrypt_chunk(ctx, &datal, &datar);
+            encrypt_block(ctx, &datal, &datar);
             ctx->S[i][j] = datal;
             ctx->S[i][j + 1] = datar;
         }
@@ -81,71 +109,130 @@ BOOL blowfish_encrypt_chunk(blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr)
     if (!ctx || !xl || !xr)
         return false;
 
-    uint32_t Xl;
-    uint32_t Xr;
-    uint32_t temp;
-    int16_t i;
+    encrypt_block(ctx, xl, xr);
 
-    Xl = *xl;
-    Xr = *xr;
+    return true;
+}
 
-    for (i = 0; i < ROUND_N; ++i)
-    {
-        Xl = Xl ^ ctx->P[i];
-        Xr = F(ctx, Xl) ^ Xr;
+BOOL blowfish_decrypt_chunk(blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr)
+{
+    if (!ctx || !xl || !xr)
+        return false;
+
+    decrypt_block(ctx, xl, xr);
+
+    return true;
+}
 
-        temp = Xl;
-        Xl = Xr;
-        Xr = temp;
+// Rounds of BLOCKS_LANES_N blocks (with own key each) are interleaved like for encrypt_block/decrypt_block
+static inline void encrypt_lanes(const blowfish_ctx_t* c0,
+                                 const blowfish_ctx_t* c1,
+                                 const blowfish_ctx_t* c2,
+                                 const blowfish_ctx_t* c3,
+                                 uint32_t* pblocks)
+{
+    uint32_t l0 = pblocks[0], r0 = pblocks[1];
+    uint32_t l1 = pblocks[2], r1 = pblocks[3];
+    uint32_t l2 = pblocks[4], r2 = pblocks[5];
+    uint32_t l3 = pblocks[6], r3 = pblocks[7];
+    int i;
+
+    for (i = 0; i < ROUND_N; i += 2)
+    {
+        l0 ^= c0->P[i];
+        l1 ^= c1->P[i];
+        l2 ^= c2->P[i];
+        l3 ^= c3->P[i];
+        r0 ^= BF_F(c0, l0) ^ c0->P[i + 1];
+        r1 ^= BF_F(c1, l1) ^ c1->P[i + 1];
+        r2 ^= BF_F(c2, l2) ^ c2->P[i + 1];
+        r3 ^= BF_F(c3, l3) ^ c3->P[i + 1];
+        l0 ^= BF_F(c0, r0);
+        l1 ^= BF_F(c1, r1);
+        l2 ^= BF_F(c2, r2);
+        l3 ^= BF_F(c3, r3);
     }
 
-    temp = Xl;
-    Xl = Xr;
-    Xr = temp;
+    pblocks[0] = r0 ^ c0->P[ROUND_N + 1];
+    pblocks[1] = l0 ^ c0->P[ROUND_N];
+    pblocks[2] = r1 ^ c1->P[ROUND_N + 1];
+    pblocks[3] = l1 ^ c1->P[ROUND_N];
+    pblocks[4] = r2 ^ c2->P[ROUND_N + 1];
+    pblocks[5] = l2 ^ c2->P[ROUND_N];
+    pblocks[6] = r3 ^ c3->P[ROUND_N + 1];
+    pblocks[7] = l3 ^ c3->P[ROUND_N];
+}
 
-    Xr = Xr ^ ctx->P[ROUND_N];
-    Xl = Xl ^ ctx->P[ROUND_N + 1];
+static inline void decrypt_lanes(const blowfish_ctx_t* c0,
+                                 const blowfish_ctx_t* c1,
+                                 const blowfish_ctx_t* c2,
+                                 const blowfish_ctx_t* c3,
+                                 uint32_t* pblocks)
+{
+    uint32_t l0 = pblocks[0], r0 = pblocks[1];
+    uint32_t l1 = pblocks[2], r1 = pblocks[3];
+    uint32_t l2 = pblocks[4], r2 = pblocks[5];
+    uint32_t l3 = pblocks[6], r3 = pblocks[7];
+    int i;
 
-    *xl = Xl;
-    *xr = Xr;
+    for (i = ROUND_N + 1; i > 1; i -= 2)
+    {
+        l0 ^= c0->P[i];
+        l1 ^= c1->P[i];
+        l2 ^= c2->P[i];
+        l3 ^= c3->P[i];
+        r0 ^= BF_F(c0, l0) ^ c0->P[i - 1];
+        r1 ^= BF_F(c1, l1) ^ c1->P[i - 1];
+        r2 ^= BF_F(c2, l2) ^ c2->P[i - 1];
+        r3 ^= BF_F(c3, l3) ^ c3->P[i - 1];
+        l0 ^= BF_F(c0, r0);
+        l1 ^= BF_F(c1, r1);
+        l2 ^= BF_F(c2, r2);
+        l3 ^= BF_F(c3, r3);
+    }
 
-    return true;
+    pblocks[0] = r0 ^ c0->P[0];
+    pblocks[1] = l0 ^ c0->P[1];
+    pblocks[2] = r1 ^ c1->P[0];
+    pblocks[3] = l1 ^ c1->P[1];
+    pblocks[4] = r2 ^ c2->P[0];
+    pblocks[5] = l2 ^ c2->P[1];
+    pblocks[6] = r3 ^ c3->P[0];
+    pblocks[7] = l3 ^ c3->P[1];
 }
 
-BOOL blowfish_decrypt_chunk(blowfish_ctx_t* ctx, uint32_t* xl, uint32_t* xr)
+BOOL blowfish_encrypt_blocks(blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
 {
-    if (!ctx || !xl || !xr)
+    if (!ctx || !pblocks)
         return false;
 
-    uint32_t Xl;
-    uint32_t Xr;
-    uint32_t temp;
-    int16_t i;
+    size_t i = 0;
+    if (blocks_n >= BLOCKS_AVX2_MIN_N && blowfish_avx2_is_supported())
+        i = blowfish_avx2_encrypt_blocks(ctx, pblocks, blocks_n);
 
-    Xl = *xl;
-    Xr = *xr;
+    for (; i + BLOCKS_LANES_N <= blocks_n; i += BLOCKS_LANES_N)
+        encrypt_lanes(ctx, ctx, ctx, ctx, pblocks + 2 * i);
 
-    for (i = ROUND_N + 1; i > 1; --i)
-    {
-        Xl = Xl ^ ctx->P[i];
-        Xr = F(ctx, Xl) ^ Xr;
+    for (; i < blocks_n; ++i)
+        encrypt_block(ctx, pblocks + 2 * i, pblocks + 2 * i + 1);
 
-        /* Exchange Xl and Xr */
-        temp = Xl;
-        Xl = Xr;
-        Xr = temp;
-    }
+    return true;
+}
+
+BOOL blowfish_decrypt_blocks(blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
+{
+    if (!ctx || !pblocks)
+        return false;
 
-    /* Exchange Xl and Xr */
-    temp = Xl;
-    Xl = Xr;
-    Xr = temp;
+    size_t i = 0;
+    if (blocks_n >= BLOCKS_AVX2_MIN_N && blowfish_avx2_is_supported())
+        i = blowfish_avx2_decrypt_blocks(ctx, pblocks, blocks_n);
 
-    Xr = Xr ^ ctx->P[1];
-    Xl = Xl ^ ctx->P[0];
+    for (; i + BLOCKS_LANES_N <= blocks_n; i += BLOCKS_LANES_N)
+        decrypt_lanes(ctx, ctx, ctx, ctx, pblocks + 2 * i);
 
-    *xl = Xl;
-    *xr = Xr;
+    for (; i < blocks_n; ++i)
+        decrypt_block(ctx, pblocks + 2 * i, pblocks + 2 * i + 1);
 
     return true;
 }
@@ -177,94 +264,860 @@ size_t blowfish_get_stream_output_length(size_t input_long)
         return (size_t)input_long_;
 }
 
+#define STREAM_BATCH_BLOCKS_N 64
+
+// Stream byte order: encryption reads blocks in host byte order and writes big-endian ones,
+// decryption does the opposite. So data encrypted on LE host is decrypted correctly there only.
+// TODO: check for different site of blocks processing on BE-LE / LE-BE systems
+// echo -n I | od -to2 | head -n1 | cut -f2 -d" " | cut -c6 -> 1 for Little Endian, -> 0 for Big Endian
+// lscpu | grep Endian -> *
+
+typedef void (*stream_process_blocks_ft)(const blowfish_ctx_t*, const unsigned char*, const size_t, unsigned char*);
+
+static void stream_encrypt_blocks(const blowfish_ctx_t* ctx,
+                                  const unsigned char* p_input,
+                                  const size_t blocks_n,
+                                  unsigned char* p_output)
+{
+    size_t i = 0;
+
+    if (blocks_n >= BLOCKS_AVX2_MIN_N && blowfish_avx2_is_supported())
+    {
+        uint32_t blocks[2 * STREAM_BATCH_BLOCKS_N];
+        while (i + BLOCKS_AVX2_MIN_N <= blocks_n)
+        {
+            size_t batch_n = SRV_C_MIN(blocks_n - i, (size_t)STREAM_BATCH_BLOCKS_N);
+            memcpy(blocks, p_input + 8 * i, 8 * batch_n);
+            batch_n = blowfish_avx2_encrypt_blocks(ctx, blocks, batch_n);
+            for (size_t ci = 0; ci < 2 * batch_n; ++ci)
+                blocks[ci] = htonl(blocks[ci]);
+            memcpy(p_output + 8 * i, blocks, 8 * batch_n);
+            i += batch_n;
+        }
+    }
+
+    uint32_t lanes[2 * BLOCKS_LANES_N];
+    for (; i + BLOCKS_LANES_N <= blocks_n; i += BLOCKS_LANES_N)
+    {
+        memcpy(lanes, p_input + 8 * i, sizeof(lanes));
+        encrypt_lanes(ctx, ctx, ctx, ctx, lanes);
+        for (size_t ci = 0; ci < 2 * BLOCKS_LANES_N; ++ci)
+            lanes[ci] = htonl(lanes[ci]);
+        memcpy(p_output + 8 * i, lanes, sizeof(lanes));
+    }
+
+    for (; i < blocks_n; ++i)
+    {
+        memcpy(lanes, p_input + 8 * i, 8);
+        encrypt_block(ctx, &lanes[0], &lanes[1]);
+        lanes[0] = htonl(lanes[0]);
+        lanes[1] = htonl(lanes[1]);
+        memcpy(p_output + 8 * i, lanes, 8);
+    }
+}
+
+static void stream_decrypt_blocks(const blowfish_ctx_t* ctx,
+                                  const unsigned char* p_input,
+                                  const size_t blocks_n,
+                                  unsigned char* p_output)
+{
+    size_t i = 0;
+
+    if (blocks_n >= BLOCKS_AVX2_MIN_N && blowfish_avx2_is_supported())
+    {
+        uint32_t blocks[2 * STREAM_BATCH_BLOCKS_N];
+        while (i + BLOCKS_AVX2_MIN_N <= blocks_n)
+        {
+            size_t batch_n = SRV_C_MIN(blocks_n - i, (size_t)STREAM_BATCH_BLOCKS_N);
+            memcpy(blocks, p_input + 8 * i, 8 * batch_n);
+            for (size_t ci = 0; ci < 2 * batch_n; ++ci)
+                blocks[ci] = ntohl(blocks[ci]);
+            batch_n = blowfish_avx2_decrypt_blocks(ctx, blocks, batch_n);
+            memcpy(p_output + 8 * i, blocks, 8 * batch_n);
+            i += batch_n;
+        }
+    }
+
+    uint32_t lanes[2 * BLOCKS_LANES_N];
+    for (; i + BLOCKS_LANES_N <= blocks_n; i += BLOCKS_LANES_N)
+    {
+        memcpy(lanes, p_input + 8 * i, sizeof(lanes));
+        for (size_t ci = 0; ci < 2 * BLOCKS_LANES_N; ++ci)
+            lanes[ci] = ntohl(lanes[ci]);
+        decrypt_lanes(ctx, ctx, ctx, ctx, lanes);
+        memcpy(p_output + 8 * i, lanes, sizeof(lanes));
+    }
+
+    for (; i < blocks_n; ++i)
+    {
+        memcpy(lanes, p_input + 8 * i, 8);
+        lanes[0] = ntohl(lanes[0]);
+        lanes[1] = ntohl(lanes[1]);
+        decrypt_block(ctx, &lanes[0], &lanes[1]);
+        memcpy(p_output + 8 * i, lanes, 8);
+    }
+}
+
 static long blowfish_stream_process(blowfish_ctx_t* ctx,
                                     const unsigned char* p_input,
                                     const size_t input_sz,
                                     unsigned char* p_output,
                                     const size_t output_sz,
-                                    BOOL (*blowfish_process_f)(blowfish_ctx_t*, uint32_t*, uint32_t*),
-                                    BOOL ecrypt)
+                                    stream_process_blocks_ft process_blocks_f)
 {
     if (!ctx || !p_input || !input_sz || !p_output || !output_sz)
         return -1;
 
-    const unsigned char* p_in_pos = p_input;
-    size_t in_rest = input_sz;
-    size_t out_rest = output_sz;
-    size_t in_rest_fin = 0;
+    size_t blocks_n = SRV_C_MIN(input_sz, output_sz) / 8;
+    process_blocks_f(ctx, p_input, blocks_n, p_output);
 
-    const unsigned char* p_in_end = p_input + input_sz;
-    unsigned char* p_out_pos = p_output;
-    unsigned char* p_out_end = p_output + output_sz;
+    size_t processed = 8 * blocks_n;
+    size_t in_rest = input_sz - processed;
+
+    // the last block is padded by zeros
+    if (in_rest && in_rest < 8 && output_sz - processed >= 8)
+    {
+        unsigned char pint_rest[8];
+        bzero(pint_rest, sizeof(pint_rest));
+        memcpy(pint_rest, p_input + processed, in_rest);
+        process_blocks_f(ctx, pint_rest, 1, p_output + processed);
+        processed += 8;
+    }
+
+    return (long)processed;
+}
+
+long blowfish_stream_encrypt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz)
+{
+    return blowfish_stream_process(ctx, p_input, input_sz, p_output, output_sz, stream_encrypt_blocks);
+}
+
+long blowfish_stream_decrypt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz)
+{
+    return blowfish_stream_process(ctx, p_input, input_sz, p_output, output_sz, stream_decrypt_blocks);
+}
+
+// Position in iovec array
+typedef struct
+{
+    const struct iovec* piov;
+    size_t iov_n;
+    size_t iov_i;
+    size_t pos;
+} iov_cursor_t;
 
-    unsigned char pint_rest[8];
+static BOOL iov_get_length(const struct iovec* piov, const size_t iov_n, size_t* psz)
+{
+    size_t sz = 0;
+    for (size_t ci = 0; ci < iov_n; ++ci)
+    {
+        if (!piov[ci].iov_base && piov[ci].iov_len)
+            return false;
+        sz += piov[ci].iov_len;
+    }
+    *psz = sz;
+    return true;
+}
 
-    while (p_in_pos != p_in_end && p_out_pos != p_out_end)
+// bytes available in current fragment (empty fragments are skipped)
+static size_t iov_cursor_avail(iov_cursor_t* pcursor)
+{
+    while (pcursor->iov_i < pcursor->iov_n && pcursor->pos == pcursor->piov[pcursor->iov_i].iov_len)
     {
-        if (!in_rest || out_rest < 8)
-            break;
+        ++pcursor->iov_i;
+        pcursor->pos = 0;
+    }
+    if (pcursor->iov_i == pcursor->iov_n)
+        return 0;
+    return pcursor->piov[pcursor->iov_i].iov_len - pcursor->pos;
+}
 
-        if (in_rest < 8)
+static unsigned char* iov_cursor_ptr(const iov_cursor_t* pcursor)
+{
+    return (unsigned char*)pcursor->piov[pcursor->iov_i].iov_base + pcursor->pos;
+}
+
+// copy up to sz bytes between fragments and buffer. return copied bytes
+static size_t iov_cursor_copy(iov_cursor_t* pcursor, unsigned char* pbuff, const size_t sz, const BOOL to_iov)
+{
+    size_t copied = 0;
+    size_t avail;
+    while (copied < sz && (avail = iov_cursor_avail(pcursor)) > 0)
+    {
+        size_t chunk_sz = SRV_C_MIN(avail, sz - copied);
+        if (to_iov)
+            memcpy(iov_cursor_ptr(pcursor), pbuff + copied, chunk_sz);
+        else
+            memcpy(pbuff + copied, iov_cursor_ptr(pcursor), chunk_sz);
+        pcursor->pos += chunk_sz;
+        copied += chunk_sz;
+    }
+    return copied;
+}
+
+static long blowfish_stream_processv(blowfish_ctx_t* ctx,
+                                     const struct iovec* p_input_iov,
+                                     const size_t input_iov_n,
+                                     const struct iovec* p_output_iov,
+                                     const size_t output_iov_n,
+                                     stream_process_blocks_ft process_blocks_f)
+{
+    if (!ctx || !p_input_iov || !input_iov_n || !p_output_iov || !output_iov_n)
+        return -1;
+
+    size_t input_sz, output_sz;
+    if (!iov_get_length(p_input_iov, input_iov_n, &input_sz) || !input_sz
+        || !iov_get_length(p_output_iov, output_iov_n, &output_sz) || !output_sz)
+        return -1;
+
+    // the last not full input block is padded by zeros like blowfish_stream_process does
+    size_t blocks_n = SRV_C_MIN((input_sz + 7) / 8, output_sz / 8);
+
+    iov_cursor_t in = { p_input_iov, input_iov_n, 0, 0 };
+    iov_cursor_t out = { p_output_iov, output_iov_n, 0, 0 };
+    for (size_t done_n = 0; done_n < blocks_n;)
+    {
+        // blocks inside current fragments are processed directly
+        size_t run_n = SRV_C_MIN(SRV_C_MIN(iov_cursor_avail(&in), iov_cursor_avail(&out)) / 8, blocks_n - done_n);
+        if (run_n)
         {
-            bzero(pint_rest, sizeof(pint_rest));
-            memcpy(pint_rest, p_in_pos, in_rest);
-            p_in_pos = pint_rest;
-            in_rest_fin = 8 - in_rest;
-            in_rest = 8;
+            process_blocks_f(ctx, iov_cursor_ptr(&in), run_n, iov_cursor_ptr(&out));
+            in.pos += 8 * run_n;
+            out.pos += 8 * run_n;
+            done_n += run_n;
+            continue;
         }
 
-        uint32_t xl = 0;
-        uint32_t xr = 0;
-        memcpy(&xl, (uint32_t*)p_in_pos, sizeof(xl));
-        p_in_pos += 4;
-        memcpy(&xr, (uint32_t*)p_in_pos, sizeof(xr));
-        p_in_pos += 4;
+        // block straddles fragments bound
+        unsigned char block[8];
+        bzero(block, sizeof(block));
+        iov_cursor_copy(&in, block, sizeof(block), false);
+        process_blocks_f(ctx, block, 1, block);
+        iov_cursor_copy(&out, block, sizeof(block), true);
+        ++done_n;
+    }
+
+    return (long)(8 * blocks_n);
+}
 
-        in_rest -= 8;
+long blowfish_stream_encryptv(blowfish_ctx_t* ctx,
+                              const struct iovec* p_input_iov,
+                              const size_t input_iov_n,
+                              const struct iovec* p_output_iov,
+                              const size_t output_iov_n)
+{
+    return blowfish_stream_processv(ctx, p_input_iov, input_iov_n, p_output_iov, output_iov_n,
+                                    stream_encrypt_blocks);
+}
+
+long blowfish_stream_decryptv(blowfish_ctx_t* ctx,
+                              const struct iovec* p_input_iov,
+                              const size_t input_iov_n,
+                              const struct iovec* p_output_iov,
+                              const size_t output_iov_n)
+{
+    return blowfish_stream_processv(ctx, p_input_iov, input_iov_n, p_output_iov, output_iov_n,
+                                    stream_decrypt_blocks);
+}
 
-        if (!ecrypt)
+typedef struct
+{
+    blowfish_stream_job_t* pjob;
+    const unsigned char* p_in_pos;
+    unsigned char* p_out_pos;
+    size_t in_rest;
+    size_t blocks_rest;
+} batch_lane_t;
+
+// take next job with not empty result to lane
+static BOOL batch_next_job(batch_lane_t* plane, blowfish_stream_job_t* pjobs, const size_t jobs_n, size_t* pnext_job)
+{
+    while (*pnext_job < jobs_n)
+    {
+        blowfish_stream_job_t* pjob = &pjobs[(*pnext_job)++];
+        if (!pjob->ctx || !pjob->p_input || !pjob->input_sz || !pjob->p_output || !pjob->output_sz)
         {
-            xl = ntohl(xl);
-            xr = ntohl(xr);
+            pjob->processed = -1;
+            continue;
         }
 
-        // TODO: check for different site of blowfish_process_f calling on BE-LE / LE-BE systems
-        // echo -n I | od -to2 | head -n1 | cut -f2 -d" " | cut -c6 -> 1 for Little Endian, -> 0 for Big Endian
-        // lscpu | grep Endian -> *
-        // Now blowfish_process_f is called on host's Byte Order
-        SRV_C_ASSERT(blowfish_process_f(ctx, &xl, &xr));
+        // the last not full input block is padded by zeros like blowfish_stream_process does
+        size_t blocks_n = SRV_C_MIN((pjob->input_sz + 7) / 8, pjob->output_sz / 8);
+        pjob->processed = (long)(8 * blocks_n);
+        if (!blocks_n)
+            continue;
+
+        plane->pjob = pjob;
+        plane->p_in_pos = pjob->p_input;
+        plane->p_out_pos = pjob->p_output;
+        plane->in_rest = pjob->input_sz;
+        plane->blocks_rest = blocks_n;
+        return true;
+    }
+
+    plane->pjob = NULL;
+    return false;
+}
+
+static BOOL blowfish_stream_process_batch(blowfish_stream_job_t* pjobs, const size_t jobs_n, const BOOL ecrypt)
+{
+    if (!pjobs)
+        return false;
+
+    batch_lane_t lanes[BLOCKS_LANES_N];
+    size_t next_job = 0;
+    size_t active_n = 0;
+    for (size_t k = 0; k < BLOCKS_LANES_N; ++k)
+    {
+        if (batch_next_job(&lanes[k], pjobs, jobs_n, &next_job))
+            ++active_n;
+    }
+
+    uint32_t blocks[2 * BLOCKS_LANES_N];
+    const blowfish_ctx_t* ctxs[BLOCKS_LANES_N];
+
+    while (active_n)
+    {
+        const blowfish_ctx_t* pany_ctx = NULL;
+        for (size_t k = 0; k < BLOCKS_LANES_N; ++k)
+        {
+            batch_lane_t* plane = &lanes[k];
+            if (!plane->pjob)
+                continue;
+
+            uint32_t* pblock = blocks + 2 * k;
+            if (plane->in_rest >= 8)
+            {
+                memcpy(pblock, plane->p_in_pos, 8);
+                plane->p_in_pos += 8;
+                plane->in_rest -= 8;
+            }
+            else
+            {
+                bzero(pblock, 8);
+                memcpy(pblock, plane->p_in_pos, plane->in_rest);
+                plane->in_rest = 0;
+            }
+
+            if (!ecrypt)
+            {
+                pblock[0] = ntohl(pblock[0]);
+                pblock[1] = ntohl(pblock[1]);
+            }
+
+            ctxs[k] = plane->pjob->ctx;
+            pany_ctx = ctxs[k];
+        }
+
+        // idle lanes are processed with any key
+        for (size_t k = 0; k < BLOCKS_LANES_N; ++k)
+        {
+            if (!lanes[k].pjob)
+                ctxs[k] = pany_ctx;
+        }
 
         if (ecrypt)
+            encrypt_lanes(ctxs[0], ctxs[1], ctxs[2], ctxs[3], blocks);
+        else
+            decrypt_lanes(ctxs[0], ctxs[1], ctxs[2], ctxs[3], blocks);
+
+        for (size_t k = 0; k < BLOCKS_LANES_N; ++k)
         {
-            xl = htonl(xl);
-            xr = htonl(xr);
+            batch_lane_t* plane = &lanes[k];
+            if (!plane->pjob)
+                continue;
+
+            uint32_t* pblock = blocks + 2 * k;
+            if (ecrypt)
+            {
+                pblock[0] = htonl(pblock[0]);
+                pblock[1] = htonl(pblock[1]);
+            }
+            memcpy(plane->p_out_pos, pblock, 8);
+            plane->p_out_pos += 8;
+
+            if (!--plane->blocks_rest && !batch_next_job(plane, pjobs, jobs_n, &next_job))
+                --active_n;
         }
+    }
 
-        memcpy(p_out_pos, &xl, sizeof(xl));
-        p_out_pos += 4;
-        memcpy(p_out_pos, &xr, sizeof(xr));
-        p_out_pos += 4;
+    return true;
+}
 
-        out_rest -= 8;
+BOOL blowfish_stream_encrypt_batch(blowfish_stream_job_t* pjobs, const size_t jobs_n)
+{
+    return blowfish_stream_process_batch(pjobs, jobs_n, true);
+}
+
+BOOL blowfish_stream_decrypt_batch(blowfish_stream_job_t* pjobs, const size_t jobs_n)
+{
+    return blowfish_stream_process_batch(pjobs, jobs_n, false);
+}
+
+#define CTR_BATCH_BLOCKS_N 64
+#define CTR_MT_JOB_SZ (64 * 1024)
+
+size_t blowfish_get_nonce_length(void)
+{
+    return 8;
+}
+
+static void ctr_process(blowfish_ctx_t* ctx,
+                        const unsigned char* p_nonce,
+                        const uint64_t offset,
+                        const unsigned char* p_input,
+                        const size_t sz,
+                        unsigned char* p_output)
+{
+    uint64_t counter = 0;
+    for (int ci = 0; ci < 8; ++ci)
+        counter = (counter << 8) | p_nonce[ci];
+    counter += offset / 8;
+
+    size_t skip = (size_t)(offset % 8);
+    size_t rest = sz;
+
+    uint32_t blocks[2 * CTR_BATCH_BLOCKS_N];
+    unsigned char keystream[8 * CTR_BATCH_BLOCKS_N];
+
+    while (rest > 0)
+    {
+        size_t blocks_n = SRV_C_MIN((skip + rest + 7) / 8, (size_t)CTR_BATCH_BLOCKS_N);
+        for (size_t ci = 0; ci < blocks_n; ++ci, ++counter)
+        {
+            blocks[2 * ci] = (uint32_t)(counter >> 32);
+            blocks[2 * ci + 1] = (uint32_t)counter;
+        }
+
+        blowfish_encrypt_blocks(ctx, blocks, blocks_n);
+
+        // the same output byte order as for blowfish_stream_encrypt
+        for (size_t ci = 0; ci < 2 * blocks_n; ++ci)
+            blocks[ci] = htonl(blocks[ci]);
+        memcpy(keystream, blocks, 8 * blocks_n);
+
+        size_t chunk_sz = SRV_C_MIN(8 * blocks_n - skip, rest);
+        const unsigned char* pk = keystream + skip;
+        for (size_t ci = 0; ci < chunk_sz; ++ci)
+            p_output[ci] = p_input[ci] ^ pk[ci];
+
+        p_input += chunk_sz;
+        p_output += chunk_sz;
+        rest -= chunk_sz;
+        skip = 0;
     }
+}
 
-    return input_sz - in_rest + in_rest_fin;
+long blowfish_ctr_encrypt(blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const uint64_t offset,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz)
+{
+    if (!ctx || !p_nonce || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    size_t sz = SRV_C_MIN(input_sz, output_sz);
+
+    ctr_process(ctx, p_nonce, offset, p_input, sz, p_output);
+
+    return (long)sz;
 }
 
-long blowfish_stream_encrypt(blowfish_ctx_t* ctx,
+long blowfish_ctr_decrypt(blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const uint64_t offset,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz)
+{
+    return blowfish_ctr_encrypt(ctx, p_nonce, offset, p_input, input_sz, p_output, output_sz);
+}
+
+typedef struct
+{
+    blowfish_ctx_t* ctx;
+    const unsigned char* p_nonce;
+    uint64_t offset;
+    const unsigned char* p_input;
+    unsigned char* p_output;
+    size_t sz;
+} ctr_mt_ctx_t;
+
+static void ctr_mt_job(void* pctx, const size_t job_i)
+{
+    ctr_mt_ctx_t* pmt = (ctr_mt_ctx_t*)pctx;
+
+    size_t pos = job_i * CTR_MT_JOB_SZ;
+    size_t sz = SRV_C_MIN((size_t)CTR_MT_JOB_SZ, pmt->sz - pos);
+
+    ctr_process(pmt->ctx, pmt->p_nonce, pmt->offset + pos, pmt->p_input + pos, sz, pmt->p_output + pos);
+}
+
+long blowfish_ctr_encrypt_mt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_nonce,
+                             const uint64_t offset,
                              const unsigned char* p_input,
                              const size_t input_sz,
                              unsigned char* p_output,
-                             const size_t output_sz)
+                             const size_t output_sz,
+                             const size_t threads_n)
 {
-    return blowfish_stream_process(ctx, p_input, input_sz, p_output, output_sz, blowfish_encrypt_chunk, true);
+    if (!ctx || !p_nonce || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    ctr_mt_ctx_t mt = { ctx, p_nonce, offset, p_input, p_output, SRV_C_MIN(input_sz, output_sz) };
+
+    if (!parallel_for((mt.sz + CTR_MT_JOB_SZ - 1) / CTR_MT_JOB_SZ, threads_n, ctr_mt_job, &mt))
+        return -1;
+
+    return (long)mt.sz;
 }
 
-long blowfish_stream_decrypt(blowfish_ctx_t* ctx,
+long blowfish_ctr_decrypt_mt(blowfish_ctx_t* ctx,
+                             const unsigned char* p_nonce,
+                             const uint64_t offset,
                              const unsigned char* p_input,
                              const size_t input_sz,
                              unsigned char* p_output,
-                             const size_t output_sz)
+                             const size_t output_sz,
+                             const size_t threads_n)
+{
+    return blowfish_ctr_encrypt_mt(ctx, p_nonce, offset, p_input, input_sz, p_output, output_sz, threads_n);
+}
+
+#define CBC_BATCH_BLOCKS_N 64
+#define CBC_MT_JOB_BLOCKS_N (8 * 1024)
+
+static uint32_t load_be32(const unsigned char* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void store_be32(unsigned char* p, const uint32_t x)
+{
+    p[0] = (unsigned char)(x >> 24);
+    p[1] = (unsigned char)(x >> 16);
+    p[2] = (unsigned char)(x >> 8);
+    p[3] = (unsigned char)x;
+}
+
+long blowfish_cbc_encrypt(blowfish_ctx_t* ctx,
+                          unsigned char* p_iv,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz)
+{
+    if (!ctx || !p_iv || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    uint32_t xl = load_be32(p_iv);
+    uint32_t xr = load_be32(p_iv + 4);
+
+    size_t processed = 0;
+    while (processed < input_sz && processed + 8 <= output_sz)
+    {
+        size_t in_rest = input_sz - processed;
+        const unsigned char* p_in_pos = p_input + processed;
+
+        unsigned char pint_rest[8];
+        if (in_rest < 8)
+        {
+            bzero(pint_rest, sizeof(pint_rest));
+            memcpy(pint_rest, p_in_pos, in_rest);
+            p_in_pos = pint_rest;
+        }
+
+        xl ^= load_be32(p_in_pos);
+        xr ^= load_be32(p_in_pos + 4);
+
+        encrypt_block(ctx, &xl, &xr);
+
+        store_be32(p_output + processed, xl);
+        store_be32(p_output + processed + 4, xr);
+
+        processed += 8;
+    }
+
+    store_be32(p_iv, xl);
+    store_be32(p_iv + 4, xr);
+
+    return (long)processed;
+}
+
+// iv is previous ciphertext block for the first one from p_input
+static void cbc_decrypt_blocks(blowfish_ctx_t* ctx,
+                               const unsigned char* p_iv,
+                               const unsigned char* p_input,
+                               const size_t blocks_n,
+                               unsigned char* p_output)
+{
+    uint32_t blocks[2 * CBC_BATCH_BLOCKS_N];
+    uint32_t prev[2 * (CBC_BATCH_BLOCKS_N + 1)];
+
+    prev[0] = load_be32(p_iv);
+    prev[1] = load_be32(p_iv + 4);
+
+    size_t rest = blocks_n;
+    while (rest > 0)
+    {
+        size_t batch_n = SRV_C_MIN(rest, (size_t)CBC_BATCH_BLOCKS_N);
+
+        // ciphertext is kept before output is written to allow in-place decryption
+        for (size_t ci = 0; ci < 2 * batch_n; ++ci)
+            prev[ci + 2] = blocks[ci] = load_be32(p_input + 4 * ci);
+
+        blowfish_decrypt_blocks(ctx, blocks, batch_n);
+
+        for (size_t ci = 0; ci < 2 * batch_n; ++ci)
+            store_be32(p_output + 4 * ci, blocks[ci] ^ prev[ci]);
+
+        prev[0] = prev[2 * batch_n];
+        prev[1] = prev[2 * batch_n + 1];
+
+        p_input += 8 * batch_n;
+        p_output += 8 * batch_n;
+        rest -= batch_n;
+    }
+}
+
+long blowfish_cbc_decrypt(blowfish_ctx_t* ctx,
+                          unsigned char* p_iv,
+                          const unsigned char* p_input,
+                          const size_t input_sz,
+                          unsigned char* p_output,
+                          const size_t output_sz)
+{
+    if (!ctx || !p_iv || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    size_t blocks_n = SRV_C_MIN(input_sz, output_sz) / 8;
+    if (!blocks_n)
+        return 0;
+
+    unsigned char next_iv[8];
+    memcpy(next_iv, p_input + 8 * (blocks_n - 1), sizeof(next_iv));
+
+    cbc_decrypt_blocks(ctx, p_iv, p_input, blocks_n, p_output);
+
+    memcpy(p_iv, next_iv, sizeof(next_iv));
+
+    return (long)(8 * blocks_n);
+}
+
+typedef struct
 {
-    return blowfish_stream_process(ctx, p_input, input_sz, p_output, output_sz, blowfish_decrypt_chunk, false);
+    blowfish_ctx_t* ctx;
+    const unsigned char* p_ivs; // iv for every job
+    const unsigned char* p_input;
+    unsigned char* p_output;
+    size_t blocks_n;
+} cbc_mt_ctx_t;
+
+static void cbc_mt_job(void* pctx, const size_t job_i)
+{
+    cbc_mt_ctx_t* pmt = (cbc_mt_ctx_t*)pctx;
+
+    size_t pos = job_i * CBC_MT_JOB_BLOCKS_N;
+    size_t blocks_n = SRV_C_MIN((size_t)CBC_MT_JOB_BLOCKS_N, pmt->blocks_n - pos);
+
+    cbc_decrypt_blocks(pmt->ctx, pmt->p_ivs + 8 * job_i, pmt->p_input + 8 * pos, blocks_n, pmt->p_output + 8 * pos);
+}
+
+long blowfish_cbc_decrypt_mt(blowfish_ctx_t* ctx,
+                             unsigned char* p_iv,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             const size_t threads_n)
+{
+    if (!ctx || !p_iv || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    size_t blocks_n = SRV_C_MIN(input_sz, output_sz) / 8;
+    if (!blocks_n)
+        return 0;
+
+    size_t jobs_n = (blocks_n + CBC_MT_JOB_BLOCKS_N - 1) / CBC_MT_JOB_BLOCKS_N;
+
+    // every job depends on the last ciphertext block of the previous one only.
+    // They are copied before to allow in-place decryption
+    unsigned char* p_ivs = (unsigned char*)malloc(8 * (jobs_n + 1));
+    if (!p_ivs)
+        return -1;
+
+    memcpy(p_ivs, p_iv, 8);
+    for (size_t ci = 1; ci < jobs_n; ++ci)
+        memcpy(p_ivs + 8 * ci, p_input + 8 * (ci * CBC_MT_JOB_BLOCKS_N - 1), 8);
+    memcpy(p_ivs + 8 * jobs_n, p_input + 8 * (blocks_n - 1), 8);
+
+    cbc_mt_ctx_t mt = { ctx, p_ivs, p_input, p_output, blocks_n };
+
+    BOOL result = parallel_for(jobs_n, threads_n, cbc_mt_job, &mt);
+    if (result)
+        memcpy(p_iv, p_ivs + 8 * jobs_n, 8);
+
+    free(p_ivs);
+
+    return (result) ? (long)(8 * blocks_n) : -1;
+}
+
+static void stream_ctx_process_blocks(const blowfish_stream_ctx_t* pstream,
+                                      const unsigned char* p_input,
+                                      const size_t blocks_n,
+                                      unsigned char* p_output)
+{
+    if (pstream->encrypt)
+        stream_encrypt_blocks(pstream->ctx, p_input, blocks_n, p_output);
+    else
+        stream_decrypt_blocks(pstream->ctx, p_input, blocks_n, p_output);
+}
+
+// In-place update with carried bytes writes output ahead of the unread input.
+// Input is staged through a local buffer and read ahead before it is overwritten
+static void stream_ctx_update_staged(blowfish_stream_ctx_t* pstream,
+                                     const unsigned char* p_input,
+                                     const size_t input_sz,
+                                     unsigned char* p_output)
+{
+    unsigned char stage[STREAM_CTX_STAGE_SZ];
+    const unsigned char* p_in_pos = p_input;
+    size_t in_rest = input_sz;
+    unsigned char* p_out_pos = p_output;
+
+    while (pstream->carry_sz + in_rest >= 8)
+    {
+        size_t stage_sz = SRV_C_MIN(sizeof(stage), (pstream->carry_sz + in_rest) / 8 * 8);
+        size_t sz = stage_sz - pstream->carry_sz;
+
+        memcpy(stage, pstream->carry, pstream->carry_sz);
+        memcpy(stage + pstream->carry_sz, p_in_pos, sz);
+        p_in_pos += sz;
+        in_rest -= sz;
+
+        pstream->carry_sz = SRV_C_MIN(pstream->carry_sz, in_rest);
+        memcpy(pstream->carry, p_in_pos, pstream->carry_sz);
+        p_in_pos += pstream->carry_sz;
+        in_rest -= pstream->carry_sz;
+
+        stream_ctx_process_blocks(pstream, stage, stage_sz / 8, p_out_pos);
+        p_out_pos += stage_sz;
+    }
+
+    memcpy(pstream->carry + pstream->carry_sz, p_in_pos, in_rest);
+    pstream->carry_sz += in_rest;
+}
+
+BOOL blowfish_stream_ctx_init(blowfish_stream_ctx_t* pstream, blowfish_ctx_t* ctx, const BOOL encrypt)
+{
+    if (!pstream || !ctx)
+        return false;
+
+    bzero(pstream, sizeof(blowfish_stream_ctx_t));
+    pstream->ctx = ctx;
+    pstream->encrypt = encrypt ? 1 : 0;
+
+    return true;
+}
+
+BOOL blowfish_stream_ctx_destroy(blowfish_stream_ctx_t* pstream)
+{
+    if (!pstream)
+        return false;
+
+    bzero(pstream, sizeof(blowfish_stream_ctx_t));
+    return true;
+}
+
+size_t blowfish_stream_ctx_get_output_length(const blowfish_stream_ctx_t* pstream, const size_t input_sz)
+{
+    if (!pstream)
+        return 0;
+
+    return (pstream->carry_sz + input_sz) / 8 * 8;
+}
+
+long blowfish_stream_ctx_update(blowfish_stream_ctx_t* pstream,
+                                const unsigned char* p_input,
+                                const size_t input_sz,
+                                unsigned char* p_output,
+                                const size_t output_sz)
+{
+    if (!pstream || !pstream->ctx || (!p_input && input_sz))
+        return -1;
+
+    size_t written_sz = blowfish_stream_ctx_get_output_length(pstream, input_sz);
+    if (written_sz && (!p_output || output_sz < written_sz))
+        return -1;
+
+    if (pstream->carry_sz && p_output == p_input)
+    {
+        stream_ctx_update_staged(pstream, p_input, input_sz, p_output);
+        return (long)written_sz;
+    }
+
+    const unsigned char* p_in_pos = p_input;
+    size_t in_rest = input_sz;
+    unsigned char* p_out_pos = p_output;
+
+    if (pstream->carry_sz)
+    {
+        size_t sz = SRV_C_MIN(8 - pstream->carry_sz, in_rest);
+        memcpy(pstream->carry + pstream->carry_sz, p_in_pos, sz);
+        pstream->carry_sz += sz;
+        p_in_pos += sz;
+        in_rest -= sz;
+
+        if (pstream->carry_sz < 8)
+            return 0;
+
+        stream_ctx_process_blocks(pstream, pstream->carry, 1, p_out_pos);
+        pstream->carry_sz = 0;
+        p_out_pos += 8;
+    }
+
+    // directly from input
+    size_t blocks_n = in_rest / 8;
+    stream_ctx_process_blocks(pstream, p_in_pos, blocks_n, p_out_pos);
+    p_in_pos += 8 * blocks_n;
+    in_rest -= 8 * blocks_n;
+
+    memcpy(pstream->carry, p_in_pos, in_rest);
+    pstream->carry_sz = in_rest;
+
+    return (long)written_sz;
+}
+
+long blowfish_stream_ctx_finish(blowfish_stream_ctx_t* pstream, unsigned char* p_output, const size_t output_sz)
+{
+    if (!pstream || !pstream->ctx)
+        return -1;
+
+    if (!pstream->carry_sz)
+        return 0;
+
+    // ciphertext should consist of full blocks
+    if (!pstream->encrypt || !p_output || output_sz < 8)
+        return -1;
+
+    bzero(pstream->carry + pstream->carry_sz, 8 - pstream->carry_sz);
+    stream_ctx_process_blocks(pstream, pstream->carry, 1, p_output);
+
+    bzero(pstream->carry, sizeof(pstream->carry));
+    pstream->carry_sz = 0;
+
+    return 8;
 }
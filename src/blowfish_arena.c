@@ -0,0 +1,156 @@
+#include <server_clib/blowfish_arena.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ARENA_HUGE_PAGE_SZ (2 * 1024 * 1024)
+
+static size_t align_up(const size_t sz, const size_t align)
+{
+    return (sz + align - 1) / align * align;
+}
+
+static void* arena_map(const size_t map_sz, const BOOL hugepages, BOOL* phugetlb)
+{
+    void* pmem = MAP_FAILED;
+
+    *phugetlb = false;
+#ifdef MAP_HUGETLB
+    if (hugepages)
+    {
+        // huge pages are reserved at once to fail here (not by SIGBUS on access) if pool is short
+        pmem = mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        *phugetlb = pmem != MAP_FAILED;
+    }
+#endif
+    if (pmem == MAP_FAILED)
+    {
+        pmem = mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (pmem == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (hugepages)
+            madvise(pmem, map_sz, MADV_HUGEPAGE);
+#endif
+    }
+    return pmem;
+}
+
+BOOL blowfish_arena_init(blowfish_arena_t* parena, const size_t capacity, const BOOL hugepages)
+{
+    if (!parena || !capacity || capacity > UINT32_MAX)
+        return false;
+
+    bzero(parena, sizeof(blowfish_arena_t));
+
+    parena->slot_sz = align_up(sizeof(blowfish_ctx_t), BLOWFISH_ARENA_ALIGN_SZ);
+    parena->capacity = capacity;
+
+    size_t page_sz = hugepages ? ARENA_HUGE_PAGE_SZ : (size_t)sysconf(_SC_PAGESIZE);
+    parena->map_sz = align_up(parena->slot_sz * capacity, page_sz);
+
+    parena->pfree = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    parena->pbusy = (uint64_t*)calloc((capacity + 63) / 64, sizeof(uint64_t));
+    if (parena->pfree && parena->pbusy)
+        parena->pmem = (unsigned char*)arena_map(parena->map_sz, hugepages, &parena->hugetlb);
+
+    if (!parena->pmem || pthread_mutex_init(&parena->lock, NULL) != 0)
+    {
+        if (parena->pmem)
+            munmap(parena->pmem, parena->map_sz);
+        free(parena->pfree);
+        free(parena->pbusy);
+        bzero(parena, sizeof(blowfish_arena_t));
+        return false;
+    }
+
+    return true;
+}
+
+BOOL blowfish_arena_destroy(blowfish_arena_t* parena)
+{
+    if (!parena || !parena->pmem)
+        return false;
+
+    pthread_mutex_destroy(&parena->lock);
+
+    // only touched slots can keep keys
+    bzero(parena->pmem, parena->used_n * parena->slot_sz);
+    munmap(parena->pmem, parena->map_sz);
+    free(parena->pfree);
+    free(parena->pbusy);
+
+    bzero(parena, sizeof(blowfish_arena_t));
+
+    return true;
+}
+
+blowfish_ctx_t* blowfish_arena_alloc(blowfish_arena_t* parena)
+{
+    if (!parena || !parena->pmem)
+        return NULL;
+
+    blowfish_ctx_t* ctx = NULL;
+
+    pthread_mutex_lock(&parena->lock);
+    size_t slot_i = parena->capacity;
+    if (parena->free_n)
+        slot_i = parena->pfree[--parena->free_n];
+    else if (parena->used_n < parena->capacity)
+        slot_i = parena->used_n++;
+    if (slot_i < parena->capacity)
+    {
+        parena->pbusy[slot_i / 64] |= (uint64_t)1 << (slot_i % 64);
+        __atomic_add_fetch(&parena->allocated_n, 1, __ATOMIC_RELAXED);
+        ctx = (blowfish_ctx_t*)(parena->pmem + slot_i * parena->slot_sz);
+    }
+    pthread_mutex_unlock(&parena->lock);
+
+    return ctx;
+}
+
+BOOL blowfish_arena_free(blowfish_arena_t* parena, blowfish_ctx_t* ctx)
+{
+    if (!parena || !parena->pmem || !ctx)
+        return false;
+
+    unsigned char* pslot = (unsigned char*)ctx;
+    if (pslot < parena->pmem)
+        return false;
+
+    size_t offset = (size_t)(pslot - parena->pmem);
+    if (offset % parena->slot_sz)
+        return false;
+
+    size_t slot_i = offset / parena->slot_sz;
+    uint64_t busy_mask = (uint64_t)1 << (slot_i % 64);
+
+    BOOL result = false;
+    pthread_mutex_lock(&parena->lock);
+    // foreign pointers and double release are refused
+    if (slot_i < parena->used_n && (parena->pbusy[slot_i / 64] & busy_mask))
+    {
+        blowfish_destroy(ctx);
+        parena->pbusy[slot_i / 64] &= ~busy_mask;
+        parena->pfree[parena->free_n++] = (uint32_t)slot_i;
+        __atomic_sub_fetch(&parena->allocated_n, 1, __ATOMIC_RELAXED);
+        result = true;
+    }
+    pthread_mutex_unlock(&parena->lock);
+
+    return result;
+}
+
+size_t blowfish_arena_get_capacity(const blowfish_arena_t* parena)
+{
+    if (!parena)
+        return 0;
+    return parena->capacity;
+}
+
+size_t blowfish_arena_get_allocated(const blowfish_arena_t* parena)
+{
+    if (!parena)
+        return 0;
+    return __atomic_load_n(&parena->allocated_n, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,134 @@
+#include "priv_blowfish.h"
+#include "priv_cpu.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define ROUND_N 16
+#define AVX2_LANES_N 8
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+BOOL blowfish_avx2_is_supported(void)
+{
+    return cpu_is_supported(CPU_FEATURE_AVX2);
+}
+
+// four S-box gathers for 8 lanes
+static inline AVX2_TARGET __m256i avx2_F(const blowfish_ctx_t* ctx, const __m256i x)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+
+    __m256i a = _mm256_srli_epi32(x, 24);
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(x, 16), mask);
+    __m256i c = _mm256_and_si256(_mm256_srli_epi32(x, 8), mask);
+    __m256i d = _mm256_and_si256(x, mask);
+
+    __m256i y = _mm256_add_epi32(_mm256_i32gather_epi32((const int*)ctx->S[0], a, 4),
+                                 _mm256_i32gather_epi32((const int*)ctx->S[1], b, 4));
+    y = _mm256_xor_si256(y, _mm256_i32gather_epi32((const int*)ctx->S[2], c, 4));
+    return _mm256_add_epi32(y, _mm256_i32gather_epi32((const int*)ctx->S[3], d, 4));
+}
+
+// (xl, xr) pairs of 8 blocks to xl and xr vectors
+static inline AVX2_TARGET void avx2_load(const uint32_t* pblocks, __m256i* pl, __m256i* pr)
+{
+    const __m256i idx = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    __m256i t0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)pblocks), idx);
+    __m256i t1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(pblocks + 8)), idx);
+
+    *pl = _mm256_permute2x128_si256(t0, t1, 0x20);
+    *pr = _mm256_permute2x128_si256(t0, t1, 0x31);
+}
+
+static inline AVX2_TARGET void avx2_store(uint32_t* pblocks, const __m256i l, const __m256i r)
+{
+    const __m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    __m256i t0 = _mm256_permute2x128_si256(l, r, 0x20);
+    __m256i t1 = _mm256_permute2x128_si256(l, r, 0x31);
+
+    _mm256_storeu_si256((__m256i*)pblocks, _mm256_permutevar8x32_epi32(t0, idx));
+    _mm256_storeu_si256((__m256i*)(pblocks + 8), _mm256_permutevar8x32_epi32(t1, idx));
+}
+
+AVX2_TARGET size_t blowfish_avx2_encrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
+{
+    size_t processed = 0;
+    // two independent groups to hide gathers latency
+    for (; processed + 2 * AVX2_LANES_N <= blocks_n; processed += 2 * AVX2_LANES_N, pblocks += 4 * AVX2_LANES_N)
+    {
+        __m256i l0, r0, l1, r1;
+        avx2_load(pblocks, &l0, &r0);
+        avx2_load(pblocks + 2 * AVX2_LANES_N, &l1, &r1);
+
+        for (int i = 0; i < ROUND_N; i += 2)
+        {
+            __m256i p0 = _mm256_set1_epi32((int)ctx->P[i]);
+            __m256i p1 = _mm256_set1_epi32((int)ctx->P[i + 1]);
+            l0 = _mm256_xor_si256(l0, p0);
+            l1 = _mm256_xor_si256(l1, p0);
+            r0 = _mm256_xor_si256(r0, _mm256_xor_si256(avx2_F(ctx, l0), p1));
+            r1 = _mm256_xor_si256(r1, _mm256_xor_si256(avx2_F(ctx, l1), p1));
+            l0 = _mm256_xor_si256(l0, avx2_F(ctx, r0));
+            l1 = _mm256_xor_si256(l1, avx2_F(ctx, r1));
+        }
+
+        __m256i pl = _mm256_set1_epi32((int)ctx->P[ROUND_N + 1]);
+        __m256i pr = _mm256_set1_epi32((int)ctx->P[ROUND_N]);
+        avx2_store(pblocks, _mm256_xor_si256(r0, pl), _mm256_xor_si256(l0, pr));
+        avx2_store(pblocks + 2 * AVX2_LANES_N, _mm256_xor_si256(r1, pl), _mm256_xor_si256(l1, pr));
+    }
+    return processed;
+}
+
+AVX2_TARGET size_t blowfish_avx2_decrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
+{
+    size_t processed = 0;
+    // two independent groups to hide gathers latency
+    for (; processed + 2 * AVX2_LANES_N <= blocks_n; processed += 2 * AVX2_LANES_N, pblocks += 4 * AVX2_LANES_N)
+    {
+        __m256i l0, r0, l1, r1;
+        avx2_load(pblocks, &l0, &r0);
+        avx2_load(pblocks + 2 * AVX2_LANES_N, &l1, &r1);
+
+        for (int i = ROUND_N + 1; i > 1; i -= 2)
+        {
+            __m256i p0 = _mm256_set1_epi32((int)ctx->P[i]);
+            __m256i p1 = _mm256_set1_epi32((int)ctx->P[i - 1]);
+            l0 = _mm256_xor_si256(l0, p0);
+            l1 = _mm256_xor_si256(l1, p0);
+            r0 = _mm256_xor_si256(r0, _mm256_xor_si256(avx2_F(ctx, l0), p1));
+            r1 = _mm256_xor_si256(r1, _mm256_xor_si256(avx2_F(ctx, l1), p1));
+            l0 = _mm256_xor_si256(l0, avx2_F(ctx, r0));
+            l1 = _mm256_xor_si256(l1, avx2_F(ctx, r1));
+        }
+
+        __m256i pl = _mm256_set1_epi32((int)ctx->P[0]);
+        __m256i pr = _mm256_set1_epi32((int)ctx->P[1]);
+        avx2_store(pblocks, _mm256_xor_si256(r0, pl), _mm256_xor_si256(l0, pr));
+        avx2_store(pblocks + 2 * AVX2_LANES_N, _mm256_xor_si256(r1, pl), _mm256_xor_si256(l1, pr));
+    }
+    return processed;
+}
+
+#else // x86_64
+
+BOOL blowfish_avx2_is_supported(void)
+{
+    return false;
+}
+
+size_t blowfish_avx2_encrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
+{
+    return 0;
+}
+
+size_t blowfish_avx2_decrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n)
+{
+    return 0;
+}
+
+#endif
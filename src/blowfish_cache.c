@@ -0,0 +1,148 @@
+#include <server_clib/blowfish_cache.h>
+#include <server_clib/hash.h>
+
+static uint64_t get_key_digest(const uint8_t* key, const int32_t key_sz)
+{
+    return hash64(key, (size_t)key_sz, 0);
+}
+
+static BOOL is_entry_for_key(const blowfish_cache_entry_t* pentry,
+                             const uint64_t digest,
+                             const uint8_t* key,
+                             const int32_t key_sz)
+{
+    return pentry->key_sz == key_sz && pentry->digest == digest && !memcmp(pentry->key, key, (size_t)key_sz);
+}
+
+BOOL blowfish_cache_init(blowfish_cache_ctx_t* pcache, const size_t capacity)
+{
+    if (!pcache || !capacity)
+        return false;
+
+    bzero(pcache, sizeof(blowfish_cache_ctx_t));
+
+    pcache->sets_n = (capacity + BLOWFISH_CACHE_WAYS_N - 1) / BLOWFISH_CACHE_WAYS_N;
+    pcache->pentries = (blowfish_cache_entry_t*)calloc(pcache->sets_n * BLOWFISH_CACHE_WAYS_N,
+                                                       sizeof(blowfish_cache_entry_t));
+    if (!pcache->pentries)
+        return false;
+
+    if (pthread_rwlock_init(&pcache->lock, NULL) != 0)
+    {
+        free(pcache->pentries);
+        pcache->pentries = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+BOOL blowfish_cache_destroy(blowfish_cache_ctx_t* pcache)
+{
+    if (!pcache || !pcache->pentries)
+        return false;
+
+    pthread_rwlock_destroy(&pcache->lock);
+
+    size_t entries_n = pcache->sets_n * BLOWFISH_CACHE_WAYS_N;
+    for (size_t ci = 0; ci < entries_n; ++ci)
+    {
+        blowfish_destroy(&pcache->pentries[ci].ctx);
+    }
+    bzero(pcache->pentries, entries_n * sizeof(blowfish_cache_entry_t));
+    free(pcache->pentries);
+
+    bzero(pcache, sizeof(blowfish_cache_ctx_t));
+
+    return true;
+}
+
+BOOL blowfish_cache_get(blowfish_cache_ctx_t* pcache, blowfish_ctx_t* ctx, const uint8_t* key, const int32_t keyLen)
+{
+    if (!pcache || !pcache->pentries || !ctx || !key || keyLen <= 0)
+        return false;
+
+    int32_t key_sz = SRV_C_MIN(keyLen, (int32_t)BLOWFISH_CACHE_KEY_MAX_SZ);
+    uint64_t digest = get_key_digest(key, key_sz);
+    // high bits are better mixed
+    blowfish_cache_entry_t* pset = pcache->pentries + ((digest >> 32) % pcache->sets_n) * BLOWFISH_CACHE_WAYS_N;
+
+    pthread_rwlock_rdlock(&pcache->lock);
+    for (size_t ci = 0; ci < BLOWFISH_CACHE_WAYS_N; ++ci)
+    {
+        blowfish_cache_entry_t* pentry = &pset[ci];
+        if (is_entry_for_key(pentry, digest, key, key_sz))
+        {
+            memcpy(ctx, &pentry->ctx, sizeof(blowfish_ctx_t));
+            __atomic_store_n(&pentry->tick, __atomic_add_fetch(&pcache->tick, 1, __ATOMIC_RELAXED),
+                             __ATOMIC_RELAXED);
+            pthread_rwlock_unlock(&pcache->lock);
+
+            __atomic_add_fetch(&pcache->hits, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    pthread_rwlock_unlock(&pcache->lock);
+
+    __atomic_add_fetch(&pcache->misses, 1, __ATOMIC_RELAXED);
+
+    // key expansion is out of lock
+    if (!blowfish_init(ctx, (uint8_t*)key, key_sz))
+        return false;
+
+    pthread_rwlock_wrlock(&pcache->lock);
+    blowfish_cache_entry_t* pvictim = NULL;
+    for (size_t ci = 0; ci < BLOWFISH_CACHE_WAYS_N; ++ci)
+    {
+        if (is_entry_for_key(&pset[ci], digest, key, key_sz))
+        {
+            // it was added by other thread
+            pvictim = &pset[ci];
+            break;
+        }
+    }
+    if (!pvictim)
+    {
+        // empty way or the least recently used one
+        pvictim = &pset[0];
+        for (size_t ci = 1; ci < BLOWFISH_CACHE_WAYS_N && pvictim->key_sz; ++ci)
+        {
+            blowfish_cache_entry_t* pentry = &pset[ci];
+            if (!pentry->key_sz || pentry->tick < pvictim->tick)
+                pvictim = pentry;
+        }
+    }
+    pvictim->digest = digest;
+    pvictim->tick = __atomic_add_fetch(&pcache->tick, 1, __ATOMIC_RELAXED);
+    pvictim->key_sz = key_sz;
+    bzero(pvictim->key, sizeof(pvictim->key));
+    memcpy(pvictim->key, key, (size_t)key_sz);
+    memcpy(&pvictim->ctx, ctx, sizeof(blowfish_ctx_t));
+    pthread_rwlock_unlock(&pcache->lock);
+
+    return true;
+}
+
+size_t blowfish_cache_get_capacity(const blowfish_cache_ctx_t* pcache)
+{
+    if (!pcache)
+        return 0;
+
+    return pcache->sets_n * BLOWFISH_CACHE_WAYS_N;
+}
+
+size_t blowfish_cache_get_hits(const blowfish_cache_ctx_t* pcache)
+{
+    if (!pcache)
+        return 0;
+
+    return __atomic_load_n(&pcache->hits, __ATOMIC_RELAXED);
+}
+
+size_t blowfish_cache_get_misses(const blowfish_cache_ctx_t* pcache)
+{
+    if (!pcache)
+        return 0;
+
+    return __atomic_load_n(&pcache->misses, __ATOMIC_RELAXED);
+}
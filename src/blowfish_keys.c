@@ -0,0 +1,228 @@
+#include <server_clib/blowfish_keys.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BLOWFISH_KEYS_MAGIC "BFKS"
+#define BLOWFISH_KEYS_BYTE_ORDER 0x0102
+#define BLOWFISH_KEYS_FOREIGN_BYTE_ORDER 0x0201
+#define BLOWFISH_KEYS_TMP_SUFFIX ".XXXXXX"
+
+_Static_assert(sizeof(blowfish_keys_header_t) <= BLOWFISH_KEYS_HEADER_SZ, "Header size is wrong");
+
+static void init_header(blowfish_keys_header_t* pheader, const size_t ctx_n)
+{
+    bzero(pheader, sizeof(blowfish_keys_header_t));
+    memcpy(pheader->magic, BLOWFISH_KEYS_MAGIC, sizeof(pheader->magic));
+    pheader->version = BLOWFISH_KEYS_VERSION;
+    pheader->byte_order = BLOWFISH_KEYS_BYTE_ORDER;
+    pheader->ctx_sz = (uint32_t)sizeof(blowfish_ctx_t);
+    pheader->ctx_n = (uint64_t)ctx_n;
+}
+
+// return contexts number in blob or -1
+static long check_header(const unsigned char* p_input, const size_t input_sz, BOOL* pforeign)
+{
+    if (!p_input || input_sz < BLOWFISH_KEYS_HEADER_SZ)
+        return -1;
+
+    blowfish_keys_header_t header;
+    memcpy(&header, p_input, sizeof(header));
+
+    if (memcmp(header.magic, BLOWFISH_KEYS_MAGIC, sizeof(header.magic)))
+        return -1;
+
+    BOOL foreign = header.byte_order == BLOWFISH_KEYS_FOREIGN_BYTE_ORDER;
+    if (!foreign && header.byte_order != BLOWFISH_KEYS_BYTE_ORDER)
+        return -1;
+
+    if (foreign)
+    {
+        header.version = __builtin_bswap16(header.version);
+        header.ctx_sz = __builtin_bswap32(header.ctx_sz);
+        header.ctx_n = __builtin_bswap64(header.ctx_n);
+    }
+
+    if (header.version != BLOWFISH_KEYS_VERSION || header.ctx_sz != sizeof(blowfish_ctx_t))
+        return -1;
+
+    if (header.ctx_n > (input_sz - BLOWFISH_KEYS_HEADER_SZ) / sizeof(blowfish_ctx_t))
+        return -1;
+
+    if (pforeign)
+        *pforeign = foreign;
+
+    return (long)header.ctx_n;
+}
+
+size_t blowfish_keys_get_export_length(const size_t ctx_n)
+{
+    return BLOWFISH_KEYS_HEADER_SZ + ctx_n * sizeof(blowfish_ctx_t);
+}
+
+long blowfish_keys_export(const blowfish_ctx_t* pctxs,
+                          const size_t ctx_n,
+                          unsigned char* p_output,
+                          const size_t output_sz)
+{
+    if ((!pctxs && ctx_n) || !p_output)
+        return -1;
+
+    size_t sz = blowfish_keys_get_export_length(ctx_n);
+    if (output_sz < sz)
+        return -1;
+
+    bzero(p_output, BLOWFISH_KEYS_HEADER_SZ);
+    init_header((blowfish_keys_header_t*)p_output, ctx_n);
+    if (ctx_n)
+        memcpy(p_output + BLOWFISH_KEYS_HEADER_SZ, pctxs, ctx_n * sizeof(blowfish_ctx_t));
+
+    return (long)sz;
+}
+
+long blowfish_keys_import(const unsigned char* p_input,
+                          const size_t input_sz,
+                          blowfish_ctx_t* pctxs,
+                          const size_t ctx_n)
+{
+    BOOL foreign = false;
+    long blob_ctx_n = check_header(p_input, input_sz, &foreign);
+    if (blob_ctx_n < 0 || (!pctxs && blob_ctx_n))
+        return -1;
+
+    size_t imported_n = SRV_C_MIN((size_t)blob_ctx_n, ctx_n);
+    if (imported_n)
+        memcpy(pctxs, p_input + BLOWFISH_KEYS_HEADER_SZ, imported_n * sizeof(blowfish_ctx_t));
+
+    if (foreign)
+    {
+        // context is array of uint32_t only
+        uint32_t* pwords = (uint32_t*)pctxs;
+        size_t words_n = imported_n * sizeof(blowfish_ctx_t) / sizeof(uint32_t);
+        for (size_t ci = 0; ci < words_n; ++ci)
+            pwords[ci] = __builtin_bswap32(pwords[ci]);
+    }
+
+    return (long)imported_n;
+}
+
+const blowfish_ctx_t* blowfish_keys_view(const unsigned char* p_input, const size_t input_sz, size_t* pctx_n)
+{
+    BOOL foreign = false;
+    long blob_ctx_n = check_header(p_input, input_sz, &foreign);
+    if (blob_ctx_n < 0 || foreign)
+        return NULL;
+
+    const unsigned char* p_ctxs = p_input + BLOWFISH_KEYS_HEADER_SZ;
+    if ((uintptr_t)p_ctxs % sizeof(uint32_t))
+        return NULL;
+
+    if (pctx_n)
+        *pctx_n = (size_t)blob_ctx_n;
+
+    return (const blowfish_ctx_t*)p_ctxs;
+}
+
+BOOL blowfish_keys_save(const char* path, const blowfish_ctx_t* pctxs, const size_t ctx_n)
+{
+    if (!path || (!pctxs && ctx_n))
+        return false;
+
+    unsigned char header[BLOWFISH_KEYS_HEADER_SZ] = { 0 };
+    init_header((blowfish_keys_header_t*)header, ctx_n);
+
+    // key material is written to owner only temporary file
+    // and renamed to path to not be mapped half-written
+    size_t path_sz = strlen(path);
+    char* tmp_path = (char*)malloc(path_sz + sizeof(BLOWFISH_KEYS_TMP_SUFFIX));
+    if (!tmp_path)
+        return false;
+    memcpy(tmp_path, path, path_sz);
+    memcpy(tmp_path + path_sz, BLOWFISH_KEYS_TMP_SUFFIX, sizeof(BLOWFISH_KEYS_TMP_SUFFIX));
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return false;
+    }
+
+    FILE* f = NULL;
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) != 0 || fchmod(fd, S_IRUSR | S_IWUSR) != 0 || !(f = fdopen(fd, "wb")))
+    {
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+
+    BOOL result = fwrite(header, sizeof(header), 1, f) == 1;
+    if (result && ctx_n)
+        result = fwrite(pctxs, sizeof(blowfish_ctx_t), ctx_n, f) == ctx_n;
+    result = fflush(f) == 0 && result;
+    result = fsync(fd) == 0 && result;
+    result = fclose(f) == 0 && result;
+
+    result = result && rename(tmp_path, path) == 0;
+    if (!result)
+        unlink(tmp_path);
+
+    free(tmp_path);
+
+    return result;
+}
+
+BOOL blowfish_keys_map(blowfish_keys_map_t* pmap, const char* path)
+{
+    if (!pmap || !path)
+        return false;
+
+    bzero(pmap, sizeof(blowfish_keys_map_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < BLOWFISH_KEYS_HEADER_SZ)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t map_sz = (size_t)st.st_size;
+    void* paddr = mmap(NULL, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (paddr == MAP_FAILED)
+        return false;
+
+    size_t ctx_n = 0;
+    const blowfish_ctx_t* pctxs = blowfish_keys_view((const unsigned char*)paddr, map_sz, &ctx_n);
+    if (!pctxs)
+    {
+        munmap(paddr, map_sz);
+        return false;
+    }
+
+    pmap->pmap = paddr;
+    pmap->map_sz = map_sz;
+    pmap->pctxs = (blowfish_ctx_t*)pctxs;
+    pmap->ctx_n = ctx_n;
+
+    return true;
+}
+
+BOOL blowfish_keys_unmap(blowfish_keys_map_t* pmap)
+{
+    if (!pmap || !pmap->pmap)
+        return false;
+
+    BOOL result = munmap(pmap->pmap, pmap->map_sz) == 0;
+
+    bzero(pmap, sizeof(blowfish_keys_map_t));
+
+    return result;
+}
@@ -0,0 +1,172 @@
+#include <server_clib/blowfish_reader.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+BOOL blowfish_reader_open(blowfish_reader_t* preader,
+                          const char* path,
+                          blowfish_ctx_t* ctx,
+                          const unsigned char* p_nonce,
+                          const size_t data_offset,
+                          const size_t cache_pages_n)
+{
+    if (!preader || !path || !ctx || !p_nonce)
+        return false;
+
+    bzero(preader, sizeof(blowfish_reader_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < data_offset)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t map_sz = (size_t)st.st_size;
+    void* paddr = NULL;
+    if (map_sz)
+    {
+        paddr = mmap(NULL, map_sz, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (paddr == MAP_FAILED)
+            paddr = NULL;
+        else
+            madvise(paddr, map_sz, MADV_RANDOM);
+    }
+    close(fd);
+    if (map_sz && !paddr)
+        return false;
+
+    if (cache_pages_n)
+    {
+        preader->pcache = (unsigned char*)malloc(cache_pages_n * BLOWFISH_READER_PAGE_SZ);
+        preader->pcache_tags = (uint64_t*)calloc(cache_pages_n, sizeof(uint64_t));
+        if (!preader->pcache || !preader->pcache_tags)
+        {
+            free(preader->pcache);
+            free(preader->pcache_tags);
+            if (paddr)
+                munmap(paddr, map_sz);
+            bzero(preader, sizeof(blowfish_reader_t));
+            return false;
+        }
+        preader->cache_pages_n = cache_pages_n;
+    }
+
+    preader->ctx = ctx;
+    memcpy(preader->nonce, p_nonce, sizeof(preader->nonce));
+    preader->pmap = paddr;
+    preader->map_sz = map_sz;
+    preader->pdata = (const unsigned char*)paddr + data_offset;
+    preader->data_sz = map_sz - data_offset;
+
+    return true;
+}
+
+BOOL blowfish_reader_close(blowfish_reader_t* preader)
+{
+    if (!preader || !preader->ctx)
+        return false;
+
+    BOOL result = true;
+    if (preader->pmap)
+        result = munmap(preader->pmap, preader->map_sz) == 0;
+
+    if (preader->pcache)
+    {
+        bzero(preader->pcache, preader->cache_pages_n * BLOWFISH_READER_PAGE_SZ);
+        free(preader->pcache);
+        free(preader->pcache_tags);
+    }
+
+    bzero(preader, sizeof(blowfish_reader_t));
+
+    return result;
+}
+
+size_t blowfish_reader_get_length(const blowfish_reader_t* preader)
+{
+    if (!preader)
+        return 0;
+    return preader->data_sz;
+}
+
+static BOOL reader_decrypt(blowfish_reader_t* preader, const uint64_t offset, unsigned char* p_output, const size_t sz)
+{
+    return blowfish_ctr_decrypt(preader->ctx, preader->nonce, offset, preader->pdata + offset, sz, p_output, sz)
+           == (long)sz;
+}
+
+long blowfish_reader_read(blowfish_reader_t* preader, const uint64_t offset, unsigned char* p_output, const size_t output_sz)
+{
+    if (!preader || !preader->ctx || !p_output)
+        return -1;
+
+    if (offset >= preader->data_sz || !output_sz)
+        return 0;
+
+    size_t read_sz = SRV_C_MIN(output_sz, (size_t)(preader->data_sz - offset));
+
+    if (!preader->cache_pages_n)
+        return reader_decrypt(preader, offset, p_output, read_sz) ? (long)read_sz : -1;
+
+    size_t done = 0;
+    while (done < read_sz)
+    {
+        uint64_t pos = offset + done;
+        uint64_t page_i = pos / BLOWFISH_READER_PAGE_SZ;
+        size_t page_pos = (size_t)(pos % BLOWFISH_READER_PAGE_SZ);
+        size_t page_sz = SRV_C_MIN((size_t)BLOWFISH_READER_PAGE_SZ,
+                                   (size_t)(preader->data_sz - page_i * BLOWFISH_READER_PAGE_SZ));
+        size_t chunk_sz = SRV_C_MIN(page_sz - page_pos, read_sz - done);
+
+        size_t slot = (size_t)(page_i % preader->cache_pages_n);
+        unsigned char* ppage = preader->pcache + slot * BLOWFISH_READER_PAGE_SZ;
+        if (preader->pcache_tags[slot] == page_i + 1)
+        {
+            ++preader->hits;
+        }
+        else
+        {
+            ++preader->misses;
+            // whole pages of long reads don't evict cached ones
+            if (chunk_sz == page_sz)
+            {
+                if (!reader_decrypt(preader, pos, p_output + done, chunk_sz))
+                    return -1;
+                done += chunk_sz;
+                continue;
+            }
+
+            preader->pcache_tags[slot] = 0;
+            if (!reader_decrypt(preader, page_i * BLOWFISH_READER_PAGE_SZ, ppage, page_sz))
+                return -1;
+            preader->pcache_tags[slot] = page_i + 1;
+        }
+
+        memcpy(p_output + done, ppage + page_pos, chunk_sz);
+        done += chunk_sz;
+    }
+
+    return (long)read_sz;
+}
+
+size_t blowfish_reader_get_hits(const blowfish_reader_t* preader)
+{
+    if (!preader)
+        return 0;
+    return preader->hits;
+}
+
+size_t blowfish_reader_get_misses(const blowfish_reader_t* preader)
+{
+    if (!preader)
+        return 0;
+    return preader->misses;
+}
@@ -0,0 +1,178 @@
+#include <server_clib/chacha20.h>
+
+#include "priv_chacha20.h"
+
+#define DOUBLE_ROUND_N 10
+#define CHACHA20_COUNTER_END ((uint64_t)1 << 32)
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d)                                                                                      \
+    a += b;                                                                                                            \
+    d = ROTL32(d ^ a, 16);                                                                                             \
+    c += d;                                                                                                            \
+    b = ROTL32(b ^ c, 12);                                                                                             \
+    a += b;                                                                                                            \
+    d = ROTL32(d ^ a, 8);                                                                                              \
+    c += d;                                                                                                            \
+    b = ROTL32(b ^ c, 7);
+
+static uint32_t load_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(uint8_t* p, const uint32_t x)
+{
+    p[0] = (uint8_t)x;
+    p[1] = (uint8_t)(x >> 8);
+    p[2] = (uint8_t)(x >> 16);
+    p[3] = (uint8_t)(x >> 24);
+}
+
+static void keystream_block(const uint32_t* pstate, uint8_t* pblock)
+{
+    uint32_t x[16];
+    memcpy(x, pstate, sizeof(x));
+
+    for (int ci = 0; ci < DOUBLE_ROUND_N; ++ci)
+    {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int ci = 0; ci < 16; ++ci)
+        store_le32(pblock + 4 * ci, x[ci] + pstate[ci]);
+}
+
+BOOL chacha20_init(chacha20_ctx_t* ctx, const uint8_t* key, const uint8_t* p_nonce, const uint32_t counter)
+{
+    if (!ctx || !key || !p_nonce)
+        return false;
+
+    // "expand 32-byte k"
+    ctx->state[0] = 0x61707865;
+    ctx->state[1] = 0x3320646e;
+    ctx->state[2] = 0x79622d32;
+    ctx->state[3] = 0x6b206574;
+    for (int ci = 0; ci < 8; ++ci)
+        ctx->state[4 + ci] = load_le32(key + 4 * ci);
+    ctx->state[12] = counter;
+    for (int ci = 0; ci < 3; ++ci)
+        ctx->state[13 + ci] = load_le32(p_nonce + 4 * ci);
+    ctx->position = 0;
+
+    return true;
+}
+
+BOOL chacha20_destroy(chacha20_ctx_t* ctx)
+{
+    if (!ctx)
+        return false;
+    bzero(ctx, sizeof(chacha20_ctx_t));
+    return true;
+}
+
+static void xor_blocks(uint32_t* pstate, const unsigned char* p_input, unsigned char* p_output, const size_t blocks_n)
+{
+    size_t i = 0;
+
+    if (blocks_n >= 8 && chacha20_avx2_is_supported())
+        i = chacha20_avx2_xor_blocks(pstate, p_input, p_output, blocks_n);
+    pstate[12] += (uint32_t)i;
+
+    size_t done = chacha20_sse2_xor_blocks(pstate, p_input + CHACHA20_BLOCK_SZ * i,
+                                           p_output + CHACHA20_BLOCK_SZ * i, blocks_n - i);
+    pstate[12] += (uint32_t)done;
+    i += done;
+
+    uint8_t keystream[CHACHA20_BLOCK_SZ];
+    for (; i < blocks_n; ++i, ++pstate[12])
+    {
+        keystream_block(pstate, keystream);
+        for (size_t ci = 0; ci < CHACHA20_BLOCK_SZ; ++ci)
+            p_output[CHACHA20_BLOCK_SZ * i + ci] = p_input[CHACHA20_BLOCK_SZ * i + ci] ^ keystream[ci];
+    }
+}
+
+long chacha20_xor(const chacha20_ctx_t* ctx,
+                  const uint64_t offset,
+                  const unsigned char* p_input,
+                  const size_t input_sz,
+                  unsigned char* p_output,
+                  const size_t output_sz)
+{
+    if (!ctx || !p_input || !input_sz || !p_output || !output_sz)
+        return -1;
+
+    size_t sz = SRV_C_MIN(input_sz, output_sz);
+    size_t skip = (size_t)(offset % CHACHA20_BLOCK_SZ);
+
+    // 32-bit block counter should not wrap to not reuse keystream
+    uint64_t blocks_end = (uint64_t)ctx->state[12] + offset / CHACHA20_BLOCK_SZ + sz / CHACHA20_BLOCK_SZ
+                          + (skip + sz % CHACHA20_BLOCK_SZ + CHACHA20_BLOCK_SZ - 1) / CHACHA20_BLOCK_SZ;
+    if (blocks_end > CHACHA20_COUNTER_END)
+        return -1;
+
+    uint32_t state[16];
+    memcpy(state, ctx->state, sizeof(state));
+    state[12] += (uint32_t)(offset / CHACHA20_BLOCK_SZ);
+
+    uint8_t keystream[CHACHA20_BLOCK_SZ];
+    size_t pos = 0;
+
+    // not aligned start
+    if (skip)
+    {
+        keystream_block(state, keystream);
+        ++state[12];
+        for (; pos < sz && skip + pos < CHACHA20_BLOCK_SZ; ++pos)
+            p_output[pos] = p_input[pos] ^ keystream[skip + pos];
+    }
+
+    size_t blocks_n = (sz - pos) / CHACHA20_BLOCK_SZ;
+    xor_blocks(state, p_input + pos, p_output + pos, blocks_n);
+    pos += CHACHA20_BLOCK_SZ * blocks_n;
+
+    if (pos < sz)
+    {
+        keystream_block(state, keystream);
+        for (size_t ci = 0; pos < sz; ++pos, ++ci)
+            p_output[pos] = p_input[pos] ^ keystream[ci];
+    }
+
+    bzero(keystream, sizeof(keystream));
+    bzero(state, sizeof(state));
+
+    return (long)sz;
+}
+
+long chacha20_stream_encrypt(chacha20_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz)
+{
+    if (!ctx)
+        return -1;
+
+    long processed = chacha20_xor(ctx, ctx->position, p_input, input_sz, p_output, output_sz);
+    if (processed > 0)
+        ctx->position += (uint64_t)processed;
+    return processed;
+}
+
+long chacha20_stream_decrypt(chacha20_ctx_t* ctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz)
+{
+    return chacha20_stream_encrypt(ctx, p_input, input_sz, p_output, output_sz);
+}
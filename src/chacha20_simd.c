@@ -0,0 +1,198 @@
+#include "priv_chacha20.h"
+#include "priv_cpu.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define DOUBLE_ROUND_N 10
+#define SSE2_LANES_N 4
+#define AVX2_LANES_N 8
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+BOOL chacha20_avx2_is_supported(void)
+{
+    return cpu_is_supported(CPU_FEATURE_AVX2);
+}
+
+// Every vector keeps the same state word of SSE2_LANES_N/AVX2_LANES_N blocks
+
+#define SSE2_ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+
+#define SSE2_QUARTER_ROUND(a, b, c, d)                                                                                 \
+    a = _mm_add_epi32(a, b);                                                                                           \
+    d = SSE2_ROTL(_mm_xor_si128(d, a), 16);                                                                            \
+    c = _mm_add_epi32(c, d);                                                                                           \
+    b = SSE2_ROTL(_mm_xor_si128(b, c), 12);                                                                            \
+    a = _mm_add_epi32(a, b);                                                                                           \
+    d = SSE2_ROTL(_mm_xor_si128(d, a), 8);                                                                             \
+    c = _mm_add_epi32(c, d);                                                                                           \
+    b = SSE2_ROTL(_mm_xor_si128(b, c), 7);
+
+size_t chacha20_sse2_xor_blocks(const uint32_t* pstate,
+                                const unsigned char* p_input,
+                                unsigned char* p_output,
+                                const size_t blocks_n)
+{
+    const __m128i counter_inc = _mm_set_epi32(3, 2, 1, 0);
+
+    size_t i = 0;
+    for (; i + SSE2_LANES_N <= blocks_n; i += SSE2_LANES_N)
+    {
+        __m128i s[16], x[16];
+        for (int ci = 0; ci < 16; ++ci)
+            s[ci] = _mm_set1_epi32((int)pstate[ci]);
+        s[12] = _mm_add_epi32(_mm_set1_epi32((int)(pstate[12] + (uint32_t)i)), counter_inc);
+        memcpy(x, s, sizeof(x));
+
+        for (int ci = 0; ci < DOUBLE_ROUND_N; ++ci)
+        {
+            SSE2_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+            SSE2_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+            SSE2_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+            SSE2_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+            SSE2_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+            SSE2_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+            SSE2_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+            SSE2_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+        }
+
+        // transpose 4 words x 4 blocks groups to blocks
+        for (int g = 0; g < 4; ++g)
+        {
+            __m128i a = _mm_add_epi32(x[4 * g], s[4 * g]);
+            __m128i b = _mm_add_epi32(x[4 * g + 1], s[4 * g + 1]);
+            __m128i c = _mm_add_epi32(x[4 * g + 2], s[4 * g + 2]);
+            __m128i d = _mm_add_epi32(x[4 * g + 3], s[4 * g + 3]);
+
+            __m128i t0 = _mm_unpacklo_epi32(a, b);
+            __m128i t1 = _mm_unpacklo_epi32(c, d);
+            __m128i t2 = _mm_unpackhi_epi32(a, b);
+            __m128i t3 = _mm_unpackhi_epi32(c, d);
+
+            __m128i blocks[SSE2_LANES_N] = { _mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                                             _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3) };
+            for (int k = 0; k < SSE2_LANES_N; ++k)
+            {
+                size_t pos = CHACHA20_BLOCK_SZ * (i + (size_t)k) + 16 * (size_t)g;
+                __m128i in = _mm_loadu_si128((const __m128i*)(p_input + pos));
+                _mm_storeu_si128((__m128i*)(p_output + pos), _mm_xor_si128(in, blocks[k]));
+            }
+        }
+    }
+    return i;
+}
+
+static inline AVX2_TARGET __m256i avx2_rotl(const __m256i x, const int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+// rotations by bytes are shuffles
+#define AVX2_QUARTER_ROUND(a, b, c, d)                                                                                 \
+    a = _mm256_add_epi32(a, b);                                                                                        \
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);                                                            \
+    c = _mm256_add_epi32(c, d);                                                                                        \
+    b = avx2_rotl(_mm256_xor_si256(b, c), 12);                                                                         \
+    a = _mm256_add_epi32(a, b);                                                                                        \
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);                                                             \
+    c = _mm256_add_epi32(c, d);                                                                                        \
+    b = avx2_rotl(_mm256_xor_si256(b, c), 7);
+
+AVX2_TARGET size_t chacha20_avx2_xor_blocks(const uint32_t* pstate,
+                                            const unsigned char* p_input,
+                                            unsigned char* p_output,
+                                            const size_t blocks_n)
+{
+    const __m256i counter_inc = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7,
+                                           4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14, 3, 0, 1, 2, 7, 4, 5,
+                                          6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+    size_t i = 0;
+    for (; i + AVX2_LANES_N <= blocks_n; i += AVX2_LANES_N)
+    {
+        __m256i s[16], x[16];
+        for (int ci = 0; ci < 16; ++ci)
+            s[ci] = _mm256_set1_epi32((int)pstate[ci]);
+        s[12] = _mm256_add_epi32(_mm256_set1_epi32((int)(pstate[12] + (uint32_t)i)), counter_inc);
+        memcpy(x, s, sizeof(x));
+
+        for (int ci = 0; ci < DOUBLE_ROUND_N; ++ci)
+        {
+            AVX2_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+            AVX2_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+            AVX2_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+            AVX2_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+            AVX2_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+            AVX2_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+            AVX2_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+            AVX2_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+        }
+
+        // transpose 4 words x 4 blocks in 128-bit lanes: group g, item k is
+        // (words 4g..4g+3 of block k | the same words of block k + 4)
+        __m256i t[4][4];
+        for (int g = 0; g < 4; ++g)
+        {
+            __m256i a = _mm256_add_epi32(x[4 * g], s[4 * g]);
+            __m256i b = _mm256_add_epi32(x[4 * g + 1], s[4 * g + 1]);
+            __m256i c = _mm256_add_epi32(x[4 * g + 2], s[4 * g + 2]);
+            __m256i d = _mm256_add_epi32(x[4 * g + 3], s[4 * g + 3]);
+
+            __m256i t0 = _mm256_unpacklo_epi32(a, b);
+            __m256i t1 = _mm256_unpacklo_epi32(c, d);
+            __m256i t2 = _mm256_unpackhi_epi32(a, b);
+            __m256i t3 = _mm256_unpackhi_epi32(c, d);
+
+            t[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            t[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            t[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            t[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+
+        for (int k = 0; k < 4; ++k)
+        {
+            __m256i keystream[4] = { _mm256_permute2x128_si256(t[0][k], t[1][k], 0x20),
+                                     _mm256_permute2x128_si256(t[2][k], t[3][k], 0x20),
+                                     _mm256_permute2x128_si256(t[0][k], t[1][k], 0x31),
+                                     _mm256_permute2x128_si256(t[2][k], t[3][k], 0x31) };
+            size_t positions[4] = { CHACHA20_BLOCK_SZ * (i + (size_t)k), CHACHA20_BLOCK_SZ * (i + (size_t)k) + 32,
+                                    CHACHA20_BLOCK_SZ * (i + (size_t)k + 4),
+                                    CHACHA20_BLOCK_SZ * (i + (size_t)k + 4) + 32 };
+            for (int ci = 0; ci < 4; ++ci)
+            {
+                __m256i in = _mm256_loadu_si256((const __m256i*)(p_input + positions[ci]));
+                _mm256_storeu_si256((__m256i*)(p_output + positions[ci]), _mm256_xor_si256(in, keystream[ci]));
+            }
+        }
+    }
+    return i;
+}
+
+#else // x86_64
+
+BOOL chacha20_avx2_is_supported(void)
+{
+    return false;
+}
+
+size_t chacha20_sse2_xor_blocks(const uint32_t* pstate,
+                                const unsigned char* p_input,
+                                unsigned char* p_output,
+                                const size_t blocks_n)
+{
+    return 0;
+}
+
+size_t chacha20_avx2_xor_blocks(const uint32_t* pstate,
+                                const unsigned char* p_input,
+                                unsigned char* p_output,
+                                const size_t blocks_n)
+{
+    return 0;
+}
+
+#endif
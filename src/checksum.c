@@ -0,0 +1,148 @@
+#include "priv_checksum.h"
+#include "priv_cpu.h"
+
+#include <pthread.h>
+#include <string.h>
+
+// reflected polynomials
+#define CRC32_POLY 0xEDB88320u
+#define CRC32C_POLY 0x82F63B78u
+
+typedef struct
+{
+    uint32_t poly;
+    uint32_t table[8][256]; // slicing-by-8 tables
+    uint32_t x2n[32]; // x^(2^n) modulo polynomial for combining
+} crc_tables_t;
+
+static crc_tables_t crc32_tables = { .poly = CRC32_POLY };
+static crc_tables_t crc32c_tables = { .poly = CRC32C_POLY };
+static pthread_once_t crc_tables_once = PTHREAD_ONCE_INIT;
+
+// a * b modulo polynomial (bit-reflected, x^0 is the highest bit)
+static uint32_t crc_multmodp(const crc_tables_t* ptables, uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ ptables->poly : b >> 1;
+    }
+    return p;
+}
+
+static void crc_tables_fill(crc_tables_t* ptables)
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? (c >> 1) ^ ptables->poly : c >> 1;
+        ptables->table[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        for (int k = 1; k < 8; ++k)
+        {
+            uint32_t c = ptables->table[k - 1][n];
+            ptables->table[k][n] = (c >> 8) ^ ptables->table[0][c & 0xff];
+        }
+    }
+
+    uint32_t p = 1u << 30; // x^1
+    ptables->x2n[0] = p;
+    for (int n = 1; n < 32; ++n)
+        ptables->x2n[n] = p = crc_multmodp(ptables, p, p);
+}
+
+static void crc_tables_init(void)
+{
+    crc_tables_fill(&crc32_tables);
+    crc_tables_fill(&crc32c_tables);
+}
+
+static uint32_t crc_slicing8(const crc_tables_t* ptables, uint32_t crc, const unsigned char* p, size_t sz)
+{
+    const uint32_t(*t)[256] = ptables->table;
+
+    for (; sz && ((uintptr_t)p & 7); --sz)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    for (; sz >= 8; p += 8, sz -= 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        w = __builtin_bswap64(w);
+#endif
+        w ^= crc;
+        crc = t[7][w & 0xff] ^ t[6][(w >> 8) & 0xff] ^ t[5][(w >> 16) & 0xff] ^ t[4][(w >> 24) & 0xff]
+              ^ t[3][(w >> 32) & 0xff] ^ t[2][(w >> 40) & 0xff] ^ t[1][(w >> 48) & 0xff] ^ t[0][w >> 56];
+    }
+
+    for (; sz; --sz)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+// x^(n * 2^k) modulo polynomial
+static uint32_t crc_x2nmodp(const crc_tables_t* ptables, uint64_t n, unsigned k)
+{
+    uint32_t p = 1u << 31; // x^0
+    for (; n; n >>= 1, ++k)
+    {
+        if (n & 1)
+            p = crc_multmodp(ptables, ptables->x2n[k & 31], p);
+    }
+    return p;
+}
+
+uint32_t checksum_crc32(const uint32_t crc, const void* p_input, const size_t input_sz)
+{
+    pthread_once(&crc_tables_once, crc_tables_init);
+
+    const unsigned char* p = (const unsigned char*)p_input;
+    uint32_t c = ~crc;
+
+    size_t i = 0;
+    if (input_sz >= 64 && cpu_is_supported(CPU_FEATURE_PCLMUL) && cpu_is_supported(CPU_FEATURE_SSE42))
+        i = crc32_pclmul(&c, p, input_sz);
+
+    return ~crc_slicing8(&crc32_tables, c, p + i, input_sz - i);
+}
+
+uint32_t checksum_crc32c(const uint32_t crc, const void* p_input, const size_t input_sz)
+{
+    pthread_once(&crc_tables_once, crc_tables_init);
+
+    const unsigned char* p = (const unsigned char*)p_input;
+    uint32_t c = ~crc;
+
+    size_t i = 0;
+    if (input_sz >= 8 && cpu_is_supported(CPU_FEATURE_SSE42))
+        i = crc32c_sse42(&c, p, input_sz);
+
+    return ~crc_slicing8(&crc32c_tables, c, p + i, input_sz - i);
+}
+
+uint32_t checksum_crc32_combine(const uint32_t crc_a, const uint32_t crc_b, const uint64_t b_sz)
+{
+    pthread_once(&crc_tables_once, crc_tables_init);
+
+    // shift of A by 8 * b_sz bits
+    return crc_multmodp(&crc32_tables, crc_x2nmodp(&crc32_tables, b_sz, 3), crc_a) ^ crc_b;
+}
+
+uint32_t checksum_crc32c_combine(const uint32_t crc_a, const uint32_t crc_b, const uint64_t b_sz)
+{
+    pthread_once(&crc_tables_once, crc_tables_init);
+
+    return crc_multmodp(&crc32c_tables, crc_x2nmodp(&crc32c_tables, b_sz, 3), crc_a) ^ crc_b;
+}
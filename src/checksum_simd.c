@@ -0,0 +1,113 @@
+#include "priv_checksum.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#define SSE42_TARGET __attribute__((target("sse4.2")))
+
+// Folding by 4x128 bits with carry-less multiplication and Barrett reduction
+// ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel).
+// Constants are for the bit-reflected polynomial 0x04C11DB7
+PCLMUL_TARGET size_t crc32_pclmul(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz)
+{
+    if (input_sz < 64)
+        return 0;
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    const unsigned char* p = p_input;
+    size_t sz = input_sz & ~(size_t)15;
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)*pcrc));
+    p += 64;
+    sz -= 64;
+
+    for (; sz >= 64; p += 64, sz -= 64)
+    {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+    }
+
+    // fold to 128 bits
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+    for (; sz >= 16; p += 16, sz -= 16)
+    {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)p)), x5);
+    }
+
+    // fold to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    *pcrc = (uint32_t)_mm_extract_epi32(x1, 1);
+    return (size_t)(p - p_input);
+}
+
+SSE42_TARGET size_t crc32c_sse42(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz)
+{
+    uint64_t crc = *pcrc;
+
+    size_t i = 0;
+    for (; i + 8 <= input_sz; i += 8)
+    {
+        uint64_t w;
+        __builtin_memcpy(&w, p_input + i, sizeof(w));
+        crc = _mm_crc32_u64(crc, w);
+    }
+    *pcrc = (uint32_t)crc;
+    return i;
+}
+
+#else // x86_64
+
+size_t crc32_pclmul(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz)
+{
+    return 0;
+}
+
+size_t crc32c_sse42(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz)
+{
+    return 0;
+}
+
+#endif
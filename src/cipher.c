@@ -0,0 +1,149 @@
+#include <server_clib/cipher.h>
+
+static long blowfish_encrypt_impl(void* pimpl,
+                                  const unsigned char* p_input,
+                                  const size_t input_sz,
+                                  unsigned char* p_output,
+                                  const size_t output_sz)
+{
+    return blowfish_stream_encrypt((blowfish_ctx_t*)pimpl, p_input, input_sz, p_output, output_sz);
+}
+
+static long blowfish_decrypt_impl(void* pimpl,
+                                  const unsigned char* p_input,
+                                  const size_t input_sz,
+                                  unsigned char* p_output,
+                                  const size_t output_sz)
+{
+    return blowfish_stream_decrypt((blowfish_ctx_t*)pimpl, p_input, input_sz, p_output, output_sz);
+}
+
+static BOOL blowfish_destroy_impl(void* pimpl)
+{
+    return blowfish_destroy((blowfish_ctx_t*)pimpl);
+}
+
+static size_t chacha20_get_output_length(const size_t input_sz)
+{
+    return input_sz;
+}
+
+static long chacha20_encrypt_impl(void* pimpl,
+                                  const unsigned char* p_input,
+                                  const size_t input_sz,
+                                  unsigned char* p_output,
+                                  const size_t output_sz)
+{
+    return chacha20_stream_encrypt((chacha20_ctx_t*)pimpl, p_input, input_sz, p_output, output_sz);
+}
+
+static long chacha20_decrypt_impl(void* pimpl,
+                                  const unsigned char* p_input,
+                                  const size_t input_sz,
+                                  unsigned char* p_output,
+                                  const size_t output_sz)
+{
+    return chacha20_stream_decrypt((chacha20_ctx_t*)pimpl, p_input, input_sz, p_output, output_sz);
+}
+
+static BOOL chacha20_destroy_impl(void* pimpl)
+{
+    return chacha20_destroy((chacha20_ctx_t*)pimpl);
+}
+
+static const cipher_vtable_t blowfish_vtable = { "blowfish", blowfish_get_stream_output_length,
+                                                 blowfish_encrypt_impl, blowfish_decrypt_impl,
+                                                 blowfish_destroy_impl };
+
+static const cipher_vtable_t chacha20_vtable = { "chacha20", chacha20_get_output_length, chacha20_encrypt_impl,
+                                                 chacha20_decrypt_impl, chacha20_destroy_impl };
+
+BOOL cipher_init(cipher_ctx_t* pctx,
+                 const cipher_type_t type,
+                 const uint8_t* key,
+                 const size_t key_sz,
+                 const uint8_t* p_nonce)
+{
+    if (!pctx || !key || !key_sz)
+        return false;
+
+    pctx->pvtable = NULL;
+
+    switch (type)
+    {
+    case CIPHER_BLOWFISH:
+        if (key_sz > INT32_MAX || !blowfish_init(&pctx->impl.blowfish, (uint8_t*)key, (int32_t)key_sz))
+            return false;
+        pctx->pvtable = &blowfish_vtable;
+        break;
+    case CIPHER_CHACHA20:
+        if (key_sz != CHACHA20_KEY_SZ || !chacha20_init(&pctx->impl.chacha20, key, p_nonce, 0))
+            return false;
+        pctx->pvtable = &chacha20_vtable;
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+BOOL cipher_destroy(cipher_ctx_t* pctx)
+{
+    if (!pctx || !pctx->pvtable)
+        return false;
+
+    BOOL result = pctx->pvtable->destroy(&pctx->impl);
+    pctx->pvtable = NULL;
+    return result;
+}
+
+BOOL cipher_get_type_by_name(const char* name, cipher_type_t* ptype)
+{
+    if (!name || !ptype)
+        return false;
+
+    if (!strcmp(name, blowfish_vtable.name))
+        *ptype = CIPHER_BLOWFISH;
+    else if (!strcmp(name, chacha20_vtable.name))
+        *ptype = CIPHER_CHACHA20;
+    else
+        return false;
+    return true;
+}
+
+const char* cipher_get_name(const cipher_ctx_t* pctx)
+{
+    if (!pctx || !pctx->pvtable)
+        return NULL;
+    return pctx->pvtable->name;
+}
+
+size_t cipher_get_output_length(const cipher_ctx_t* pctx, const size_t input_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return 0;
+    return pctx->pvtable->get_output_length(input_sz);
+}
+
+long cipher_encrypt(cipher_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return -1;
+    return pctx->pvtable->encrypt(&pctx->impl, p_input, input_sz, p_output, output_sz);
+}
+
+long cipher_decrypt(cipher_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char* p_output,
+                    const size_t output_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return -1;
+    return pctx->pvtable->decrypt(&pctx->impl, p_input, input_sz, p_output, output_sz);
+}
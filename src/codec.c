@@ -0,0 +1,296 @@
+#include <server_clib/codec.h>
+
+#include <zlib.h>
+#include <limits.h>
+#include <string.h>
+
+static size_t none_get_bound(const size_t input_sz)
+{
+    return input_sz;
+}
+
+static long none_pack_impl(void* pimpl,
+                           const unsigned char* p_input,
+                           const size_t input_sz,
+                           unsigned char* p_output,
+                           const size_t output_sz)
+{
+    (void)pimpl;
+
+    if ((!p_input && input_sz) || (!p_output && input_sz) || output_sz < input_sz || input_sz > LONG_MAX)
+        return -1;
+    if (input_sz)
+        memcpy(p_output, p_input, input_sz);
+    return (long)input_sz;
+}
+
+static BOOL none_destroy_impl(void* pimpl)
+{
+    (void)pimpl;
+    return true;
+}
+
+static size_t zlib_get_bound(const size_t input_sz)
+{
+    return (input_sz > ULONG_MAX) ? 0 : (size_t)compressBound((uLong)input_sz);
+}
+
+static long zlib_pack_impl(void* pimpl,
+                           const unsigned char* p_input,
+                           const size_t input_sz,
+                           unsigned char* p_output,
+                           const size_t output_sz)
+{
+    size_t sz = output_sz;
+    if (!zip_ctx_pack_best_speed((zip_ctx_t*)pimpl, p_input, input_sz, &p_output, &sz, false) || sz > LONG_MAX)
+        return -1;
+    return (long)sz;
+}
+
+// Frames are unpacked without context too
+static long zlib_unpack_impl(void* pimpl,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz)
+{
+    size_t sz = output_sz;
+    BOOL result = (pimpl) ? zip_ctx_unpack((zip_ctx_t*)pimpl, p_input, input_sz, &p_output, &sz, false)
+                          : zip_unpack(p_input, input_sz, &p_output, &sz, false);
+    if (!result || sz > LONG_MAX)
+        return -1;
+    return (long)sz;
+}
+
+static BOOL zlib_destroy_impl(void* pimpl)
+{
+    return zip_ctx_destroy((zip_ctx_t*)pimpl);
+}
+
+static long lz_pack_impl(void* pimpl,
+                         const unsigned char* p_input,
+                         const size_t input_sz,
+                         unsigned char* p_output,
+                         const size_t output_sz)
+{
+    return lz_pack((lz_ctx_t*)pimpl, p_input, input_sz, p_output, output_sz);
+}
+
+// match finder is not used by unpacking
+static long lz_unpack_impl(void* pimpl,
+                           const unsigned char* p_input,
+                           const size_t input_sz,
+                           unsigned char* p_output,
+                           const size_t output_sz)
+{
+    (void)pimpl;
+    return lz_unpack(p_input, input_sz, p_output, output_sz);
+}
+
+static const codec_vtable_t none_vtable = { "none", none_get_bound, none_pack_impl, none_pack_impl,
+                                            none_destroy_impl };
+
+static const codec_vtable_t zlib_vtable = { "zlib", zlib_get_bound, zlib_pack_impl, zlib_unpack_impl,
+                                            zlib_destroy_impl };
+
+static const codec_vtable_t lz_vtable = { "lz", lz_get_bound, lz_pack_impl, lz_unpack_impl, none_destroy_impl };
+
+static const codec_vtable_t* const codec_vtables[CODEC_TYPES_N] = { &none_vtable, &zlib_vtable, &lz_vtable };
+
+BOOL codec_init(codec_ctx_t* pctx, const codec_type_t type)
+{
+    if (!pctx)
+        return false;
+
+    pctx->pvtable = NULL;
+
+    switch (type)
+    {
+    case CODEC_NONE:
+    case CODEC_LZ:
+        break;
+    case CODEC_ZLIB:
+        if (!zip_ctx_init(&pctx->impl.zip))
+            return false;
+        break;
+    default:
+        return false;
+    }
+
+    pctx->pvtable = codec_vtables[type];
+    pctx->type = type;
+    return true;
+}
+
+BOOL codec_destroy(codec_ctx_t* pctx)
+{
+    if (!pctx || !pctx->pvtable)
+        return false;
+
+    BOOL result = pctx->pvtable->destroy(&pctx->impl);
+    pctx->pvtable = NULL;
+    return result;
+}
+
+BOOL codec_get_type_by_name(const char* name, codec_type_t* ptype)
+{
+    if (!name || !ptype)
+        return false;
+
+    for (int type = 0; type < CODEC_TYPES_N; ++type)
+    {
+        if (!strcmp(name, codec_vtables[type]->name))
+        {
+            *ptype = (codec_type_t)type;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* codec_get_name(const codec_ctx_t* pctx)
+{
+    if (!pctx || !pctx->pvtable)
+        return NULL;
+    return pctx->pvtable->name;
+}
+
+size_t codec_get_bound(const codec_ctx_t* pctx, const size_t input_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return 0;
+    return pctx->pvtable->get_bound(input_sz);
+}
+
+long codec_pack(codec_ctx_t* pctx,
+                const unsigned char* p_input,
+                const size_t input_sz,
+                unsigned char* p_output,
+                const size_t output_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return -1;
+    return pctx->pvtable->pack(&pctx->impl, p_input, input_sz, p_output, output_sz);
+}
+
+long codec_unpack(codec_ctx_t* pctx,
+                  const unsigned char* p_input,
+                  const size_t input_sz,
+                  unsigned char* p_output,
+                  const size_t output_sz)
+{
+    if (!pctx || !pctx->pvtable)
+        return -1;
+    return pctx->pvtable->unpack(&pctx->impl, p_input, input_sz, p_output, output_sz);
+}
+
+#define CODEC_FRAME_MAGIC_0 'S'
+#define CODEC_FRAME_MAGIC_1 'C'
+
+static inline void codec_write_u32(unsigned char* p, const uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline uint32_t codec_read_u32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t codec_frame_get_bound(const codec_ctx_t* pctx, const size_t input_sz)
+{
+    size_t bound = codec_get_bound(pctx, input_sz);
+    if (!bound && input_sz)
+        return 0;
+    return CODEC_FRAME_HEADER_SZ + ((bound > input_sz) ? bound : input_sz);
+}
+
+long codec_frame_pack(codec_ctx_t* pctx,
+                      const unsigned char* p_input,
+                      const size_t input_sz,
+                      unsigned char* p_output,
+                      const size_t output_sz)
+{
+    if (!pctx || !pctx->pvtable || (!p_input && input_sz) || !p_output || output_sz < CODEC_FRAME_HEADER_SZ
+        || input_sz > UINT32_MAX)
+        return -1;
+
+    codec_type_t type = pctx->type;
+    unsigned char* p_block = p_output + CODEC_FRAME_HEADER_SZ;
+    const size_t block_sz = output_sz - CODEC_FRAME_HEADER_SZ;
+
+    long packed_sz = -1;
+    if (type != CODEC_NONE && input_sz)
+        packed_sz = pctx->pvtable->pack(&pctx->impl, p_input, input_sz, p_block, block_sz);
+
+    if (packed_sz < 0 || (size_t)packed_sz >= input_sz)
+    {
+        type = CODEC_NONE;
+        packed_sz = none_pack_impl(NULL, p_input, input_sz, p_block, block_sz);
+        if (packed_sz < 0)
+            return -1;
+    }
+
+    p_output[0] = CODEC_FRAME_MAGIC_0;
+    p_output[1] = CODEC_FRAME_MAGIC_1;
+    p_output[2] = (unsigned char)type;
+    p_output[3] = 0;
+    codec_write_u32(p_output + 4, (uint32_t)input_sz);
+    codec_write_u32(p_output + 8, (uint32_t)packed_sz);
+
+    return CODEC_FRAME_HEADER_SZ + packed_sz;
+}
+
+BOOL codec_frame_get_info(const unsigned char* p_input,
+                          const size_t input_sz,
+                          codec_type_t* ptype,
+                          size_t* punpacked_sz,
+                          size_t* pframe_sz)
+{
+    if (!p_input || input_sz < CODEC_FRAME_HEADER_SZ || p_input[0] != CODEC_FRAME_MAGIC_0
+        || p_input[1] != CODEC_FRAME_MAGIC_1 || p_input[2] >= CODEC_TYPES_N || p_input[3])
+        return false;
+
+    const size_t unpacked_sz = codec_read_u32(p_input + 4);
+    const size_t packed_sz = codec_read_u32(p_input + 8);
+    if (p_input[2] == CODEC_NONE && packed_sz != unpacked_sz)
+        return false;
+
+    if (ptype)
+        *ptype = (codec_type_t)p_input[2];
+    if (punpacked_sz)
+        *punpacked_sz = unpacked_sz;
+    if (pframe_sz)
+        *pframe_sz = CODEC_FRAME_HEADER_SZ + packed_sz;
+    return true;
+}
+
+long codec_frame_unpack(codec_ctx_t* pctx,
+                        const unsigned char* p_input,
+                        const size_t input_sz,
+                        unsigned char* p_output,
+                        const size_t output_sz)
+{
+    codec_type_t type;
+    size_t unpacked_sz;
+    size_t frame_sz;
+    if (!codec_frame_get_info(p_input, input_sz, &type, &unpacked_sz, &frame_sz) || frame_sz > input_sz
+        || unpacked_sz > output_sz)
+        return -1;
+
+    const unsigned char* p_block = p_input + CODEC_FRAME_HEADER_SZ;
+    const size_t block_sz = frame_sz - CODEC_FRAME_HEADER_SZ;
+
+    long result;
+    if (pctx && pctx->pvtable && pctx->type == type)
+        result = pctx->pvtable->unpack(&pctx->impl, p_block, block_sz, p_output, unpacked_sz);
+    else
+        result = codec_vtables[type]->unpack(NULL, p_block, block_sz, p_output, unpacked_sz);
+
+    if (result < 0 || (size_t)result != unpacked_sz)
+        return -1;
+    return result;
+}
@@ -0,0 +1,47 @@
+#include "priv_cpu.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+static BOOL cpu_check(const cpu_feature_t feature)
+{
+    __builtin_cpu_init();
+    switch (feature)
+    {
+    case CPU_FEATURE_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case CPU_FEATURE_SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    case CPU_FEATURE_PCLMUL:
+        return __builtin_cpu_supports("pclmul");
+    case CPU_FEATURE_AVX2:
+        return __builtin_cpu_supports("avx2");
+    default:
+        return false;
+    }
+}
+
+BOOL cpu_is_supported(const cpu_feature_t feature)
+{
+    // 0 - not checked yet, 1 - not supported, 2 - supported
+    static int supported[CPU_FEATURES_N];
+
+    if (feature >= CPU_FEATURES_N)
+        return false;
+
+    int result = __atomic_load_n(&supported[feature], __ATOMIC_RELAXED);
+    if (!result)
+    {
+        result = cpu_check(feature) ? 2 : 1;
+        __atomic_store_n(&supported[feature], result, __ATOMIC_RELAXED);
+    }
+    return result == 2;
+}
+
+#else // x86_64
+
+BOOL cpu_is_supported(const cpu_feature_t feature)
+{
+    return false;
+}
+
+#endif
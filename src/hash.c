@@ -0,0 +1,176 @@
+#include <server_clib/hash.h>
+
+#include <string.h>
+
+#define HASH_BLOCK_SZ 48
+#define HASH_TAIL_SZ 16
+
+static const uint64_t hash_secret[4]
+    = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull };
+
+static inline void hash_mum(uint64_t* pa, uint64_t* pb)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*pa * *pb;
+    *pa = (uint64_t)r;
+    *pb = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *pa >> 32, hb = *pb >> 32, la = (uint32_t)*pa, lb = (uint32_t)*pb;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *pa = lo;
+    *pb = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t hash_read8(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint64_t hash_read4(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t hash_init_seed(const uint64_t seed)
+{
+    return seed ^ hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+}
+
+static inline void hash_block(uint64_t* pseed, uint64_t* psee1, uint64_t* psee2, const uint8_t* p)
+{
+    *pseed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ *pseed);
+    *psee1 = hash_mix(hash_read8(p + 16) ^ hash_secret[2], hash_read8(p + 24) ^ *psee1);
+    *psee2 = hash_mix(hash_read8(p + 32) ^ hash_secret[3], hash_read8(p + 40) ^ *psee2);
+}
+
+// Rest of input after 48-bytes blocks (1..48 bytes, or whole input up to 48 bytes).
+// For long input 16 bytes before p are readable
+static uint64_t hash_finish(uint64_t seed, const uint8_t* p, size_t sz, const uint64_t total_sz)
+{
+    uint64_t a, b;
+    if (total_sz <= 16)
+    {
+        // short keys
+        if (sz >= 4)
+        {
+            a = (hash_read4(p) << 32) | hash_read4(p + ((sz >> 3) << 2));
+            b = (hash_read4(p + sz - 4) << 32) | hash_read4(p + sz - 4 - ((sz >> 3) << 2));
+        }
+        else if (sz > 0)
+        {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[sz >> 1] << 8) | p[sz - 1];
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        for (; sz > 16; p += 16, sz -= 16)
+            seed = hash_mix(hash_read8(p) ^ hash_secret[1], hash_read8(p + 8) ^ seed);
+        a = hash_read8(p + sz - 16);
+        b = hash_read8(p + sz - 8);
+    }
+
+    a ^= hash_secret[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ hash_secret[0] ^ total_sz, b ^ hash_secret[1]);
+}
+
+uint64_t hash64(const void* p_input, const size_t input_sz, const uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)p_input;
+    uint64_t s = hash_init_seed(seed);
+
+    size_t sz = input_sz;
+    if (sz > HASH_BLOCK_SZ)
+    {
+        uint64_t see1 = s, see2 = s;
+        for (; sz > HASH_BLOCK_SZ; p += HASH_BLOCK_SZ, sz -= HASH_BLOCK_SZ)
+            hash_block(&s, &see1, &see2, p);
+        s ^= see1 ^ see2;
+    }
+    return hash_finish(s, p, sz, input_sz);
+}
+
+BOOL hash64_stream_init(hash64_stream_ctx_t* pctx, const uint64_t seed)
+{
+    if (!pctx)
+        return false;
+
+    pctx->seed = pctx->see1 = pctx->see2 = hash_init_seed(seed);
+    pctx->total_sz = 0;
+    pctx->buff_sz = 0;
+    return true;
+}
+
+BOOL hash64_stream_update(hash64_stream_ctx_t* pctx, const void* p_input, const size_t input_sz)
+{
+    if (!pctx || (!p_input && input_sz))
+        return false;
+
+    const uint8_t* p = (const uint8_t*)p_input;
+    uint8_t* prest = pctx->buff + HASH_TAIL_SZ;
+    pctx->total_sz += input_sz;
+
+    // block is processed only if there is more input (the last one goes to hash_finish)
+    if (pctx->buff_sz + input_sz <= HASH_BLOCK_SZ)
+    {
+        memcpy(prest + pctx->buff_sz, p, input_sz);
+        pctx->buff_sz += input_sz;
+        return true;
+    }
+
+    size_t pos = 0;
+    if (pctx->buff_sz)
+    {
+        pos = HASH_BLOCK_SZ - pctx->buff_sz;
+        memcpy(prest + pctx->buff_sz, p, pos);
+        hash_block(&pctx->seed, &pctx->see1, &pctx->see2, prest);
+        memcpy(pctx->buff, prest + HASH_BLOCK_SZ - HASH_TAIL_SZ, HASH_TAIL_SZ);
+        pctx->buff_sz = 0;
+    }
+
+    if (input_sz - pos > HASH_BLOCK_SZ)
+    {
+        for (; input_sz - pos > HASH_BLOCK_SZ; pos += HASH_BLOCK_SZ)
+            hash_block(&pctx->seed, &pctx->see1, &pctx->see2, p + pos);
+        memcpy(pctx->buff, p + pos - HASH_TAIL_SZ, HASH_TAIL_SZ);
+    }
+
+    pctx->buff_sz = input_sz - pos;
+    memcpy(prest, p + pos, pctx->buff_sz);
+    return true;
+}
+
+uint64_t hash64_stream_final(const hash64_stream_ctx_t* pctx)
+{
+    if (!pctx)
+        return 0;
+
+    uint64_t s = pctx->seed;
+    if (pctx->total_sz > HASH_BLOCK_SZ)
+        s ^= pctx->see1 ^ pctx->see2;
+    return hash_finish(s, pctx->buff + HASH_TAIL_SZ, pctx->buff_sz, pctx->total_sz);
+}
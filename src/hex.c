@@ -1,29 +1,38 @@
 #include <server_clib/hex.h>
 
+#include "priv_hex.h"
+#include "priv_cpu.h"
+
+static const char hex_abc[] = "0123456789abcdef";
+
 long hex_stream_to_hex(const unsigned char* p_input, const size_t input_sz, char* buff, const size_t buff_sz)
 {
     if (!p_input || !input_sz || !buff || !buff_sz)
         return -1;
 
-    const char hex_abc[] = "0123456789abcdef";
-
-    char* out_pos = buff;
-    char* out_end = out_pos + buff_sz;
+    size_t bytes_n = SRV_C_MIN(input_sz, buff_sz / 2);
 
     size_t i = 0;
-    for (; i < input_sz && out_pos != out_end && ++out_pos != out_end; ++i, ++out_pos)
+    if (bytes_n >= 32 && cpu_is_supported(CPU_FEATURE_AVX2))
+        i = hex_avx2_encode(p_input, bytes_n, buff);
+    if (bytes_n - i >= 16 && cpu_is_supported(CPU_FEATURE_SSSE3))
+        i += hex_ssse3_encode(p_input + i, bytes_n - i, buff + 2 * i);
+
+    for (; i < bytes_n; ++i)
     {
-        *out_pos-- = hex_abc[(p_input[i] & 0x0f)];
-        *out_pos++ = hex_abc[(p_input[i] >> 4)];
+        buff[2 * i] = hex_abc[(p_input[i] >> 4)];
+        buff[2 * i + 1] = hex_abc[(p_input[i] & 0x0f)];
     }
 
-    if (out_pos != out_end)
-        *out_pos = 0;
+    // terminator only for whole input
+    if (bytes_n == input_sz && 2 * bytes_n < buff_sz)
+        buff[2 * bytes_n] = 0;
 
-    return (long)i;
+    return (long)bytes_n;
 }
 
-static unsigned char ch_from_hex(const char c)
+// invalid char is decoded as 0
+static unsigned char ch_from_hex(const char c, BOOL* pvalid)
 {
     if (c >= '0' && c <= '9')
         return (unsigned char)c - '0';
@@ -32,36 +41,247 @@ static unsigned char ch_from_hex(const char c)
     if (c >= 'A' && c <= 'F')
         return (unsigned char)c - 'A' + 10;
 
+    *pvalid = false;
     return 0;
 }
 
-long hex_stream_from_hex(const char* buff, const size_t buff_sz, unsigned char* p_output, const size_t output_sz)
+static long from_hex(const char* buff,
+                     const size_t buff_sz,
+                     unsigned char* p_output,
+                     const size_t output_sz,
+                     size_t* perror_pos)
 {
     if (!p_output || !buff_sz || !buff || !output_sz)
         return -1;
 
-    const char* i = buff;
-    const char* i_end = i + buff_sz;
-    unsigned char* out_pos = p_output;
-    unsigned char* out_end = out_pos + output_sz;
-    while (i != i_end && out_end != out_pos)
+    // pairs of chars only
+    size_t bytes_n = SRV_C_MIN(buff_sz / 2, output_sz);
+
+    // vectorized kernels stop before invalid char for strict mode,
+    // so its offset is found here
+    BOOL strict = perror_pos != NULL;
+    size_t i = 0;
+    if (bytes_n >= 32 && cpu_is_supported(CPU_FEATURE_AVX2))
+        i = hex_avx2_decode(buff, bytes_n, p_output, strict);
+    if (bytes_n - i >= 16 && cpu_is_supported(CPU_FEATURE_SSSE3))
+        i += hex_ssse3_decode(buff + 2 * i, bytes_n - i, p_output + i, strict);
+
+    for (; i < bytes_n; ++i)
     {
-        unsigned char decoded = (unsigned char)(ch_from_hex(*i) << 4);
-        ++i;
-        if (i != i_end)
+        BOOL valid = true;
+        unsigned char decoded = (unsigned char)(ch_from_hex(buff[2 * i], &valid) << 4);
+        decoded |= ch_from_hex(buff[2 * i + 1], &valid);
+        if (!valid && perror_pos)
         {
-            decoded |= ch_from_hex(*i);
-            ++i;
+            BOOL high_valid = true;
+            ch_from_hex(buff[2 * i], &high_valid);
+            *perror_pos = 2 * i + (high_valid ? 1 : 0);
+            return -1;
+        }
+        p_output[i] = decoded;
+    }
+
+    return (long)(2 * bytes_n);
+}
+
+long hex_stream_from_hex(const char* buff, const size_t buff_sz, unsigned char* p_output, const size_t output_sz)
+{
+    return from_hex(buff, buff_sz, p_output, output_sz, NULL);
+}
+
+long hex_stream_from_hex_strict(const char* buff,
+                                const size_t buff_sz,
+                                unsigned char* p_output,
+                                const size_t output_sz,
+                                size_t* perror_pos)
+{
+    size_t error_pos = 0;
+    return from_hex(buff, buff_sz, p_output, output_sz, perror_pos ? perror_pos : &error_pos);
+}
+
+BOOL hex_stream_ctx_init(hex_stream_ctx_t* pctx, const BOOL strict)
+{
+    if (!pctx)
+        return false;
 
-            *out_pos = decoded;
-            ++out_pos;
+    bzero(pctx, sizeof(hex_stream_ctx_t));
+    pctx->strict = strict ? 1 : 0;
+    return true;
+}
+
+size_t hex_stream_ctx_get_output_length(const hex_stream_ctx_t* pctx, const size_t buff_sz)
+{
+    if (!pctx)
+        return 0;
+    return ((pctx->has_carry ? 1 : 0) + buff_sz) / 2;
+}
+
+long hex_stream_ctx_from_hex(hex_stream_ctx_t* pctx,
+                             const char* buff,
+                             const size_t buff_sz,
+                             unsigned char* p_output,
+                             const size_t output_sz,
+                             size_t* perror_pos)
+{
+    if (!pctx || (!buff && buff_sz))
+        return -1;
+
+    size_t bytes_n = hex_stream_ctx_get_output_length(pctx, buff_sz);
+    if (bytes_n && (!p_output || output_sz < bytes_n))
+        return -1;
+
+    size_t error_pos = 0;
+    size_t* perror_pos_ = pctx->strict ? &error_pos : NULL;
+
+    size_t pos = 0;
+    size_t written = 0;
+    if (pctx->has_carry && buff_sz)
+    {
+        const char pair[2] = { pctx->carry, buff[0] };
+        if (from_hex(pair, sizeof(pair), p_output, 1, perror_pos_) < 0)
+        {
+            if (perror_pos)
+                *perror_pos = pctx->position - 1 + error_pos;
+            return -1;
+        }
+        pctx->has_carry = 0;
+        pos = 1;
+        written = 1;
+    }
+
+    size_t pairs_sz = (buff_sz - pos) & ~(size_t)1;
+    if (pairs_sz)
+    {
+        if (from_hex(buff + pos, pairs_sz, p_output + written, pairs_sz / 2, perror_pos_) < 0)
+        {
+            if (perror_pos)
+                *perror_pos = pctx->position + pos + error_pos;
+            return -1;
+        }
+        pos += pairs_sz;
+        written += pairs_sz / 2;
+    }
+
+    if (pos < buff_sz)
+    {
+        pctx->carry = buff[pos];
+        pctx->has_carry = 1;
+    }
+    pctx->position += buff_sz;
+
+    return (long)written;
+}
+
+BOOL hex_stream_ctx_finish(hex_stream_ctx_t* pctx)
+{
+    if (!pctx)
+        return false;
+
+    BOOL result = !pctx->has_carry;
+    pctx->has_carry = 0;
+    pctx->position = 0;
+    return result;
+}
+
+#define HEX_DUMP_ROW_SZ 16
+// offset + 2 spaces, 16 "xx " with extra space in the middle, " |" + ASCII + "|\n"
+#define HEX_DUMP_LINE_MAX_SZ (16 + 2 + 3 * HEX_DUMP_ROW_SZ + 1 + 2 + HEX_DUMP_ROW_SZ + 2)
+#define HEX_DUMP_BATCH_ROWS_N 64
+
+static char* dump_offset(char* pos, const uint64_t offset, const int digits)
+{
+    for (int ci = digits - 1; ci >= 0; --ci)
+        *pos++ = hex_abc[(offset >> (4 * ci)) & 0x0f];
+    return pos;
+}
+
+static char* dump_row(char* pos, const unsigned char* p_input, const size_t sz, const uint64_t offset, const int digits)
+{
+    pos = dump_offset(pos, offset, digits);
+    *pos++ = ' ';
+    *pos++ = ' ';
+
+    for (size_t ci = 0; ci < HEX_DUMP_ROW_SZ; ++ci)
+    {
+        if (ci < sz)
+        {
+            pos[0] = hex_abc[p_input[ci] >> 4];
+            pos[1] = hex_abc[p_input[ci] & 0x0f];
         }
         else
         {
-            --i;
-            break;
+            pos[0] = ' ';
+            pos[1] = ' ';
+        }
+        pos[2] = ' ';
+        pos += 3;
+        if (ci == HEX_DUMP_ROW_SZ / 2 - 1)
+            *pos++ = ' ';
+    }
+
+    *pos++ = ' ';
+    *pos++ = '|';
+    for (size_t ci = 0; ci < sz; ++ci)
+        *pos++ = (p_input[ci] >= 0x20 && p_input[ci] < 0x7f) ? (char)p_input[ci] : '.';
+    *pos++ = '|';
+    *pos++ = '\n';
+    return pos;
+}
+
+// there is space for sz chars and '\0'
+static BOOL dump_reserve(rubber_ctx_t* prubber, const size_t sz)
+{
+    if (rubber_get_rest(prubber) > sz)
+        return true;
+    return rubber_enlarge(prubber, sz + 1 + prubber->chunk_sz) > 0;
+}
+
+long hex_dump(const unsigned char* p_input, const size_t input_sz, const uint64_t offset, rubber_ctx_t* prubber)
+{
+    if ((!p_input && input_sz) || !prubber || !rubber_get(prubber))
+        return -1;
+
+    int digits = ((offset + input_sz) >> 32) ? 16 : 8;
+
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < input_sz)
+    {
+        size_t batch_sz = SRV_C_MIN(input_sz - pos, (size_t)(HEX_DUMP_ROW_SZ * HEX_DUMP_BATCH_ROWS_N));
+        if (!dump_reserve(prubber, HEX_DUMP_BATCH_ROWS_N * HEX_DUMP_LINE_MAX_SZ))
+            return -1;
+
+        char* out_start = rubber_get_pos(prubber);
+        char* out = out_start;
+        for (size_t ci = 0; ci < batch_sz; ci += HEX_DUMP_ROW_SZ)
+        {
+            out = dump_row(out, p_input + pos + ci, SRV_C_MIN((size_t)HEX_DUMP_ROW_SZ, batch_sz - ci), offset + pos + ci,
+                           digits);
         }
+
+        int batch_written = (int)(out - out_start);
+        written += (size_t)batch_written;
+        pos += batch_sz;
+        if (!rubber_pos(prubber, &batch_written))
+            return -1;
+    }
+
+    if (!dump_reserve(prubber, 16 + 1))
+        return -1;
+
+    char* out = rubber_get_pos(prubber);
+    if (input_sz)
+    {
+        char* out_end = dump_offset(out, offset + input_sz, digits);
+        *out_end++ = '\n';
+
+        int tail_written = (int)(out_end - out);
+        written += (size_t)tail_written;
+        if (!rubber_pos(prubber, &tail_written))
+            return -1;
+        out = rubber_get_pos(prubber);
     }
+    *out = 0;
 
-    return i - buff;
+    return (long)written;
 }
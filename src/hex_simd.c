@@ -0,0 +1,141 @@
+#include "priv_hex.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+SSSE3_TARGET size_t hex_ssse3_encode(const unsigned char* p_input, const size_t bytes_n, char* buff)
+{
+    const __m128i hex_abc = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= bytes_n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p_input + i));
+        __m128i hi = _mm_shuffle_epi8(hex_abc, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(hex_abc, _mm_and_si128(x, mask));
+        _mm_storeu_si128((__m128i*)(buff + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(buff + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+AVX2_TARGET size_t hex_avx2_encode(const unsigned char* p_input, const size_t bytes_n, char* buff)
+{
+    const __m256i hex_abc = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+                                             'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+                                             'c', 'd', 'e', 'f');
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= bytes_n; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(p_input + i));
+        __m256i hi = _mm256_shuffle_epi8(hex_abc, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(hex_abc, _mm256_and_si256(x, mask));
+        // unpacking is made inside 128-bit lanes
+        __m256i chars_lo = _mm256_unpacklo_epi8(hi, lo);
+        __m256i chars_hi = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i*)(buff + 2 * i), _mm256_permute2x128_si256(chars_lo, chars_hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(buff + 2 * i + 32), _mm256_permute2x128_si256(chars_lo, chars_hi, 0x31));
+    }
+    return i;
+}
+
+// nibbles of 16 chars and mask of valid ones
+static inline SSSE3_TARGET __m128i ssse3_from_hex(const __m128i c, __m128i* pvalid)
+{
+    const __m128i digits = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i letters = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+    // unsigned x <= n
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+
+    *pvalid = _mm_or_si128(is_digit, is_letter);
+    return _mm_or_si128(_mm_and_si128(is_digit, digits),
+                        _mm_and_si128(is_letter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+}
+
+SSSE3_TARGET size_t hex_ssse3_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict)
+{
+    // (high nibble << 4) + low nibble for every chars pair
+    const __m128i weights = _mm_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 16 <= bytes_n; i += 16)
+    {
+        __m128i valid0, valid1;
+        __m128i n0 = ssse3_from_hex(_mm_loadu_si128((const __m128i*)(buff + 2 * i)), &valid0);
+        __m128i n1 = ssse3_from_hex(_mm_loadu_si128((const __m128i*)(buff + 2 * i + 16)), &valid1);
+
+        if (strict && _mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xFFFF)
+            break;
+
+        __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights), _mm_maddubs_epi16(n1, weights));
+        _mm_storeu_si128((__m128i*)(p_output + i), bytes);
+    }
+    return i;
+}
+
+static inline AVX2_TARGET __m256i avx2_from_hex(const __m256i c, __m256i* pvalid)
+{
+    const __m256i digits = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i letters = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+
+    __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+    __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+
+    *pvalid = _mm256_or_si256(is_digit, is_letter);
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digits),
+                           _mm256_and_si256(is_letter, _mm256_add_epi8(letters, _mm256_set1_epi8(10))));
+}
+
+AVX2_TARGET size_t hex_avx2_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict)
+{
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 32 <= bytes_n; i += 32)
+    {
+        __m256i valid0, valid1;
+        __m256i n0 = avx2_from_hex(_mm256_loadu_si256((const __m256i*)(buff + 2 * i)), &valid0);
+        __m256i n1 = avx2_from_hex(_mm256_loadu_si256((const __m256i*)(buff + 2 * i + 32)), &valid1);
+
+        if (strict && _mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1)
+            break;
+
+        // packing is made inside 128-bit lanes
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights), _mm256_maddubs_epi16(n1, weights));
+        _mm256_storeu_si256((__m256i*)(p_output + i), _mm256_permute4x64_epi64(bytes, 0xD8));
+    }
+    return i;
+}
+
+#else // x86_64
+
+size_t hex_ssse3_encode(const unsigned char* p_input, const size_t bytes_n, char* buff)
+{
+    return 0;
+}
+
+size_t hex_avx2_encode(const unsigned char* p_input, const size_t bytes_n, char* buff)
+{
+    return 0;
+}
+
+size_t hex_ssse3_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict)
+{
+    return 0;
+}
+
+size_t hex_avx2_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,275 @@
+#include <server_clib/lz.h>
+
+#include <string.h>
+
+// Sequence: token (literals number << 4 | match length - LZ_MIN_MATCH), literals number extension,
+// literals, offset (2 bytes LE), match length extension. Extension is 255-bytes run and the rest.
+// The block ends by literals: the last LZ_LAST_LITERALS bytes are not matched and the last match
+// starts LZ_MF_LIMIT bytes before the end at least, so match finder reads 8 bytes without checks
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MF_LIMIT 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_RUN_MASK 15
+// step grows by 1 for every 64 unmatched bytes (incompressible data is passed faster)
+#define LZ_SKIP_TRIGGER 6
+
+static inline uint32_t lz_read4(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(const uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Length of common prefix of p and pmatch (p < plimit)
+static inline size_t lz_count(const unsigned char* p, const unsigned char* pmatch, const unsigned char* plimit)
+{
+    const unsigned char* pstart = p;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    while (p + sizeof(uint64_t) <= plimit)
+    {
+        uint64_t a, b;
+        memcpy(&a, p, sizeof(a));
+        memcpy(&b, pmatch, sizeof(b));
+        if (a != b)
+            return (size_t)(p - pstart) + ((size_t)__builtin_ctzll(a ^ b) >> 3);
+        p += sizeof(uint64_t);
+        pmatch += sizeof(uint64_t);
+    }
+#endif
+    while (p < plimit && *p == *pmatch)
+    {
+        ++p;
+        ++pmatch;
+    }
+    return (size_t)(p - pstart);
+}
+
+static inline size_t lz_get_length_extension_sz(const size_t length)
+{
+    return (length >= LZ_RUN_MASK) ? (length - LZ_RUN_MASK) / 255 + 1 : 0;
+}
+
+static inline unsigned char* lz_write_length_extension(unsigned char* op, size_t length)
+{
+    for (length -= LZ_RUN_MASK; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// return NULL if output is too small
+static unsigned char* lz_write_literals(unsigned char* op,
+                                        const unsigned char* const oend,
+                                        const unsigned char* p_literals,
+                                        const size_t literals_n,
+                                        const size_t match_sz)
+{
+    size_t sequence_sz = 1 + lz_get_length_extension_sz(literals_n) + literals_n;
+    if (match_sz)
+        sequence_sz += 2 + lz_get_length_extension_sz(match_sz - LZ_MIN_MATCH);
+    if ((size_t)(oend - op) < sequence_sz)
+        return NULL;
+
+    unsigned char* ptoken = op++;
+    if (literals_n >= LZ_RUN_MASK)
+    {
+        *ptoken = LZ_RUN_MASK << 4;
+        op = lz_write_length_extension(op, literals_n);
+    }
+    else
+        *ptoken = (unsigned char)(literals_n << 4);
+
+    memcpy(op, p_literals, literals_n);
+    return op + literals_n;
+}
+
+size_t lz_get_bound(const size_t input_sz)
+{
+    return input_sz + input_sz / 255 + 16;
+}
+
+long lz_pack(lz_ctx_t* pctx,
+             const unsigned char* p_input,
+             const size_t input_sz,
+             unsigned char* p_output,
+             const size_t output_sz)
+{
+    if (!pctx || (!p_input && input_sz) || !p_output || !output_sz || input_sz > UINT32_MAX)
+        return -1;
+
+    const unsigned char* ip = p_input;
+    const unsigned char* anchor = p_input;
+    const unsigned char* const iend = p_input + input_sz;
+    unsigned char* op = p_output;
+    unsigned char* const oend = p_output + output_sz;
+
+    if (input_sz > LZ_MF_LIMIT)
+    {
+        const unsigned char* const mflimit = iend - LZ_MF_LIMIT;
+        const unsigned char* const matchlimit = iend - LZ_LAST_LITERALS;
+
+        // zero is a valid position too, candidates are always compared
+        memset(pctx->table, 0, sizeof(pctx->table));
+        ++ip;
+
+        while (ip < mflimit)
+        {
+            const uint32_t sequence = lz_read4(ip);
+            const uint32_t h = lz_hash(sequence);
+            const unsigned char* pmatch = p_input + pctx->table[h];
+            pctx->table[h] = (uint32_t)(ip - p_input);
+
+            if (ip - pmatch > LZ_MAX_OFFSET || lz_read4(pmatch) != sequence)
+            {
+                ip += 1 + ((size_t)(ip - anchor) >> LZ_SKIP_TRIGGER);
+                continue;
+            }
+
+            while (ip > anchor && pmatch > p_input && ip[-1] == pmatch[-1])
+            {
+                --ip;
+                --pmatch;
+            }
+
+            const size_t match_sz = LZ_MIN_MATCH + lz_count(ip + LZ_MIN_MATCH, pmatch + LZ_MIN_MATCH, matchlimit);
+
+            unsigned char* ptoken = op;
+            op = lz_write_literals(op, oend, anchor, (size_t)(ip - anchor), match_sz);
+            if (!op)
+                return -1;
+
+            const size_t offset = (size_t)(ip - pmatch);
+            *op++ = (unsigned char)offset;
+            *op++ = (unsigned char)(offset >> 8);
+
+            if (match_sz - LZ_MIN_MATCH >= LZ_RUN_MASK)
+            {
+                *ptoken |= LZ_RUN_MASK;
+                op = lz_write_length_extension(op, match_sz - LZ_MIN_MATCH);
+            }
+            else
+                *ptoken |= (unsigned char)(match_sz - LZ_MIN_MATCH);
+
+            ip += match_sz;
+            anchor = ip;
+
+            // the end of match is the next likely start
+            if (ip < mflimit)
+                pctx->table[lz_hash(lz_read4(ip - 2))] = (uint32_t)(ip - 2 - p_input);
+        }
+    }
+
+    op = lz_write_literals(op, oend, anchor, (size_t)(iend - anchor), 0);
+    if (!op)
+        return -1;
+
+    return (long)(op - p_output);
+}
+
+static inline BOOL lz_read_length_extension(const unsigned char** pip, const unsigned char* iend, size_t* plength)
+{
+    const unsigned char* ip = *pip;
+    unsigned char b;
+    do
+    {
+        if (ip >= iend)
+            return false;
+        b = *ip++;
+        *plength += b;
+    } while (b == 255);
+
+    *pip = ip;
+    return true;
+}
+
+long lz_unpack(const unsigned char* p_input, const size_t input_sz, unsigned char* p_output, const size_t output_sz)
+{
+    if (!p_input || !input_sz || (!p_output && output_sz))
+        return -1;
+
+    const unsigned char* ip = p_input;
+    const unsigned char* const iend = p_input + input_sz;
+    unsigned char* op = p_output;
+    unsigned char* const oend = p_output + output_sz;
+
+    for (;;)
+    {
+        // block ends by literals, not by match
+        if (ip >= iend)
+            return -1;
+
+        const unsigned token = *ip++;
+
+        size_t literals_n = token >> 4;
+        if (literals_n == LZ_RUN_MASK && !lz_read_length_extension(&ip, iend, &literals_n))
+            return -1;
+        if ((size_t)(iend - ip) < literals_n || (size_t)(oend - op) < literals_n)
+            return -1;
+
+        // short literals are copied by one 16-bytes move if both buffers have space after them
+        if (literals_n <= 16 && iend - ip >= 16 && oend - op >= 16)
+            memcpy(op, ip, 16);
+        else
+            memcpy(op, ip, literals_n);
+        ip += literals_n;
+        op += literals_n;
+
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return -1;
+        const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > (size_t)(op - p_output))
+            return -1;
+
+        size_t match_sz = token & LZ_RUN_MASK;
+        if (match_sz == LZ_RUN_MASK && !lz_read_length_extension(&ip, iend, &match_sz))
+            return -1;
+        match_sz += LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < match_sz)
+            return -1;
+
+        const unsigned char* pmatch = op - offset;
+        unsigned char* const pend = op + match_sz;
+
+        if (offset >= 16 && oend - pend >= 16)
+        {
+            // chunks may overwrite up to 15 bytes after match, they are rewritten by the next sequence
+            do
+            {
+                memcpy(op, pmatch, 16);
+                op += 16;
+                pmatch += 16;
+            } while (op < pend);
+        }
+        else if (oend - pend >= 8)
+        {
+            // short offset is a repeated pattern: the first bytes are copied by one
+            // until distance (multiple of offset) is 8 bytes at least, then by 8-bytes chunks
+            size_t distance = offset;
+            while (distance < 8)
+                distance += offset;
+
+            for (size_t n = 0; n < distance && op < pend; ++n)
+                *op++ = *pmatch++;
+            for (; op < pend; op += 8)
+                memcpy(op, op - distance, 8);
+        }
+        else
+        {
+            while (op < pend)
+                *op++ = *pmatch++;
+        }
+        op = pend;
+    }
+
+    return (long)(op - p_output);
+}
@@ -0,0 +1,67 @@
+#include "priv_parallel.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct
+{
+    parallel_job_ft job_f;
+    void* pctx;
+    size_t jobs_n;
+    size_t next_job;
+} parallel_ctx_t;
+
+static void* parallel_worker(void* arg)
+{
+    parallel_ctx_t* pparallel = (parallel_ctx_t*)arg;
+
+    size_t job_i;
+    while ((job_i = __atomic_fetch_add(&pparallel->next_job, 1, __ATOMIC_RELAXED)) < pparallel->jobs_n)
+        pparallel->job_f(pparallel->pctx, job_i);
+
+    return NULL;
+}
+
+size_t parallel_get_threads_n(const size_t threads_n)
+{
+    if (threads_n)
+        return threads_n;
+
+    long cpu_n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpu_n > 0) ? (size_t)cpu_n : 1;
+}
+
+BOOL parallel_for(const size_t jobs_n, size_t threads_n, parallel_job_ft job_f, void* pctx)
+{
+    if (!job_f)
+        return false;
+
+    if (!jobs_n)
+        return true;
+
+    threads_n = SRV_C_MIN(parallel_get_threads_n(threads_n), jobs_n);
+
+    parallel_ctx_t parallel = { job_f, pctx, jobs_n, 0 };
+
+    pthread_t* pthreads = NULL;
+    size_t started_n = 0;
+    if (threads_n > 1)
+    {
+        pthreads = (pthread_t*)malloc((threads_n - 1) * sizeof(pthread_t));
+        // the rest of jobs is processed by the calling thread if threads are not available
+        for (; pthreads && started_n < threads_n - 1; ++started_n)
+        {
+            if (pthread_create(&pthreads[started_n], NULL, parallel_worker, &parallel) != 0)
+                break;
+        }
+    }
+
+    parallel_worker(&parallel);
+
+    for (size_t ci = 0; ci < started_n; ++ci)
+        pthread_join(pthreads[ci], NULL);
+
+    free(pthreads);
+
+    return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <server_clib/base64.h>
+
+// Vectorized kernels for whole groups (3 bytes <-> 4 chars).
+// They read and write whole vectors inside groups_n groups, so the last groups are left for scalar code.
+// Decoding stops before vector with any char out of alphabet (padding too).
+// They return processed groups number
+
+size_t base64_ssse3_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url);
+size_t base64_avx2_encode(const unsigned char* p_input, const size_t groups_n, char* buff, const BOOL url);
+size_t base64_ssse3_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url);
+size_t base64_avx2_decode(const char* buff, const size_t groups_n, unsigned char* p_output, const BOOL url);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <server_clib/blowfish.h>
+
+// Vectorized kernels for blocks in blowfish_encrypt_blocks format.
+// They return processed blocks number (multiple of lanes number)
+
+BOOL blowfish_avx2_is_supported(void);
+size_t blowfish_avx2_encrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n);
+size_t blowfish_avx2_decrypt_blocks(const blowfish_ctx_t* ctx, uint32_t* pblocks, const size_t blocks_n);
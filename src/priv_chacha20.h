@@ -0,0 +1,17 @@
+#pragma once
+
+#include <server_clib/chacha20.h>
+
+// Vectorized kernels XOR blocks_n blocks of input by keystream
+// (pstate[12] is counter of the first block).
+// They return processed blocks number (multiple of lanes number)
+
+BOOL chacha20_avx2_is_supported(void);
+size_t chacha20_sse2_xor_blocks(const uint32_t* pstate,
+                                const unsigned char* p_input,
+                                unsigned char* p_output,
+                                const size_t blocks_n);
+size_t chacha20_avx2_xor_blocks(const uint32_t* pstate,
+                                const unsigned char* p_input,
+                                unsigned char* p_output,
+                                const size_t blocks_n);
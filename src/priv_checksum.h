@@ -0,0 +1,10 @@
+#pragma once
+
+#include <server_clib/checksum.h>
+
+// Vectorized kernels. crc is internal (inverted) state, it is updated in place.
+// They return processed bytes number: crc32_pclmul needs at least 64 bytes and processes multiple of 16 bytes,
+// crc32c_sse42 processes multiple of 8 bytes
+
+size_t crc32_pclmul(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz);
+size_t crc32c_sse42(uint32_t* pcrc, const unsigned char* p_input, const size_t input_sz);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <server_clib/common.h>
+
+typedef enum
+{
+    CPU_FEATURE_SSSE3 = 0,
+    CPU_FEATURE_SSE42,
+    CPU_FEATURE_PCLMUL,
+    CPU_FEATURE_AVX2,
+    CPU_FEATURES_N
+} cpu_feature_t;
+
+// Runtime check for vectorized kernels (result is cached)
+BOOL cpu_is_supported(const cpu_feature_t feature);
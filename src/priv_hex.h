@@ -0,0 +1,13 @@
+#pragma once
+
+#include <server_clib/hex.h>
+
+// Vectorized kernels. Encoding writes 2 * bytes_n chars without terminator.
+// Decoding reads 2 * bytes_n chars. Invalid chars are decoded as 0 or (if strict is set)
+// decoding stops before vector with invalid char.
+// They return processed bytes number (multiple of vector size)
+
+size_t hex_ssse3_encode(const unsigned char* p_input, const size_t bytes_n, char* buff);
+size_t hex_avx2_encode(const unsigned char* p_input, const size_t bytes_n, char* buff);
+size_t hex_ssse3_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict);
+size_t hex_avx2_decode(const char* buff, const size_t bytes_n, unsigned char* p_output, const BOOL strict);
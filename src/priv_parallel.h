@@ -0,0 +1,13 @@
+#pragma once
+
+#include <server_clib/common.h>
+
+// job_i is in [0, jobs_n)
+typedef void (*parallel_job_ft)(void* pctx, const size_t job_i);
+
+// Run jobs_n jobs by up to threads_n threads (0 - by online CPU number).
+// The calling thread takes part in the processing. It returns when all jobs are done
+BOOL parallel_for(const size_t jobs_n, size_t threads_n, parallel_job_ft job_f, void* pctx);
+
+// threads_n or online CPU number for 0
+size_t parallel_get_threads_n(const size_t threads_n);
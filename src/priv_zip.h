@@ -0,0 +1,7 @@
+#pragma once
+
+#include <server_clib/rubber.h>
+
+// Free space of rubber (raw data mode) to write sz bytes by one cursor move
+// without enlarging by rubber itself. Rubber size is at least doubled when it is enlarged
+BOOL zip_rubber_reserve(rubber_ctx_t* prubber, const size_t sz);
@@ -1,9 +1,135 @@
 #include <server_clib/zip.h>
+#include <server_clib/rubber.h>
 #include <server_clib/macro.h>
 
+#include "priv_zip.h"
+
 #include <zlib.h>
+#include <limits.h>
+#include <pthread.h>
+
+// Whole buffer processing. zlib counters are 32-bit, so large buffers are passed by parts
+// (as in compress2/uncompress). Dictionary is for inflate (it is requested by stream)
+static int zip_process(z_stream* strm,
+                       int (*zip_process_f)(z_stream*, int),
+                       Bytef* p_output,
+                       uLong* poutput_sz,
+                       const Bytef* p_input,
+                       const uLong input_sz,
+                       const unsigned char* p_dict,
+                       const size_t dict_sz)
+{
+    uLong output_left = *poutput_sz;
+    uLong input_left = input_sz;
+
+    strm->next_in = (z_const Bytef*)p_input;
+    strm->avail_in = 0;
+    strm->next_out = p_output;
+    strm->avail_out = 0;
+
+    int result = Z_OK;
+    do
+    {
+        if (!strm->avail_out)
+        {
+            strm->avail_out = (output_left > UINT_MAX) ? UINT_MAX : (uInt)output_left;
+            output_left -= strm->avail_out;
+        }
+        if (!strm->avail_in)
+        {
+            strm->avail_in = (input_left > UINT_MAX) ? UINT_MAX : (uInt)input_left;
+            input_left -= strm->avail_in;
+        }
+        result = zip_process_f(strm, (input_left) ? Z_NO_FLUSH : Z_FINISH);
+        if (Z_NEED_DICT == result && p_dict)
+            result = inflateSetDictionary(strm, p_dict, (uInt)dict_sz);
+    } while (Z_OK == result);
+
+    *poutput_sz = (uLong)(strm->next_out - p_output);
+    if (Z_STREAM_END == result)
+        return Z_OK;
+    if (Z_NEED_DICT == result)
+        return Z_DATA_ERROR;
+    return result;
+}
+
+static int zip_ctx_compress(zip_ctx_t* pctx,
+                            Bytef* p_output,
+                            uLong* poutput_sz,
+                            const Bytef* p_input,
+                            const uLong input_sz,
+                            const int level)
+{
+    z_stream* strm = (z_stream*)pctx->pdeflate;
+    if (!strm)
+    {
+        strm = (z_stream*)calloc(1, sizeof(z_stream));
+        if (!strm)
+            return Z_MEM_ERROR;
+        if (Z_OK != deflateInit(strm, level))
+        {
+            free(strm);
+            return Z_MEM_ERROR;
+        }
+        pctx->pdeflate = strm;
+        pctx->level = level;
+    }
+    else
+    {
+        if (Z_OK != deflateReset(strm))
+            return Z_STREAM_ERROR;
+        // there is no pending input after reset so parameters are changed without flush
+        if (pctx->level != level)
+        {
+            if (Z_OK != deflateParams(strm, level, Z_DEFAULT_STRATEGY))
+                return Z_STREAM_ERROR;
+            pctx->level = level;
+        }
+    }
+
+    if (pctx->p_dict && Z_OK != deflateSetDictionary(strm, pctx->p_dict, (uInt)pctx->dict_sz))
+        return Z_STREAM_ERROR;
 
-static BOOL zip_pack(const unsigned char* p_input,
+    return zip_process(strm, deflate, p_output, poutput_sz, p_input, input_sz, NULL, 0);
+}
+
+// inflate state of context ready for new data (NULL for failure)
+static z_stream* zip_ctx_get_inflate(zip_ctx_t* pctx)
+{
+    z_stream* strm = (z_stream*)pctx->pinflate;
+    if (!strm)
+    {
+        strm = (z_stream*)calloc(1, sizeof(z_stream));
+        if (!strm)
+            return NULL;
+        if (Z_OK != inflateInit(strm))
+        {
+            free(strm);
+            return NULL;
+        }
+        pctx->pinflate = strm;
+    }
+    else if (Z_OK != inflateReset(strm))
+        return NULL;
+
+    return strm;
+}
+
+static int zip_ctx_uncompress(zip_ctx_t* pctx,
+                              Bytef* p_output,
+                              uLong* poutput_sz,
+                              const Bytef* p_input,
+                              const uLong input_sz)
+{
+    z_stream* strm = zip_ctx_get_inflate(pctx);
+    if (!strm)
+        return Z_MEM_ERROR;
+
+    return zip_process(strm, inflate, p_output, poutput_sz, p_input, input_sz, pctx->p_dict, pctx->dict_sz);
+}
+
+static BOOL zip_pack(zip_ctx_t* pctx,
+                     const unsigned char* p_input,
                      const size_t input_sz,
                      unsigned char** pp_output,
                      size_t* buff_sz,
@@ -38,7 +164,8 @@ static BOOL zip_pack(const unsigned char* p_input,
 
     uLong sz_zip_predicted = sz_zip;
 
-    int result = compress2((Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz, level);
+    int result = (pctx) ? zip_ctx_compress(pctx, (Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz, level)
+                        : compress2((Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz, level);
 
     if (Z_OK != result)
     {
@@ -70,7 +197,7 @@ BOOL zip_pack_best_speed(const unsigned char* p_input,
                          size_t* output_sz,
                          const BOOL allocate_buffer)
 {
-    return zip_pack(p_input, input_sz, p_output, output_sz, Z_BEST_SPEED, allocate_buffer);
+    return zip_pack(NULL, p_input, input_sz, p_output, output_sz, Z_BEST_SPEED, allocate_buffer);
 }
 
 BOOL zip_pack_best_size(const unsigned char* p_input,
@@ -79,14 +206,15 @@ BOOL zip_pack_best_size(const unsigned char* p_input,
                         size_t* output_sz,
                         const BOOL allocate_buffer)
 {
-    return zip_pack(p_input, input_sz, p_output, output_sz, Z_BEST_COMPRESSION, allocate_buffer);
+    return zip_pack(NULL, p_input, input_sz, p_output, output_sz, Z_BEST_COMPRESSION, allocate_buffer);
 }
 
-BOOL zip_unpack(const unsigned char* p_input,
-                const size_t input_sz,
-                unsigned char** pp_output,
-                size_t* buff_sz,
-                const BOOL allocate_buffer)
+static BOOL zip_unpack_impl(zip_ctx_t* pctx,
+                            const unsigned char* p_input,
+                            const size_t input_sz,
+                            unsigned char** pp_output,
+                            size_t* buff_sz,
+                            const BOOL allocate_buffer)
 {
     if (!p_input || !input_sz || !pp_output || !buff_sz)
         return false;
@@ -94,7 +222,8 @@ BOOL zip_unpack(const unsigned char* p_input,
     if (!allocate_buffer && !*pp_output)
         return false;
 
-    uLong sz_zip_predicted = (uLong)SRV_C_MAX(input_sz, *buff_sz);
+    // preallocated buffer size is known
+    uLong sz_zip_predicted = (allocate_buffer) ? (uLong)SRV_C_MAX(input_sz, *buff_sz) : (uLong)*buff_sz;
 
     unsigned char* p_output = NULL;
 
@@ -110,7 +239,8 @@ BOOL zip_unpack(const unsigned char* p_input,
     }
 
     uLong sz_zip = sz_zip_predicted;
-    int result = uncompress((Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz);
+    int result = (pctx) ? zip_ctx_uncompress(pctx, (Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz)
+                        : uncompress((Bytef*)p_output, &sz_zip, (const Bytef*)p_input, input_sz);
 
     if (Z_OK != result)
     {
@@ -135,3 +265,395 @@ BOOL zip_unpack(const unsigned char* p_input,
         (*pp_output) = p_output;
     return p_output != NULL;
 }
+
+BOOL zip_unpack(const unsigned char* p_input,
+                const size_t input_sz,
+                unsigned char** p_output,
+                size_t* output_sz,
+                const BOOL allocate_buffer)
+{
+    return zip_unpack_impl(NULL, p_input, input_sz, p_output, output_sz, allocate_buffer);
+}
+
+BOOL zip_ctx_init(zip_ctx_t* pctx)
+{
+    if (!pctx)
+        return false;
+
+    pctx->pdeflate = NULL;
+    pctx->pinflate = NULL;
+    pctx->level = Z_DEFAULT_COMPRESSION;
+    pctx->p_dict = NULL;
+    pctx->dict_sz = 0;
+    return true;
+}
+
+BOOL zip_ctx_destroy(zip_ctx_t* pctx)
+{
+    if (!pctx)
+        return false;
+
+    if (pctx->pdeflate)
+    {
+        deflateEnd((z_stream*)pctx->pdeflate);
+        free(pctx->pdeflate);
+        pctx->pdeflate = NULL;
+    }
+    if (pctx->pinflate)
+    {
+        inflateEnd((z_stream*)pctx->pinflate);
+        free(pctx->pinflate);
+        pctx->pinflate = NULL;
+    }
+    return true;
+}
+
+BOOL zip_ctx_pack_best_speed(zip_ctx_t* pctx,
+                             const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char** p_output,
+                             size_t* output_sz,
+                             const BOOL allocate_buffer)
+{
+    if (!pctx)
+        return false;
+
+    return zip_pack(pctx, p_input, input_sz, p_output, output_sz, Z_BEST_SPEED, allocate_buffer);
+}
+
+BOOL zip_ctx_pack_best_size(zip_ctx_t* pctx,
+                            const unsigned char* p_input,
+                            const size_t input_sz,
+                            unsigned char** p_output,
+                            size_t* output_sz,
+                            const BOOL allocate_buffer)
+{
+    if (!pctx)
+        return false;
+
+    return zip_pack(pctx, p_input, input_sz, p_output, output_sz, Z_BEST_COMPRESSION, allocate_buffer);
+}
+
+BOOL zip_ctx_unpack(zip_ctx_t* pctx,
+                    const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char** p_output,
+                    size_t* output_sz,
+                    const BOOL allocate_buffer)
+{
+    if (!pctx)
+        return false;
+
+    return zip_unpack_impl(pctx, p_input, input_sz, p_output, output_sz, allocate_buffer);
+}
+
+BOOL zip_ctx_set_dictionary(zip_ctx_t* pctx, const unsigned char* p_dict, const size_t dict_sz)
+{
+    if (!pctx || (!p_dict && dict_sz) || dict_sz > UINT_MAX)
+        return false;
+
+    pctx->p_dict = (dict_sz) ? p_dict : NULL;
+    pctx->dict_sz = dict_sz;
+    return true;
+}
+
+// temporary context for dictionary
+static BOOL zip_pack_with_dictionary(const unsigned char* p_input,
+                                     const size_t input_sz,
+                                     unsigned char** p_output,
+                                     size_t* output_sz,
+                                     const int level,
+                                     const BOOL allocate_buffer,
+                                     const unsigned char* p_dict,
+                                     const size_t dict_sz)
+{
+    zip_ctx_t ctx;
+    if (!zip_ctx_init(&ctx) || !zip_ctx_set_dictionary(&ctx, p_dict, dict_sz))
+        return false;
+
+    BOOL result = zip_pack(&ctx, p_input, input_sz, p_output, output_sz, level, allocate_buffer);
+    zip_ctx_destroy(&ctx);
+    return result;
+}
+
+BOOL zip_pack_best_speed_with_dictionary(const unsigned char* p_input,
+                                         const size_t input_sz,
+                                         unsigned char** p_output,
+                                         size_t* output_sz,
+                                         const BOOL allocate_buffer,
+                                         const unsigned char* p_dict,
+                                         const size_t dict_sz)
+{
+    return zip_pack_with_dictionary(p_input, input_sz, p_output, output_sz, Z_BEST_SPEED, allocate_buffer, p_dict,
+                                    dict_sz);
+}
+
+BOOL zip_pack_best_size_with_dictionary(const unsigned char* p_input,
+                                        const size_t input_sz,
+                                        unsigned char** p_output,
+                                        size_t* output_sz,
+                                        const BOOL allocate_buffer,
+                                        const unsigned char* p_dict,
+                                        const size_t dict_sz)
+{
+    return zip_pack_with_dictionary(p_input, input_sz, p_output, output_sz, Z_BEST_COMPRESSION, allocate_buffer,
+                                    p_dict, dict_sz);
+}
+
+BOOL zip_unpack_with_dictionary(const unsigned char* p_input,
+                                const size_t input_sz,
+                                unsigned char** p_output,
+                                size_t* output_sz,
+                                const BOOL allocate_buffer,
+                                const unsigned char* p_dict,
+                                const size_t dict_sz)
+{
+    zip_ctx_t ctx;
+    if (!zip_ctx_init(&ctx) || !zip_ctx_set_dictionary(&ctx, p_dict, dict_sz))
+        return false;
+
+    BOOL result = zip_unpack_impl(&ctx, p_input, input_sz, p_output, output_sz, allocate_buffer);
+    zip_ctx_destroy(&ctx);
+    return result;
+}
+
+static pthread_key_t zip_tls_key;
+static pthread_once_t zip_tls_once = PTHREAD_ONCE_INIT;
+static BOOL zip_tls_key_created = false;
+
+static void zip_tls_free(void* p)
+{
+    zip_ctx_destroy((zip_ctx_t*)p);
+    free(p);
+}
+
+static void zip_tls_key_create(void)
+{
+    zip_tls_key_created = 0 == pthread_key_create(&zip_tls_key, zip_tls_free);
+}
+
+// NULL if thread context is not available (plain functions are used then)
+static zip_ctx_t* zip_tls_get(void)
+{
+    pthread_once(&zip_tls_once, zip_tls_key_create);
+    if (!zip_tls_key_created)
+        return NULL;
+
+    zip_ctx_t* pctx = (zip_ctx_t*)pthread_getspecific(zip_tls_key);
+    if (pctx)
+        return pctx;
+
+    pctx = (zip_ctx_t*)malloc(sizeof(zip_ctx_t));
+    if (!pctx)
+        return NULL;
+    zip_ctx_init(pctx);
+    if (pthread_setspecific(zip_tls_key, pctx))
+    {
+        free(pctx);
+        return NULL;
+    }
+    return pctx;
+}
+
+BOOL zip_pack_best_speed_tls(const unsigned char* p_input,
+                             const size_t input_sz,
+                             unsigned char** p_output,
+                             size_t* output_sz,
+                             const BOOL allocate_buffer)
+{
+    return zip_pack(zip_tls_get(), p_input, input_sz, p_output, output_sz, Z_BEST_SPEED, allocate_buffer);
+}
+
+BOOL zip_pack_best_size_tls(const unsigned char* p_input,
+                            const size_t input_sz,
+                            unsigned char** p_output,
+                            size_t* output_sz,
+                            const BOOL allocate_buffer)
+{
+    return zip_pack(zip_tls_get(), p_input, input_sz, p_output, output_sz, Z_BEST_COMPRESSION, allocate_buffer);
+}
+
+BOOL zip_unpack_tls(const unsigned char* p_input,
+                    const size_t input_sz,
+                    unsigned char** p_output,
+                    size_t* output_sz,
+                    const BOOL allocate_buffer)
+{
+    return zip_unpack_impl(zip_tls_get(), p_input, input_sz, p_output, output_sz, allocate_buffer);
+}
+
+void zip_tls_release(void)
+{
+    pthread_once(&zip_tls_once, zip_tls_key_create);
+    if (!zip_tls_key_created)
+        return;
+
+    zip_ctx_t* pctx = (zip_ctx_t*)pthread_getspecific(zip_tls_key);
+    if (pctx)
+    {
+        pthread_setspecific(zip_tls_key, NULL);
+        zip_tls_free(pctx);
+    }
+}
+
+// minimal free space of rubber for the next inflate call
+#define ZIP_RUBBER_MIN_REST 1024
+
+BOOL zip_rubber_reserve(rubber_ctx_t* prubber, const size_t sz)
+{
+    // Geometric growth to copy amortized O(n) bytes by realloc. Rubber enlarges itself by chunk_sz
+    // if its rest is less than chunk_sz / 5 after cursor move, so this part is kept too
+    const size_t reserve_sz = sz + prubber->chunk_sz / 5 + 1;
+    if (rubber_get_rest(prubber) >= reserve_sz)
+        return true;
+    return rubber_enlarge(prubber, SRV_C_MAX(prubber->sz, reserve_sz)) > 0;
+}
+
+static long zip_unpack_to_rubber_impl(zip_ctx_t* pctx,
+                                      const unsigned char* p_input,
+                                      const size_t input_sz,
+                                      rubber_ctx_t* prubber)
+{
+    if (!p_input || !input_sz || !prubber || !rubber_get(prubber) || prubber->string_mode)
+        return -1;
+
+    z_stream stream;
+    z_stream* strm = NULL;
+    if (pctx)
+    {
+        strm = zip_ctx_get_inflate(pctx);
+        if (!strm)
+            return -1;
+    }
+    else
+    {
+        bzero(&stream, sizeof(stream));
+        if (Z_OK != inflateInit(&stream))
+            return -1;
+        strm = &stream;
+    }
+
+    // usual ratio for the first reservation
+    if (!zip_rubber_reserve(prubber, SRV_C_MAX(2 * input_sz, (size_t)ZIP_RUBBER_MIN_REST)))
+    {
+        if (!pctx)
+            inflateEnd(strm);
+        return -1;
+    }
+
+    size_t input_left = input_sz;
+    size_t written = 0;
+    strm->next_in = (z_const Bytef*)p_input;
+    strm->avail_in = 0;
+
+    int result = Z_OK;
+    while (Z_OK == result)
+    {
+        // the rest over chunk_sz / 5 is used without enlarging by rubber itself
+        const size_t keep_sz = prubber->chunk_sz / 5 + 1;
+        if (!zip_rubber_reserve(prubber, ZIP_RUBBER_MIN_REST))
+            break;
+
+        if (!strm->avail_in)
+        {
+            strm->avail_in = (input_left > UINT_MAX) ? UINT_MAX : (uInt)input_left;
+            input_left -= strm->avail_in;
+        }
+
+        // rubber cursor is moved by int
+        uInt output_sz = (uInt)SRV_C_MIN(rubber_get_rest(prubber) - keep_sz, (size_t)INT_MAX);
+        strm->next_out = (Bytef*)rubber_get_pos(prubber);
+        strm->avail_out = output_sz;
+
+        result = inflate(strm, Z_NO_FLUSH);
+        if (Z_NEED_DICT == result && pctx && pctx->p_dict)
+            result = inflateSetDictionary(strm, pctx->p_dict, (uInt)pctx->dict_sz);
+
+        int produced = (int)(output_sz - strm->avail_out);
+        if (produced > 0)
+        {
+            written += (size_t)produced;
+            if (!rubber_pos(prubber, &produced))
+                break;
+        }
+    }
+
+    if (!pctx)
+        inflateEnd(strm);
+
+    return (Z_STREAM_END == result) ? (long)written : -1;
+}
+
+static long zip_pack_to_rubber_impl(zip_ctx_t* pctx,
+                                    const unsigned char* p_input,
+                                    const size_t input_sz,
+                                    rubber_ctx_t* prubber,
+                                    const int level)
+{
+    if (!p_input || !input_sz || !prubber || !rubber_get(prubber) || prubber->string_mode)
+        return -1;
+
+    uLong sz_zip = compressBound(input_sz);
+    if (!sz_zip || sz_zip > INT_MAX || !zip_rubber_reserve(prubber, sz_zip))
+        return -1;
+
+    Bytef* p_output = (Bytef*)rubber_get_pos(prubber);
+    int result = (pctx) ? zip_ctx_compress(pctx, p_output, &sz_zip, (const Bytef*)p_input, input_sz, level)
+                        : compress2(p_output, &sz_zip, (const Bytef*)p_input, input_sz, level);
+    if (Z_OK != result)
+        return -1;
+
+    int written = (int)sz_zip;
+    if (!rubber_pos(prubber, &written))
+        return -1;
+
+    return (long)sz_zip;
+}
+
+long zip_pack_best_speed_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber)
+{
+    return zip_pack_to_rubber_impl(NULL, p_input, input_sz, prubber, Z_BEST_SPEED);
+}
+
+long zip_pack_best_size_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber)
+{
+    return zip_pack_to_rubber_impl(NULL, p_input, input_sz, prubber, Z_BEST_COMPRESSION);
+}
+
+long zip_unpack_to_rubber(const unsigned char* p_input, const size_t input_sz, rubber_ctx_t* prubber)
+{
+    return zip_unpack_to_rubber_impl(NULL, p_input, input_sz, prubber);
+}
+
+long zip_ctx_pack_best_speed_to_rubber(zip_ctx_t* pctx,
+                                       const unsigned char* p_input,
+                                       const size_t input_sz,
+                                       rubber_ctx_t* prubber)
+{
+    if (!pctx)
+        return -1;
+
+    return zip_pack_to_rubber_impl(pctx, p_input, input_sz, prubber, Z_BEST_SPEED);
+}
+
+long zip_ctx_pack_best_size_to_rubber(zip_ctx_t* pctx,
+                                      const unsigned char* p_input,
+                                      const size_t input_sz,
+                                      rubber_ctx_t* prubber)
+{
+    if (!pctx)
+        return -1;
+
+    return zip_pack_to_rubber_impl(pctx, p_input, input_sz, prubber, Z_BEST_COMPRESSION);
+}
+
+long zip_ctx_unpack_to_rubber(zip_ctx_t* pctx,
+                              const unsigned char* p_input,
+                              const size_t input_sz,
+                              rubber_ctx_t* prubber)
+{
+    if (!pctx)
+        return -1;
+
+    return zip_unpack_to_rubber_impl(pctx, p_input, input_sz, prubber);
+}
@@ -0,0 +1,182 @@
+#include <server_clib/zip.h>
+#include <server_clib/macro.h>
+
+#include <stdint.h>
+
+// Simplified COVER algorithm: dictionary is made from segments of samples with the most
+// k-mers shared by different samples. k-mer frequency is the number of samples with it,
+// so content repeated only inside one sample is not selected. Sample shorter than segment
+// is a single segment of its own size
+
+#define DICT_KMER_SZ 8
+#define DICT_SEGMENT_SZ 256
+#define DICT_SEGMENT_STEP 16
+#define DICT_HASH_BITS 20
+#define DICT_HASH_SZ (1u << DICT_HASH_BITS)
+
+typedef struct
+{
+    uint32_t* pfreqs; // samples number by k-mer hash
+    uint32_t* plast_sample; // the last sample + 1 that has been counted for k-mer
+} dict_kmers_t;
+
+typedef struct
+{
+    uint64_t score;
+    const unsigned char* p;
+    size_t sz;
+} dict_segment_t;
+
+static inline uint32_t kmer_hash(const unsigned char* p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return (uint32_t)((w * 0x9E3779B97F4A7C15ull) >> (64 - DICT_HASH_BITS));
+}
+
+static uint64_t segment_score(const dict_kmers_t* pkmers, const unsigned char* p, const size_t sz)
+{
+    uint64_t score = 0;
+    for (size_t ci = 0; ci + DICT_KMER_SZ <= sz; ++ci)
+    {
+        uint32_t freq = pkmers->pfreqs[kmer_hash(p + ci)];
+        // k-mer of one sample is useless
+        if (freq > 1)
+            score += freq;
+    }
+    return score;
+}
+
+// k-mers of selected segment are not counted for other segments
+static void segment_select(const dict_kmers_t* pkmers, const unsigned char* p, const size_t sz)
+{
+    for (size_t ci = 0; ci + DICT_KMER_SZ <= sz; ++ci)
+        pkmers->pfreqs[kmer_hash(p + ci)] = 0;
+}
+
+// max-heap by score
+static void heap_sift_down(dict_segment_t* pheap, const size_t heap_sz, size_t i)
+{
+    for (;;)
+    {
+        size_t largest = i;
+        size_t l = 2 * i + 1, r = 2 * i + 2;
+        if (l < heap_sz && pheap[l].score > pheap[largest].score)
+            largest = l;
+        if (r < heap_sz && pheap[r].score > pheap[largest].score)
+            largest = r;
+        if (largest == i)
+            return;
+        dict_segment_t t = pheap[i];
+        pheap[i] = pheap[largest];
+        pheap[largest] = t;
+        i = largest;
+    }
+}
+
+static size_t build_dictionary(dict_kmers_t* pkmers,
+                               dict_segment_t* pheap,
+                               const unsigned char* const* pp_samples,
+                               const size_t* p_samples_sz,
+                               const size_t samples_n,
+                               unsigned char* p_dict,
+                               const size_t dict_sz)
+{
+    for (size_t ci = 0; ci < samples_n; ++ci)
+    {
+        const unsigned char* p = pp_samples[ci];
+        for (size_t cj = 0; p && cj + DICT_KMER_SZ <= p_samples_sz[ci]; ++cj)
+        {
+            uint32_t h = kmer_hash(p + cj);
+            if (pkmers->plast_sample[h] != (uint32_t)(ci + 1))
+            {
+                pkmers->plast_sample[h] = (uint32_t)(ci + 1);
+                ++pkmers->pfreqs[h];
+            }
+        }
+    }
+
+    size_t heap_sz = 0;
+    for (size_t ci = 0; ci < samples_n; ++ci)
+    {
+        const unsigned char* p = pp_samples[ci];
+        if (!p || p_samples_sz[ci] < DICT_KMER_SZ)
+            continue;
+
+        const size_t segment_sz = SRV_C_MIN(p_samples_sz[ci], (size_t)DICT_SEGMENT_SZ);
+        for (size_t cj = 0; cj + segment_sz <= p_samples_sz[ci]; cj += DICT_SEGMENT_STEP)
+        {
+            pheap[heap_sz].p = p + cj;
+            pheap[heap_sz].sz = segment_sz;
+            pheap[heap_sz].score = segment_score(pkmers, p + cj, segment_sz);
+            ++heap_sz;
+        }
+    }
+    for (size_t ci = heap_sz / 2; ci-- > 0;)
+        heap_sift_down(pheap, heap_sz, ci);
+
+    // Lazy greedy selection: scores only decrease after selection, so the top segment is
+    // selected if its updated score is still not less than the next one.
+    // Dictionary is filled from the end, the best segments are the closest to data
+    size_t pos = dict_sz;
+    while (heap_sz && pos)
+    {
+        // no more shared k-mers
+        if (!pheap[0].score)
+            break;
+
+        uint64_t score = segment_score(pkmers, pheap[0].p, pheap[0].sz);
+
+        if (score < pheap[0].score)
+        {
+            pheap[0].score = score;
+            heap_sift_down(pheap, heap_sz, 0);
+            continue;
+        }
+
+        size_t sz = SRV_C_MIN(pheap[0].sz, pos);
+        pos -= sz;
+        memcpy(p_dict + pos, pheap[0].p + pheap[0].sz - sz, sz);
+        segment_select(pkmers, pheap[0].p, pheap[0].sz);
+
+        pheap[0] = pheap[--heap_sz];
+        heap_sift_down(pheap, heap_sz, 0);
+    }
+
+    // dictionary is at the start of buffer
+    memmove(p_dict, p_dict + pos, dict_sz - pos);
+    return dict_sz - pos;
+}
+
+size_t zip_build_dictionary(const unsigned char* const* pp_samples,
+                            const size_t* p_samples_sz,
+                            const size_t samples_n,
+                            unsigned char* p_dict,
+                            const size_t dict_sz)
+{
+    if (!pp_samples || !p_samples_sz || !samples_n || !p_dict || !dict_sz)
+        return 0;
+
+    size_t segments_n = 0;
+    for (size_t ci = 0; ci < samples_n; ++ci)
+    {
+        if (pp_samples[ci] && p_samples_sz[ci] >= DICT_SEGMENT_SZ)
+            segments_n += (p_samples_sz[ci] - DICT_SEGMENT_SZ) / DICT_SEGMENT_STEP + 1;
+        else if (pp_samples[ci] && p_samples_sz[ci] >= DICT_KMER_SZ)
+            ++segments_n;
+    }
+
+    dict_kmers_t kmers;
+    kmers.pfreqs = (uint32_t*)calloc(DICT_HASH_SZ, sizeof(uint32_t));
+    kmers.plast_sample = (uint32_t*)calloc(DICT_HASH_SZ, sizeof(uint32_t));
+    dict_segment_t* pheap = (dict_segment_t*)malloc(SRV_C_MAX(segments_n, (size_t)1) * sizeof(dict_segment_t));
+
+    size_t result = 0;
+    if (kmers.pfreqs && kmers.plast_sample && pheap)
+        result = build_dictionary(&kmers, pheap, pp_samples, p_samples_sz, samples_n, p_dict, dict_sz);
+
+    free(kmers.pfreqs);
+    free(kmers.plast_sample);
+    free(pheap);
+    return result;
+}
@@ -0,0 +1,512 @@
+#include <server_clib/zip_parallel.h>
+#include <server_clib/checksum.h>
+#include <server_clib/macro.h>
+
+#include "priv_parallel.h"
+#include "priv_zip.h"
+
+#include <zlib.h>
+#include <limits.h>
+#include <pthread.h>
+
+#define ZIP_WINDOW_SZ (32 * 1024)
+#define GZIP_HEADER_SZ 10
+#define GZIP_TRAILER_SZ 8
+// sync flush marker (empty stored block) and pending bits
+#define ZIP_SYNC_FLUSH_SZ 8
+
+// append to rubber in parts that fit to int cursor
+static BOOL rubber_append(rubber_ctx_t* prubber, const unsigned char* p, size_t sz)
+{
+    while (sz)
+    {
+        int part_sz = (int)SRV_C_MIN(sz, (size_t)INT_MAX / 2);
+        if (!zip_rubber_reserve(prubber, (size_t)part_sz))
+            return false;
+
+        memcpy(rubber_get_pos(prubber), p, (size_t)part_sz);
+        p += part_sz;
+        sz -= (size_t)part_sz;
+        if (!rubber_pos(prubber, &part_sz))
+            return false;
+    }
+    return true;
+}
+
+typedef struct
+{
+    const unsigned char* p_input;
+    size_t input_sz;
+    size_t block_sz;
+    size_t blocks_n;
+    size_t workers_n;
+    int level;
+    unsigned char** pblocks; // packed blocks
+    size_t* pblocks_sz;
+    uint32_t* pcrcs;
+    BOOL failed;
+} zip_parallel_pack_t;
+
+static BOOL pack_block(zip_parallel_pack_t* ppack, z_stream* strm, const size_t block_i)
+{
+    const size_t pos = block_i * ppack->block_sz;
+    const size_t sz = SRV_C_MIN(ppack->block_sz, ppack->input_sz - pos);
+    const BOOL last = block_i + 1 == ppack->blocks_n;
+
+    // previous data is dictionary, so blocks are packed independently
+    if (pos)
+    {
+        size_t dict_sz = SRV_C_MIN(pos, (size_t)ZIP_WINDOW_SZ);
+        if (Z_OK != deflateSetDictionary(strm, ppack->p_input + pos - dict_sz, (uInt)dict_sz))
+            return false;
+    }
+
+    size_t bound = deflateBound(strm, sz) + ZIP_SYNC_FLUSH_SZ;
+    unsigned char* p_output = (unsigned char*)malloc(bound);
+    if (!p_output)
+        return false;
+    ppack->pblocks[block_i] = p_output;
+
+    strm->next_in = (z_const Bytef*)(ppack->p_input + pos);
+    strm->avail_in = (uInt)sz;
+    strm->next_out = p_output;
+    strm->avail_out = (uInt)bound;
+
+    // sync flush ends block on byte boundary, so the next one is appended as is
+    int result = deflate(strm, (last) ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((last && Z_STREAM_END != result) || (!last && (Z_OK != result || !strm->avail_out)) || strm->avail_in)
+        return false;
+
+    ppack->pblocks_sz[block_i] = bound - strm->avail_out;
+    ppack->pcrcs[block_i] = checksum_crc32(0, ppack->p_input + pos, sz);
+    return true;
+}
+
+// blocks job_i, job_i + workers_n, ... with the same deflate state
+static void pack_job(void* pctx, const size_t job_i)
+{
+    zip_parallel_pack_t* ppack = (zip_parallel_pack_t*)pctx;
+
+    z_stream strm;
+    bzero(&strm, sizeof(strm));
+    if (Z_OK != deflateInit2(&strm, ppack->level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY))
+    {
+        __atomic_store_n(&ppack->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for (size_t block_i = job_i; block_i < ppack->blocks_n; block_i += ppack->workers_n)
+    {
+        if (__atomic_load_n(&ppack->failed, __ATOMIC_RELAXED))
+            break;
+
+        if ((block_i != job_i && Z_OK != deflateReset(&strm)) || !pack_block(ppack, &strm, block_i))
+        {
+            __atomic_store_n(&ppack->failed, true, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    deflateEnd(&strm);
+}
+
+static BOOL pack_write(const zip_parallel_pack_t* ppack, rubber_ctx_t* prubber, size_t* pwritten)
+{
+    unsigned char header[GZIP_HEADER_SZ] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3 /* Unix */ };
+    if (ppack->level == Z_BEST_COMPRESSION)
+        header[8] = 2;
+    else if (ppack->level == Z_BEST_SPEED)
+        header[8] = 4;
+
+    if (!rubber_append(prubber, header, sizeof(header)))
+        return false;
+    *pwritten += sizeof(header);
+
+    uint32_t crc = 0;
+    for (size_t ci = 0; ci < ppack->blocks_n; ++ci)
+    {
+        if (!rubber_append(prubber, ppack->pblocks[ci], ppack->pblocks_sz[ci]))
+            return false;
+        *pwritten += ppack->pblocks_sz[ci];
+
+        const size_t sz = SRV_C_MIN(ppack->block_sz, ppack->input_sz - ci * ppack->block_sz);
+        crc = checksum_crc32_combine(crc, ppack->pcrcs[ci], sz);
+    }
+
+    unsigned char trailer[GZIP_TRAILER_SZ];
+    for (int ci = 0; ci < 4; ++ci)
+    {
+        trailer[ci] = (unsigned char)(crc >> (8 * ci));
+        trailer[4 + ci] = (unsigned char)((uint64_t)ppack->input_sz >> (8 * ci)); // size modulo 2^32
+    }
+    if (!rubber_append(prubber, trailer, sizeof(trailer)))
+        return false;
+    *pwritten += sizeof(trailer);
+    return true;
+}
+
+long zip_parallel_pack_to_rubber(const unsigned char* p_input,
+                                 const size_t input_sz,
+                                 const int level,
+                                 const size_t block_sz,
+                                 const size_t threads_n,
+                                 rubber_ctx_t* prubber)
+{
+    if ((!p_input && input_sz) || !prubber || !rubber_get(prubber) || prubber->string_mode)
+        return -1;
+
+    if (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)
+        return -1;
+
+    zip_parallel_pack_t pack;
+    bzero(&pack, sizeof(pack));
+    pack.p_input = p_input;
+    pack.input_sz = input_sz;
+    pack.block_sz = (block_sz) ? SRV_C_MIN(block_sz, (size_t)UINT_MAX / 2) : ZIP_PARALLEL_BLOCK_SZ;
+    pack.blocks_n = SRV_C_MAX((input_sz + pack.block_sz - 1) / pack.block_sz, (size_t)1);
+    pack.workers_n = SRV_C_MIN(parallel_get_threads_n(threads_n), pack.blocks_n);
+    pack.level = level;
+
+    pack.pblocks = (unsigned char**)calloc(pack.blocks_n, sizeof(unsigned char*));
+    pack.pblocks_sz = (size_t*)calloc(pack.blocks_n, sizeof(size_t));
+    pack.pcrcs = (uint32_t*)calloc(pack.blocks_n, sizeof(uint32_t));
+
+    size_t written = 0;
+    BOOL result = pack.pblocks && pack.pblocks_sz && pack.pcrcs
+        && parallel_for(pack.workers_n, pack.workers_n, pack_job, &pack) && !pack.failed
+        && pack_write(&pack, prubber, &written);
+
+    if (pack.pblocks)
+    {
+        for (size_t ci = 0; ci < pack.blocks_n; ++ci)
+            free(pack.pblocks[ci]);
+    }
+    free(pack.pblocks);
+    free(pack.pblocks_sz);
+    free(pack.pcrcs);
+
+    return (result) ? (long)written : -1;
+}
+
+// the largest deflate ratio and output limit for member before it is on the chain
+// (for sanity check of size from trailer)
+#define ZIP_MAX_RATIO 1032
+#define ZIP_MAX_SIZE_HINT (64 * 1024 * 1024)
+// output per inflate call (cancellation is checked between calls)
+#define ZIP_UNPACK_STEP_SZ (1024 * 1024)
+
+typedef enum
+{
+    ZIP_MEMBER_PENDING = 0, // not started
+    ZIP_MEMBER_RUNNING,
+    ZIP_MEMBER_STOPPED, // speculative one at output limit (to continue as head)
+    ZIP_MEMBER_UNPACKED,
+    ZIP_MEMBER_FAILED, // not valid or off the chain
+} zip_member_state_t;
+
+typedef struct
+{
+    size_t offset; // member start candidate
+    size_t end; // end of unpacked member
+    size_t size_limit; // output limit while member is not on the chain
+    unsigned char* p_output;
+    size_t output_sz;
+    size_t capacity;
+    z_stream strm;
+    size_t input_left;
+    BOOL started;
+    zip_member_state_t state; // changed under lock
+} zip_member_t;
+
+typedef struct
+{
+    const unsigned char* p_input;
+    size_t input_sz;
+    zip_member_t* pmembers;
+    size_t members_n;
+    size_t window_n; // candidates from the head that can be started
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t head; // first candidate that is not before the chain position
+    size_t next; // next candidate to start
+    size_t pos; // chain position (end of joined members), it is read without lock by running members
+    BOOL failed;
+    rubber_ctx_t* prubber;
+    size_t written;
+} zip_parallel_unpack_t;
+
+static BOOL is_member_header(const unsigned char* p, const size_t sz)
+{
+    // ID1, ID2, CM (deflate) and reserved flags
+    return sz >= GZIP_HEADER_SZ + GZIP_TRAILER_SZ && p[0] == 0x1f && p[1] == 0x8b && p[2] == Z_DEFLATED
+        && !(p[3] & 0xe0);
+}
+
+static void release_member(zip_member_t* pmember)
+{
+    if (pmember->started)
+        inflateEnd(&pmember->strm);
+    pmember->started = false;
+
+    free(pmember->p_output);
+    pmember->p_output = NULL;
+    pmember->output_sz = 0;
+    pmember->capacity = 0;
+}
+
+static BOOL start_member(const zip_parallel_unpack_t* punpack, zip_member_t* pmember)
+{
+    // member before the next candidate has its size in trailer
+    size_t size_hint = 0;
+    const size_t member_i = (size_t)(pmember - punpack->pmembers);
+    size_t next = (member_i + 1 < punpack->members_n) ? punpack->pmembers[member_i + 1].offset : punpack->input_sz;
+    if (next - pmember->offset >= GZIP_HEADER_SZ + GZIP_TRAILER_SZ)
+    {
+        const unsigned char* p = punpack->p_input + next - 4;
+        size_hint = (size_t)p[0] | ((size_t)p[1] << 8) | ((size_t)p[2] << 16) | ((size_t)p[3] << 24);
+        size_hint = SRV_C_MIN(size_hint, (next - pmember->offset) * ZIP_MAX_RATIO);
+        size_hint = SRV_C_MIN(size_hint, (size_t)ZIP_MAX_SIZE_HINT);
+    }
+    pmember->size_limit = size_hint;
+
+    pmember->capacity = SRV_C_MIN(SRV_C_MAX(size_hint + 1, (size_t)ZIP_WINDOW_SZ), (size_t)ZIP_UNPACK_STEP_SZ);
+    pmember->p_output = (unsigned char*)malloc(pmember->capacity);
+    if (!pmember->p_output)
+        return false;
+
+    bzero(&pmember->strm, sizeof(pmember->strm));
+    if (Z_OK != inflateInit2(&pmember->strm, MAX_WBITS | 16))
+        return false;
+    pmember->started = true;
+
+    pmember->strm.next_in = (z_const Bytef*)(punpack->p_input + pmember->offset);
+    pmember->strm.avail_in = 0;
+    pmember->input_left = punpack->input_sz - pmember->offset;
+    return true;
+}
+
+// Member on the chain (head) is unpacked to the end. Speculative one becomes head when the chain
+// reaches it, it is cancelled when the chain passes it and stops when its output passes size from trailer.
+// return new state of member (it is released if it is failed)
+static zip_member_state_t unpack_member(zip_parallel_unpack_t* punpack, zip_member_t* pmember)
+{
+    z_stream* strm = &pmember->strm;
+    int result = Z_OK;
+    while (Z_OK == result)
+    {
+        const size_t pos = __atomic_load_n(&punpack->pos, __ATOMIC_RELAXED);
+        if (pos > pmember->offset || __atomic_load_n(&punpack->failed, __ATOMIC_RELAXED))
+        {
+            result = Z_DATA_ERROR;
+            break;
+        }
+        const BOOL head = pos == pmember->offset;
+        if (!head && pmember->output_sz > pmember->size_limit)
+            return ZIP_MEMBER_STOPPED;
+
+        if (pmember->output_sz == pmember->capacity)
+        {
+            size_t capacity = pmember->capacity * 2;
+            if (!head)
+                capacity = SRV_C_MIN(capacity, pmember->size_limit + 1);
+
+            unsigned char* p_output = (unsigned char*)realloc(pmember->p_output, capacity);
+            if (!p_output)
+            {
+                result = Z_MEM_ERROR;
+                break;
+            }
+            pmember->p_output = p_output;
+            pmember->capacity = capacity;
+        }
+
+        if (!strm->avail_in)
+        {
+            strm->avail_in = (pmember->input_left > UINT_MAX) ? UINT_MAX : (uInt)pmember->input_left;
+            pmember->input_left -= strm->avail_in;
+        }
+
+        uInt output_sz = (uInt)SRV_C_MIN(pmember->capacity - pmember->output_sz, (size_t)ZIP_UNPACK_STEP_SZ);
+        strm->next_out = pmember->p_output + pmember->output_sz;
+        strm->avail_out = output_sz;
+
+        result = inflate(strm, Z_NO_FLUSH);
+        pmember->output_sz += output_sz - strm->avail_out;
+    }
+
+    if (Z_STREAM_END != result)
+    {
+        release_member(pmember);
+        return ZIP_MEMBER_FAILED;
+    }
+
+    pmember->end = (size_t)(strm->next_in - punpack->p_input);
+    inflateEnd(strm);
+    pmember->started = false;
+    return ZIP_MEMBER_UNPACKED;
+}
+
+// Join unpacked members from the head to output. Candidates before the chain position are released
+// (running ones are cancelled and release themselves). It is called under lock
+static void advance_chain(zip_parallel_unpack_t* punpack)
+{
+    while (!punpack->failed)
+    {
+        while (punpack->head < punpack->members_n && punpack->pmembers[punpack->head].offset < punpack->pos)
+        {
+            zip_member_t* pmember = punpack->pmembers + punpack->head++;
+            if (ZIP_MEMBER_RUNNING != pmember->state)
+                release_member(pmember);
+        }
+
+        if (punpack->pos == punpack->input_sz)
+            return;
+
+        zip_member_t* phead = punpack->pmembers + punpack->head;
+        if (punpack->head == punpack->members_n || phead->offset != punpack->pos
+            || ZIP_MEMBER_FAILED == phead->state)
+        {
+            __atomic_store_n(&punpack->failed, true, __ATOMIC_RELAXED);
+            return;
+        }
+        if (ZIP_MEMBER_UNPACKED != phead->state)
+            return;
+
+        if (!rubber_append(punpack->prubber, phead->p_output, phead->output_sz))
+        {
+            __atomic_store_n(&punpack->failed, true, __ATOMIC_RELAXED);
+            return;
+        }
+        punpack->written += phead->output_sz;
+        __atomic_store_n(&punpack->pos, phead->end, __ATOMIC_RELAXED);
+        release_member(phead);
+        ++punpack->head;
+    }
+}
+
+// stopped head is continued first, then candidates of window are started in order. It is called under lock
+static zip_member_t* claim_member(zip_parallel_unpack_t* punpack)
+{
+    zip_member_t* phead = punpack->pmembers + punpack->head;
+    if (ZIP_MEMBER_STOPPED == phead->state)
+        return phead;
+
+    punpack->next = SRV_C_MAX(punpack->next, punpack->head);
+    while (punpack->next < punpack->members_n && punpack->next < punpack->head + punpack->window_n)
+    {
+        zip_member_t* pmember = punpack->pmembers + punpack->next++;
+        if (ZIP_MEMBER_PENDING == pmember->state)
+            return pmember;
+    }
+    return NULL;
+}
+
+// Worker is alive for the whole unpacking. It takes the next candidate while the head is unpacked
+static void unpack_job(void* pctx, const size_t job_i)
+{
+    (void)job_i;
+    zip_parallel_unpack_t* punpack = (zip_parallel_unpack_t*)pctx;
+
+    pthread_mutex_lock(&punpack->lock);
+    while (!punpack->failed && punpack->pos < punpack->input_sz)
+    {
+        zip_member_t* pmember = claim_member(punpack);
+        if (!pmember)
+        {
+            pthread_cond_wait(&punpack->cond, &punpack->lock);
+            continue;
+        }
+        pmember->state = ZIP_MEMBER_RUNNING;
+        pthread_mutex_unlock(&punpack->lock);
+
+        zip_member_state_t state;
+        if (!pmember->started && !start_member(punpack, pmember))
+        {
+            release_member(pmember);
+            state = ZIP_MEMBER_FAILED;
+        }
+        else
+            state = unpack_member(punpack, pmember);
+
+        pthread_mutex_lock(&punpack->lock);
+        pmember->state = state;
+        // chain passed member while it was running
+        if (pmember->offset < punpack->pos)
+            release_member(pmember);
+        advance_chain(punpack);
+        pthread_cond_broadcast(&punpack->cond);
+    }
+    pthread_mutex_unlock(&punpack->lock);
+}
+
+long zip_parallel_unpack_to_rubber(const unsigned char* p_input,
+                                   const size_t input_sz,
+                                   const size_t threads_n,
+                                   rubber_ctx_t* prubber)
+{
+    if (!p_input || !input_sz || !prubber || !rubber_get(prubber) || prubber->string_mode)
+        return -1;
+
+    if (!is_member_header(p_input, input_sz))
+        return -1;
+
+    // Candidates of members start. Signature can be found inside compressed data too,
+    // such candidates fail to unpack or are not on the members chain
+    zip_parallel_unpack_t unpack;
+    bzero(&unpack, sizeof(unpack));
+    unpack.p_input = p_input;
+    unpack.input_sz = input_sz;
+    unpack.prubber = prubber;
+
+    size_t capacity = 0;
+    for (size_t pos = 0; pos < input_sz; ++pos)
+    {
+        const unsigned char* p = (const unsigned char*)memchr(p_input + pos, 0x1f, input_sz - pos);
+        if (!p)
+            break;
+        pos = (size_t)(p - p_input);
+        if (!is_member_header(p, input_sz - pos))
+            continue;
+
+        if (unpack.members_n == capacity)
+        {
+            capacity = SRV_C_MAX(capacity * 2, (size_t)64);
+            zip_member_t* p_after = (zip_member_t*)realloc(unpack.pmembers, capacity * sizeof(zip_member_t));
+            if (!p_after)
+            {
+                free(unpack.pmembers);
+                return -1;
+            }
+            unpack.pmembers = p_after;
+        }
+        bzero(unpack.pmembers + unpack.members_n, sizeof(zip_member_t));
+        unpack.pmembers[unpack.members_n++].offset = pos;
+    }
+
+    if (pthread_mutex_init(&unpack.lock, NULL) != 0)
+    {
+        free(unpack.pmembers);
+        return -1;
+    }
+    if (pthread_cond_init(&unpack.cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&unpack.lock);
+        free(unpack.pmembers);
+        return -1;
+    }
+
+    // Window of candidates from the chain head is unpacked concurrently. The head is on the chain,
+    // the next ones are speculative and stop at output limit to continue later
+    const size_t workers_n = SRV_C_MIN(parallel_get_threads_n(threads_n), unpack.members_n);
+    unpack.window_n = 2 * workers_n;
+    BOOL result = parallel_for(workers_n, workers_n, unpack_job, &unpack) && !unpack.failed
+        && unpack.pos == input_sz;
+
+    for (size_t ci = 0; ci < unpack.members_n; ++ci)
+        release_member(unpack.pmembers + ci);
+    free(unpack.pmembers);
+    pthread_cond_destroy(&unpack.cond);
+    pthread_mutex_destroy(&unpack.lock);
+
+    return (result) ? (long)unpack.written : -1;
+}
@@ -2,33 +2,45 @@
 #include <server_clib/macro.h>
 
 #include <zlib.h>
+#include <stdint.h>
+#include <limits.h>
 
 #define windowBits 15
 #define GZIP_ENCODING 16
 
 static BOOL deflate_init(z_stream* strm)
 {
-    strm->zalloc = Z_NULL;
-    strm->zfree = Z_NULL;
-    strm->opaque = Z_NULL;
     return Z_OK
         == deflateInit2(strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits | GZIP_ENCODING, 8, Z_DEFAULT_STRATEGY);
 }
 
 static BOOL inflate_init(z_stream* strm)
 {
-    strm->zalloc = Z_NULL;
-    strm->zfree = Z_NULL;
-    strm->opaque = Z_NULL;
     return Z_OK == inflateInit2(strm, windowBits | GZIP_ENCODING);
 }
 
-static BOOL init_context(zip_stream_ctx_t* pctx, BOOL (*zip_init_f)(z_stream*))
+// zlib format for dictionary (GZIP format does not support it)
+static BOOL deflate_init_zlib(z_stream* strm)
+{
+    return Z_OK == deflateInit2(strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+}
+
+static BOOL inflate_init_zlib(z_stream* strm)
+{
+    return Z_OK == inflateInit2(strm, windowBits);
+}
+
+static BOOL init_context(zip_stream_ctx_t* pctx, BOOL (*zip_init_f)(z_stream*), const zip_allocator_t* pallocator)
 {
     if (!pctx || !zip_init_f)
         return false;
 
+    if (pallocator && (!pallocator->alloc_f || !pallocator->free_f))
+        return false;
+
     bzero(pctx->z_stream, sizeof(pctx->z_stream));
+    pctx->p_dict = NULL;
+    pctx->dict_sz = 0;
 
     z_stream* strm = NULL;
     if (sizeof(pctx->z_stream) >= sizeof(z_stream))
@@ -41,9 +53,18 @@ static BOOL init_context(zip_stream_ctx_t* pctx, BOOL (*zip_init_f)(z_stream*))
         strm = (z_stream*)malloc(sizeof(z_stream));
         if (!strm)
             return false;
+        bzero(strm, sizeof(z_stream));
         pctx->pz_stream = strm;
     }
 
+    // zlib keeps allocator in stream, Z_NULL is for malloc/free
+    if (pallocator)
+    {
+        strm->zalloc = (alloc_func)pallocator->alloc_f;
+        strm->zfree = (free_func)pallocator->free_f;
+        strm->opaque = pallocator->opaque;
+    }
+
     if (!zip_init_f(strm))
     {
         if (pctx->pz_stream)
@@ -57,24 +78,126 @@ static BOOL init_context(zip_stream_ctx_t* pctx, BOOL (*zip_init_f)(z_stream*))
     return true;
 }
 
+static z_stream* get_z_stream(zip_stream_ctx_t* pctx)
+{
+    if (!pctx)
+        return NULL;
+
+    if (pctx->pz_stream)
+        return (z_stream*)pctx->pz_stream;
+
+    return (z_stream*)pctx->z_stream;
+}
+
 BOOL zip_stream_pack_init(zip_stream_ctx_t* pctx)
 {
-    return init_context(pctx, deflate_init);
+    return init_context(pctx, deflate_init, NULL);
 }
 BOOL zip_stream_unpack_init(zip_stream_ctx_t* pctx)
 {
-    return init_context(pctx, inflate_init);
+    return init_context(pctx, inflate_init, NULL);
+}
+BOOL zip_stream_pack_init_with_allocator(zip_stream_ctx_t* pctx, const zip_allocator_t* pallocator)
+{
+    if (!pallocator)
+        return false;
+    return init_context(pctx, deflate_init, pallocator);
+}
+BOOL zip_stream_unpack_init_with_allocator(zip_stream_ctx_t* pctx, const zip_allocator_t* pallocator)
+{
+    if (!pallocator)
+        return false;
+    return init_context(pctx, inflate_init, pallocator);
 }
 
-static z_stream* get_z_stream(zip_stream_ctx_t* pctx)
+BOOL zip_stream_pack_init_with_dictionary(zip_stream_ctx_t* pctx,
+                                          const unsigned char* p_dict,
+                                          const size_t dict_sz,
+                                          const zip_allocator_t* pallocator)
 {
-    if (!pctx)
+    if (!p_dict || !dict_sz || dict_sz > UINT_MAX)
+        return false;
+
+    if (!init_context(pctx, deflate_init_zlib, pallocator))
+        return false;
+
+    if (Z_OK != deflateSetDictionary(get_z_stream(pctx), p_dict, (uInt)dict_sz))
+    {
+        zip_stream_pack_destroy(pctx);
+        return false;
+    }
+    return true;
+}
+
+BOOL zip_stream_unpack_init_with_dictionary(zip_stream_ctx_t* pctx,
+                                            const unsigned char* p_dict,
+                                            const size_t dict_sz,
+                                            const zip_allocator_t* pallocator)
+{
+    if (!p_dict || !dict_sz || dict_sz > UINT_MAX)
+        return false;
+
+    if (!init_context(pctx, inflate_init_zlib, pallocator))
+        return false;
+
+    // it is set when stream requests it
+    pctx->p_dict = p_dict;
+    pctx->dict_sz = dict_sz;
+    return true;
+}
+
+#define ZIP_FIXED_MEMORY_ALIGN_SZ 16
+
+static void* fixed_memory_alloc(void* opaque, unsigned int items_n, unsigned int item_sz)
+{
+    zip_fixed_memory_t* pmemory = (zip_fixed_memory_t*)opaque;
+
+    size_t sz = (size_t)items_n * item_sz;
+    size_t aligned_sz = (sz + ZIP_FIXED_MEMORY_ALIGN_SZ - 1) & ~(size_t)(ZIP_FIXED_MEMORY_ALIGN_SZ - 1);
+    if (aligned_sz < sz || pmemory->mem_sz - pmemory->used_sz < aligned_sz)
         return NULL;
 
-    if (pctx->pz_stream)
-        return (z_stream*)pctx->pz_stream;
+    void* p = pmemory->pmem + pmemory->used_sz;
+    pmemory->used_sz += aligned_sz;
+    ++pmemory->allocated_n;
+    return p;
+}
 
-    return (z_stream*)pctx->z_stream;
+static void fixed_memory_free(void* opaque, void* p)
+{
+    zip_fixed_memory_t* pmemory = (zip_fixed_memory_t*)opaque;
+
+    if (p && pmemory->allocated_n && !--pmemory->allocated_n)
+        pmemory->used_sz = 0;
+}
+
+BOOL zip_fixed_memory_init(zip_fixed_memory_t* pmemory, void* pmem, const size_t mem_sz)
+{
+    if (!pmemory || !pmem || !mem_sz)
+        return false;
+
+    // aligned start
+    uintptr_t shift = (ZIP_FIXED_MEMORY_ALIGN_SZ - ((uintptr_t)pmem & (ZIP_FIXED_MEMORY_ALIGN_SZ - 1)))
+                      & (ZIP_FIXED_MEMORY_ALIGN_SZ - 1);
+    if (shift >= mem_sz)
+        return false;
+
+    pmemory->pmem = (unsigned char*)pmem + shift;
+    pmemory->mem_sz = mem_sz - shift;
+    pmemory->used_sz = 0;
+    pmemory->allocated_n = 0;
+    return true;
+}
+
+BOOL zip_fixed_memory_get_allocator(zip_fixed_memory_t* pmemory, zip_allocator_t* pallocator)
+{
+    if (!pmemory || !pallocator)
+        return false;
+
+    pallocator->alloc_f = fixed_memory_alloc;
+    pallocator->free_f = fixed_memory_free;
+    pallocator->opaque = pmemory;
+    return true;
 }
 
 static BOOL destroy_context(zip_stream_ctx_t* pctx, int (*zip_end_f)(z_stream*))
@@ -141,6 +264,14 @@ static long process_context(zip_stream_ctx_t* pctx,
     strm->next_out = p_output;
 
     int result = zip_process_f(strm, mode);
+    if (Z_NEED_DICT == result && pctx->p_dict)
+    {
+        result = inflateSetDictionary(strm, pctx->p_dict, (uInt)pctx->dict_sz);
+        if (Z_OK == result)
+            result = zip_process_f(strm, mode);
+    }
+    if (Z_NEED_DICT == result)
+        result = Z_DATA_ERROR;
     if (result < 0)
     {
         if (Z_BUF_ERROR == result)
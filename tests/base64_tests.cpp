@@ -0,0 +1,197 @@
+#include <boost/test/unit_test.hpp>
+
+#include <server_clib/base64.h>
+#include <server_clib/macro.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace server_clib {
+
+static std::string to_base64(const std::string& data, const int flags)
+{
+    std::vector<char> buff(base64_get_encoded_length(data.size(), flags) + 1);
+    auto r = base64_stream_to_base64((const unsigned char*)data.data(), data.size(), buff.data(), buff.size(), flags);
+    BOOST_REQUIRE_EQUAL(r, data.size());
+    return std::string(buff.data());
+}
+
+static std::string from_base64(const std::string& encoded, const int flags)
+{
+    std::vector<unsigned char> output(base64_get_decoded_length(encoded.size()) + 1);
+    auto r = base64_stream_from_base64(encoded.data(), encoded.size(), output.data(), output.size(), flags, nullptr);
+    BOOST_REQUIRE_EQUAL(r, encoded.size());
+    return std::string((const char*)output.data(), base64_get_decoded_length(encoded.size())
+                                                       - (encoded.size() - encoded.find_last_not_of('=') - 1));
+}
+
+BOOST_AUTO_TEST_SUITE(base64_tests)
+
+// RFC 4648
+BOOST_AUTO_TEST_CASE(positive_convertion_check)
+{
+    const std::vector<std::pair<std::string, std::string>> vectors = { { "f", "Zg==" },       { "fo", "Zm8=" },
+                                                                       { "foo", "Zm9v" },     { "foob", "Zm9vYg==" },
+                                                                       { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" } };
+    for (auto& v : vectors)
+    {
+        BOOST_REQUIRE_EQUAL(to_base64(v.first, 0), v.second);
+        BOOST_REQUIRE_EQUAL(from_base64(v.second, 0), v.first);
+
+        auto not_padded = v.second.substr(0, v.second.find('='));
+        BOOST_REQUIRE_EQUAL(to_base64(v.first, BASE64_NO_PADDING), not_padded);
+        BOOST_REQUIRE_EQUAL(from_base64(not_padded, 0), v.first);
+    }
+
+    const std::string binary = "\xfb\xff\xbf";
+    BOOST_REQUIRE_EQUAL(to_base64(binary, 0), "+/+/");
+    BOOST_REQUIRE_EQUAL(to_base64(binary, BASE64_URL), "-_-_");
+    BOOST_REQUIRE_EQUAL(from_base64("-_-_", BASE64_URL), binary);
+}
+
+BOOST_AUTO_TEST_CASE(sanitize_convertion_check)
+{
+    char buff[MAX_INPUT];
+    unsigned char output[MAX_INPUT];
+    size_t error_pos = 0;
+
+    BOOST_REQUIRE_EQUAL(base64_stream_to_base64(nullptr, 100, buff, sizeof(buff), 0), -1);
+    BOOST_REQUIRE_EQUAL(base64_stream_to_base64(output, 0, buff, sizeof(buff), 0), -1);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64(nullptr, 100, output, sizeof(output), 0, nullptr), -1);
+
+    // whole groups that fit
+    memset(buff, 0, sizeof(buff));
+    BOOST_REQUIRE_EQUAL(base64_stream_to_base64((const unsigned char*)"foobar", 6, buff, 7, 0), 3);
+    BOOST_REQUIRE_EQUAL(std::string(buff), "Zm9v");
+    BOOST_REQUIRE_EQUAL(base64_stream_to_base64((const unsigned char*)"foob", 4, buff, 7, 0), 3);
+    BOOST_REQUIRE_EQUAL(base64_stream_to_base64((const unsigned char*)"foob", 4, buff, 7, BASE64_NO_PADDING), 4);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm9vYmFy", 8, output, 5, 0, nullptr), 4);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm9vY", 5, output, sizeof(output), 0, nullptr), 4);
+
+    // invalid chars
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm9v*mFy", 8, output, sizeof(output), 0, &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 4);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm9v-mFy", 8, output, sizeof(output), 0, &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 4);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zg==Zg==", 8, output, sizeof(output), 0, &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 2);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm9vZg==Zg", 10, output, sizeof(output), 0, &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 8);
+    BOOST_REQUIRE_EQUAL(base64_stream_from_base64("Zm=v", 4, output, sizeof(output), 0, &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 2);
+}
+
+BOOST_AUTO_TEST_CASE(vectorized_convertion_check)
+{
+    const char* abc = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (size_t data_sz = 1; data_sz < 400; data_sz += (data_sz < 100) ? 1 : 41)
+    {
+        std::vector<unsigned char> data(data_sz);
+        for (size_t ci = 0; ci < data.size(); ++ci)
+            data[ci] = (unsigned char)(ci * 97 + data_sz);
+
+        // by bits
+        std::string expected;
+        for (size_t bit = 0; bit < 8 * data_sz; bit += 6)
+        {
+            unsigned value = 0;
+            for (size_t ci = 0; ci < 6; ++ci)
+            {
+                size_t pos = bit + ci;
+                unsigned b = (pos < 8 * data_sz) ? (data[pos / 8] >> (7 - pos % 8)) & 1 : 0;
+                value = (value << 1) | b;
+            }
+            expected.push_back(abc[value]);
+        }
+        while (expected.size() % 4)
+            expected.push_back('=');
+
+        std::string data_str((const char*)data.data(), data.size());
+        auto encoded = to_base64(data_str, 0);
+        BOOST_REQUIRE_EQUAL(encoded, expected);
+        BOOST_REQUIRE(from_base64(encoded, 0) == data_str);
+
+        // the first invalid char (out of padding)
+        for (size_t bad_pos = 0; bad_pos < std::min(encoded.size(), encoded.find('=')); bad_pos += 7)
+        {
+            auto invalid = encoded;
+            invalid[bad_pos] = '*';
+            std::vector<unsigned char> output(data_sz + 3);
+            size_t error_pos = 0;
+            BOOST_REQUIRE_EQUAL(base64_stream_from_base64(invalid.data(), invalid.size(), output.data(), output.size(),
+                                                          0, &error_pos),
+                                -1);
+            BOOST_REQUIRE_EQUAL(error_pos, bad_pos);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stream_convertion_check)
+{
+    std::string data;
+    for (size_t ci = 0; ci < 1000; ++ci)
+        data.push_back((char)(ci * 7 + ci / 3));
+
+    for (int flags : { 0, BASE64_URL | BASE64_NO_PADDING })
+    {
+        auto expected = to_base64(data, flags);
+
+        for (size_t chunk_sz : { 1, 2, 5, 64, 333 })
+        {
+            base64_stream_ctx_t ctx;
+            BOOST_REQUIRE(base64_stream_ctx_init(&ctx, flags));
+
+            std::string encoded;
+            char buff[1024];
+            for (size_t pos = 0; pos < data.size(); pos += chunk_sz)
+            {
+                auto sz = std::min(chunk_sz, data.size() - pos);
+                BOOST_REQUIRE_LE(base64_stream_ctx_get_encode_length(&ctx, sz), sizeof(buff));
+                auto r = base64_stream_ctx_encode(&ctx, (const unsigned char*)data.data() + pos, sz, buff,
+                                                  sizeof(buff));
+                BOOST_REQUIRE_GE(r, 0);
+                encoded.append(buff, r);
+            }
+            auto r = base64_stream_ctx_finish_encode(&ctx, buff, sizeof(buff));
+            BOOST_REQUIRE_GE(r, 0);
+            encoded.append(buff, r);
+            BOOST_REQUIRE_EQUAL(encoded, expected);
+
+            BOOST_REQUIRE(base64_stream_ctx_init(&ctx, flags));
+            std::string decoded;
+            unsigned char output[1024];
+            for (size_t pos = 0; pos < encoded.size(); pos += chunk_sz)
+            {
+                auto sz = std::min(chunk_sz, encoded.size() - pos);
+                auto r = base64_stream_ctx_decode(&ctx, encoded.data() + pos, sz, output, sizeof(output), nullptr);
+                BOOST_REQUIRE_GE(r, 0);
+                decoded.append((const char*)output, r);
+            }
+            r = base64_stream_ctx_finish_decode(&ctx, output, sizeof(output));
+            BOOST_REQUIRE_GE(r, 0);
+            decoded.append((const char*)output, r);
+            BOOST_REQUIRE(decoded == data);
+        }
+    }
+
+    // error offset in stream
+    base64_stream_ctx_t ctx;
+    BOOST_REQUIRE(base64_stream_ctx_init(&ctx, 0));
+    unsigned char output[16];
+    size_t error_pos = 0;
+    BOOST_REQUIRE_EQUAL(base64_stream_ctx_decode(&ctx, "Zm9", 3, output, sizeof(output), &error_pos), 0);
+    BOOST_REQUIRE_EQUAL(base64_stream_ctx_decode(&ctx, "vYm*y", 5, output, sizeof(output), &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 6);
+
+    // data after padding
+    BOOST_REQUIRE(base64_stream_ctx_init(&ctx, 0));
+    BOOST_REQUIRE_EQUAL(base64_stream_ctx_decode(&ctx, "Zg=", 3, output, sizeof(output), &error_pos), 0);
+    BOOST_REQUIRE_EQUAL(base64_stream_ctx_decode(&ctx, "=", 1, output, sizeof(output), &error_pos), 1);
+    BOOST_REQUIRE_EQUAL(base64_stream_ctx_decode(&ctx, "Zg", 2, output, sizeof(output), &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+} // namespace server_clib
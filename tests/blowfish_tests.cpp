@@ -1,11 +1,30 @@
 #include <boost/test/unit_test.hpp>
 
+#include "tests_common.h"
+
 #include <server_clib/blowfish.h>
+#include <server_clib/blowfish_cache.h>
+#include <server_clib/blowfish_keys.h>
+#include <server_clib/blowfish_arena.h>
+#include <server_clib/blowfish_reader.h>
 #include <iostream>
 #include <algorithm>
+#include <vector>
+#include <thread>
+#include <fstream>
+
+#include <arpa/inet.h>
+
+#include <boost/filesystem.hpp>
 
 namespace server_clib {
 
+// the same layout of stream context for C library and C++ code
+static_assert(sizeof(blowfish_stream_ctx_t::encrypt) == sizeof(int),
+              "blowfish_stream_ctx_t flag must not depend on BOOL");
+static_assert(offsetof(blowfish_stream_ctx_t, carry) == sizeof(blowfish_ctx_t*) + sizeof(int),
+              "blowfish_stream_ctx_t carry offset");
+
 BOOST_AUTO_TEST_SUITE(blowfish_tests)
 
 BOOST_AUTO_TEST_CASE(encryption_base_author_check)
@@ -145,5 +164,839 @@ BOOST_AUTO_TEST_CASE(data_stream_encryption_check)
     BOOST_REQUIRE_EQUAL(std::string{ input_data }, std::string{ (char*)&decoded[0] });
 }
 
+BOOST_AUTO_TEST_CASE(blocks_encryption_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    // not a multiple of interleaved lanes to check tail
+    const size_t blocks_n = 23;
+    std::vector<uint32_t> blocks(2 * blocks_n);
+    for (size_t ci = 0; ci < blocks.size(); ++ci)
+        blocks[ci] = (uint32_t)(ci * 2654435761U);
+
+    auto expected = blocks;
+    for (size_t ci = 0; ci < blocks_n; ++ci)
+        BOOST_REQUIRE(blowfish_encrypt_chunk(&ctx, &expected[2 * ci], &expected[2 * ci + 1]));
+
+    auto encrypted = blocks;
+    BOOST_REQUIRE(blowfish_encrypt_blocks(&ctx, &encrypted[0], blocks_n));
+    BOOST_REQUIRE(encrypted == expected);
+
+    BOOST_REQUIRE(blowfish_decrypt_blocks(&ctx, &encrypted[0], blocks_n));
+    BOOST_REQUIRE(encrypted == blocks);
+
+    uint32_t LR[] = { 1, 2 };
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)"TESTKEY", 7));
+    BOOST_REQUIRE(blowfish_encrypt_blocks(&ctx, LR, 1));
+    BOOST_REQUIRE(LR[0] == 0xDF333FD2L);
+    BOOST_REQUIRE(LR[1] == 0x30A71BB4L);
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(ctr_encryption_check)
+{
+    const char input_data[] = "function1 function2 function3"
+                              "function4 function5 function6";
+    char key[] = "password";
+    const unsigned char nonce[] = { 0, 1, 2, 3, 4, 5, 6, 0xff };
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE_EQUAL(sizeof(nonce), blowfish_get_nonce_length());
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    // keystream is encrypted counter
+    unsigned char zero[16] = {};
+    unsigned char keystream[sizeof(zero)];
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_encrypt(&ctx, nonce, 0, zero, sizeof(zero), keystream, sizeof(keystream)),
+                        sizeof(zero));
+    uint32_t L = 0x00010203, R = 0x040506ff;
+    for (size_t ci = 0; ci < 2; ++ci)
+    {
+        uint32_t expected[] = { L, R };
+        BOOST_REQUIRE(blowfish_encrypt_chunk(&ctx, &expected[0], &expected[1]));
+        expected[0] = htonl(expected[0]);
+        expected[1] = htonl(expected[1]);
+        BOOST_REQUIRE(!memcmp(keystream + 8 * ci, expected, 8));
+        ++R;
+    }
+
+    // no padding
+    unsigned char enc_data[sizeof(input_data)];
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_encrypt(&ctx, nonce, 0, (const unsigned char*)input_data, sizeof(input_data),
+                                             enc_data, sizeof(enc_data)),
+                        sizeof(input_data));
+
+    // random access by unaligned offset
+    for (size_t offset = 0; offset < sizeof(input_data); offset += 5)
+    {
+        unsigned char dec_data[sizeof(input_data)] = {};
+        size_t sz = std::min<size_t>(11, sizeof(input_data) - offset);
+        BOOST_REQUIRE_EQUAL(blowfish_ctr_decrypt(&ctx, nonce, offset, enc_data + offset, sz, dec_data, sz), sz);
+        BOOST_REQUIRE(!memcmp(dec_data, input_data + offset, sz));
+    }
+
+    // in-place
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_decrypt(&ctx, nonce, 0, enc_data, sizeof(enc_data), enc_data, sizeof(enc_data)),
+                        sizeof(enc_data));
+    BOOST_REQUIRE_EQUAL(std::string{ input_data }, std::string{ (char*)enc_data });
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(ctr_mt_encryption_check)
+{
+    char key[] = "password";
+    const unsigned char nonce[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 };
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    const size_t data_sz = 1024 * 1024 + 3;
+    std::vector<unsigned char> data(data_sz);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 7);
+
+    std::vector<unsigned char> expected(data_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_encrypt(&ctx, nonce, 1, &data[0], data_sz, &expected[0], data_sz), data_sz);
+
+    std::vector<unsigned char> encrypted(data_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_encrypt_mt(&ctx, nonce, 1, &data[0], data_sz, &encrypted[0], data_sz, 0),
+                        data_sz);
+    BOOST_REQUIRE(encrypted == expected);
+
+    BOOST_REQUIRE_EQUAL(blowfish_ctr_decrypt_mt(&ctx, nonce, 1, &encrypted[0], data_sz, &encrypted[0], data_sz, 4),
+                        data_sz);
+    BOOST_REQUIRE(encrypted == data);
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(cbc_encryption_check)
+{
+    // Eric Young's test vector
+    uint8_t key[] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87 };
+    const unsigned char iv[] = { 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10 };
+    const char input_data[] = "7654321 Now is the time for "; // with '\0' padded to 32 bytes
+    const unsigned char expected[] = { 0x6B, 0x77, 0xB4, 0xD6, 0x30, 0x06, 0xDE, 0xE6, 0x05, 0xB1, 0x56,
+                                       0xE2, 0x74, 0x03, 0x97, 0x93, 0x58, 0xDE, 0xB9, 0xE7, 0x15, 0x46,
+                                       0x16, 0xD9, 0x59, 0xF1, 0x65, 0x2B, 0xD5, 0xFF, 0x92, 0xCC };
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, key, sizeof(key)));
+
+    unsigned char enc_iv[sizeof(iv)];
+    memcpy(enc_iv, iv, sizeof(iv));
+    unsigned char enc_data[sizeof(expected)];
+    // chained by two calls
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_encrypt(&ctx, enc_iv, (const unsigned char*)input_data, 16, enc_data, 16), 16);
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_encrypt(&ctx, enc_iv, (const unsigned char*)input_data + 16,
+                                             sizeof(input_data) - 16, enc_data + 16, sizeof(enc_data) - 16),
+                        sizeof(enc_data) - 16);
+    BOOST_REQUIRE(!memcmp(enc_data, expected, sizeof(expected)));
+    BOOST_REQUIRE(!memcmp(enc_iv, expected + sizeof(expected) - 8, 8));
+
+    unsigned char dec_iv[sizeof(iv)];
+    memcpy(dec_iv, iv, sizeof(iv));
+    unsigned char dec_data[sizeof(expected)];
+    // the tail is not full block
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_decrypt(&ctx, dec_iv, enc_data, 20, dec_data, sizeof(dec_data)), 16);
+    BOOST_REQUIRE_EQUAL(
+        blowfish_cbc_decrypt(&ctx, dec_iv, enc_data + 16, sizeof(enc_data) - 16, dec_data + 16, sizeof(dec_data) - 16),
+        sizeof(dec_data) - 16);
+    BOOST_REQUIRE_EQUAL(std::string{ input_data }, std::string{ (char*)dec_data });
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(cbc_mt_decryption_check)
+{
+    char key[] = "password";
+    const unsigned char iv[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    const size_t data_sz = 1024 * 1024 + 24;
+    std::vector<unsigned char> data(data_sz);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 13);
+
+    std::vector<unsigned char> encrypted(data_sz);
+    unsigned char enc_iv[sizeof(iv)];
+    memcpy(enc_iv, iv, sizeof(iv));
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_encrypt(&ctx, enc_iv, &data[0], data_sz, &encrypted[0], data_sz), data_sz);
+
+    std::vector<unsigned char> decrypted(data_sz);
+    unsigned char dec_iv[sizeof(iv)];
+    memcpy(dec_iv, iv, sizeof(iv));
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_decrypt(&ctx, dec_iv, &encrypted[0], data_sz, &decrypted[0], data_sz), data_sz);
+    BOOST_REQUIRE(decrypted == data);
+    BOOST_REQUIRE(!memcmp(dec_iv, enc_iv, sizeof(iv)));
+
+    memcpy(dec_iv, iv, sizeof(iv));
+    // in-place
+    BOOST_REQUIRE_EQUAL(blowfish_cbc_decrypt_mt(&ctx, dec_iv, &encrypted[0], data_sz, &encrypted[0], data_sz, 0),
+                        data_sz);
+    BOOST_REQUIRE(encrypted == data);
+    BOOST_REQUIRE(!memcmp(dec_iv, enc_iv, sizeof(iv)));
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(stream_ctx_encryption_check)
+{
+    const char input_data[] = "function1 function2 function3"
+                              "function4 function5 function6";
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    auto enc_sz = blowfish_get_stream_output_length(sizeof(input_data));
+    std::vector<unsigned char> expected(enc_sz);
+    BOOST_REQUIRE_EQUAL(
+        blowfish_stream_encrypt(&ctx, (const unsigned char*)input_data, sizeof(input_data), &expected[0], enc_sz),
+        enc_sz);
+
+    for (size_t chunk_sz = 1; chunk_sz < 20; ++chunk_sz)
+    {
+        blowfish_stream_ctx_t stream;
+        BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, true));
+
+        std::vector<unsigned char> encoded;
+        unsigned char output[32];
+        for (size_t pos = 0; pos < sizeof(input_data); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, sizeof(input_data) - pos);
+            auto r = blowfish_stream_ctx_update(&stream, (const unsigned char*)input_data + pos, sz, output,
+                                                sizeof(output));
+            BOOST_REQUIRE_GE(r, 0);
+            BOOST_REQUIRE_EQUAL(r % blowfish_get_min_chunk_length(), 0);
+            std::copy_n(output, r, std::back_inserter(encoded));
+        }
+        auto r = blowfish_stream_ctx_finish(&stream, output, sizeof(output));
+        BOOST_REQUIRE_GE(r, 0);
+        std::copy_n(output, r, std::back_inserter(encoded));
+        BOOST_REQUIRE(encoded == expected);
+
+        BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, false));
+
+        std::vector<unsigned char> decoded;
+        for (size_t pos = 0; pos < encoded.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, encoded.size() - pos);
+            auto r = blowfish_stream_ctx_update(&stream, &encoded[pos], sz, output, sizeof(output));
+            BOOST_REQUIRE_GE(r, 0);
+            std::copy_n(output, r, std::back_inserter(decoded));
+        }
+        BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_finish(&stream, output, sizeof(output)), 0);
+        BOOST_REQUIRE(blowfish_stream_ctx_destroy(&stream));
+
+        BOOST_REQUIRE_EQUAL(std::string{ input_data }, std::string{ (char*)&decoded[0] });
+    }
+
+    // not enough output
+    blowfish_stream_ctx_t stream;
+    BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, true));
+    unsigned char output[8];
+    BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_get_output_length(&stream, 16), 16);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_update(&stream, expected.data(), 16, output, sizeof(output)), -1);
+
+    // incomplete ciphertext
+    BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, false));
+    BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_update(&stream, expected.data(), 3, output, sizeof(output)), 0);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_finish(&stream, output, sizeof(output)), -1);
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(stream_ctx_inplace_encryption_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    std::vector<unsigned char> data(3001);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 11 + 3);
+
+    auto enc_sz = blowfish_get_stream_output_length(data.size());
+    std::vector<unsigned char> expected(enc_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, data.data(), data.size(), expected.data(), expected.size()),
+                        enc_sz);
+
+    // chunks are read into the same buffer and processed in place
+    // with partial blocks carried between calls
+    for (size_t chunk_sz : { 1, 3, 7, 13, 605, 1500 })
+    {
+        blowfish_stream_ctx_t stream;
+        BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, true));
+
+        std::vector<unsigned char> buff(chunk_sz + 8);
+        std::vector<unsigned char> encoded;
+        for (size_t pos = 0; pos < data.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, data.size() - pos);
+            std::copy_n(data.begin() + pos, sz, buff.begin());
+            auto r = blowfish_stream_ctx_update(&stream, buff.data(), sz, buff.data(), buff.size());
+            BOOST_REQUIRE_GE(r, 0);
+            std::copy_n(buff.begin(), r, std::back_inserter(encoded));
+        }
+        auto r = blowfish_stream_ctx_finish(&stream, buff.data(), buff.size());
+        BOOST_REQUIRE_GE(r, 0);
+        std::copy_n(buff.begin(), r, std::back_inserter(encoded));
+        BOOST_REQUIRE(encoded == expected);
+
+        BOOST_REQUIRE(blowfish_stream_ctx_init(&stream, &ctx, false));
+
+        std::vector<unsigned char> decoded;
+        for (size_t pos = 0; pos < encoded.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, encoded.size() - pos);
+            std::copy_n(encoded.begin() + pos, sz, buff.begin());
+            auto r = blowfish_stream_ctx_update(&stream, buff.data(), sz, buff.data(), buff.size());
+            BOOST_REQUIRE_GE(r, 0);
+            std::copy_n(buff.begin(), r, std::back_inserter(decoded));
+        }
+        BOOST_REQUIRE_EQUAL(blowfish_stream_ctx_finish(&stream, buff.data(), buff.size()), 0);
+        BOOST_REQUIRE(blowfish_stream_ctx_destroy(&stream));
+
+        decoded.resize(data.size());
+        BOOST_REQUIRE(decoded == data);
+    }
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(stream_inplace_encryption_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    for (size_t data_sz : { 8, 21, 64, 1003 })
+    {
+        std::vector<unsigned char> data(blowfish_get_stream_output_length(data_sz));
+        for (size_t ci = 0; ci < data_sz; ++ci)
+            data[ci] = (unsigned char)(ci * 7 + 1);
+        auto original = data;
+
+        std::vector<unsigned char> expected(data.size());
+        BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, data.data(), data_sz, expected.data(), expected.size()),
+                            expected.size());
+
+        BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, data.data(), data_sz, data.data(), data.size()),
+                            data.size());
+        BOOST_REQUIRE(data == expected);
+
+        BOOST_REQUIRE_EQUAL(blowfish_stream_decrypt(&ctx, data.data(), data.size(), data.data(), data.size()),
+                            data.size());
+        BOOST_REQUIRE(data == original);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stream_iov_encryption_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    // header and body fragments with blocks straddling bounds
+    const size_t fragments[] = { 13, 0, 3, 1, 200, 7, 9, 64, 5 };
+    size_t data_sz = 0;
+    for (auto sz : fragments)
+        data_sz += sz;
+
+    std::vector<unsigned char> data(data_sz);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 13 + 5);
+
+    auto enc_sz = blowfish_get_stream_output_length(data_sz);
+    std::vector<unsigned char> expected(enc_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, data.data(), data.size(), expected.data(), expected.size()),
+                        enc_sz);
+
+    std::vector<std::vector<unsigned char>> message;
+    std::vector<struct iovec> iov;
+    size_t pos = 0;
+    for (auto sz : fragments)
+    {
+        message.emplace_back(data.begin() + pos, data.begin() + pos + sz);
+        pos += sz;
+    }
+    // room for padding in the last fragment
+    message.back().resize(message.back().size() + enc_sz - data_sz);
+    for (auto& fragment : message)
+        iov.push_back({ fragment.data(), fragment.size() });
+    iov.back().iov_len -= enc_sz - data_sz;
+
+    // to contiguous output
+    std::vector<unsigned char> encrypted(enc_sz);
+    struct iovec out_iov = { encrypted.data(), encrypted.size() };
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encryptv(&ctx, iov.data(), iov.size(), &out_iov, 1), enc_sz);
+    BOOST_REQUIRE(encrypted == expected);
+
+    // in-place (padding room is zeroed)
+    iov.back().iov_len += enc_sz - data_sz;
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encryptv(&ctx, iov.data(), iov.size(), iov.data(), iov.size()), enc_sz);
+    std::vector<unsigned char> joined;
+    for (auto& fragment : message)
+        joined.insert(joined.end(), fragment.begin(), fragment.end());
+    BOOST_REQUIRE(joined == expected);
+
+    // to output with other fragments layout
+    std::vector<unsigned char> decrypted(enc_sz);
+    std::vector<struct iovec> out_iovs;
+    for (size_t pos = 0; pos < decrypted.size(); pos += 5)
+        out_iovs.push_back({ decrypted.data() + pos, std::min<size_t>(5, decrypted.size() - pos) });
+    BOOST_REQUIRE_EQUAL(blowfish_stream_decryptv(&ctx, iov.data(), iov.size(), out_iovs.data(), out_iovs.size()),
+                        enc_sz);
+    BOOST_REQUIRE(std::equal(data.begin(), data.end(), decrypted.begin()));
+
+    BOOST_REQUIRE_EQUAL(blowfish_stream_decryptv(&ctx, iov.data(), iov.size(), iov.data(), iov.size()), enc_sz);
+    joined.clear();
+    for (auto& fragment : message)
+        joined.insert(joined.end(), fragment.begin(), fragment.end());
+    BOOST_REQUIRE(std::equal(data.begin(), data.end(), joined.begin()));
+
+    // not enough output
+    out_iov.iov_len = 4;
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encryptv(&ctx, iov.data(), iov.size(), &out_iov, 1), 0);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encryptv(&ctx, iov.data(), 0, &out_iov, 1), -1);
+}
+
+BOOST_AUTO_TEST_CASE(key_cache_check)
+{
+    blowfish_cache_ctx_t cache;
+
+    BOOST_REQUIRE(blowfish_cache_init(&cache, 6));
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_capacity(&cache), 8);
+
+    char key[] = "password";
+    blowfish_ctx_t expected, ctx;
+    BOOST_REQUIRE(blowfish_init(&expected, (uint8_t*)key, sizeof(key)));
+
+    BOOST_REQUIRE(blowfish_cache_get(&cache, &ctx, (uint8_t*)key, sizeof(key)));
+    BOOST_REQUIRE(!memcmp(&ctx, &expected, sizeof(ctx)));
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_hits(&cache), 0);
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_misses(&cache), 1);
+
+    bzero(&ctx, sizeof(ctx));
+    BOOST_REQUIRE(blowfish_cache_get(&cache, &ctx, (uint8_t*)key, sizeof(key)));
+    BOOST_REQUIRE(!memcmp(&ctx, &expected, sizeof(ctx)));
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_hits(&cache), 1);
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_misses(&cache), 1);
+
+    // the same prefix
+    BOOST_REQUIRE(blowfish_cache_get(&cache, &ctx, (uint8_t*)key, sizeof(key) - 1));
+    BOOST_REQUIRE(memcmp(&ctx, &expected, sizeof(ctx)));
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_misses(&cache), 2);
+
+    // bounded by capacity
+    for (int ci = 0; ci < 100; ++ci)
+    {
+        auto k = std::to_string(ci);
+        BOOST_REQUIRE(blowfish_cache_get(&cache, &ctx, (uint8_t*)k.c_str(), (int32_t)k.size()));
+        BOOST_REQUIRE(blowfish_init(&expected, (uint8_t*)k.c_str(), (int32_t)k.size()));
+        BOOST_REQUIRE(!memcmp(&ctx, &expected, sizeof(ctx)));
+    }
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_misses(&cache), 102);
+
+    BOOST_REQUIRE(blowfish_cache_destroy(&cache));
+}
+
+BOOST_AUTO_TEST_CASE(key_cache_mt_check)
+{
+    blowfish_cache_ctx_t cache;
+
+    BOOST_REQUIRE(blowfish_cache_init(&cache, 64));
+
+    const int keys_n = 16;
+    const int requests_n = 1000;
+    auto job = [&cache]() {
+        for (int ci = 0; ci < requests_n; ++ci)
+        {
+            auto k = std::to_string(ci % keys_n);
+            blowfish_ctx_t ctx, expected;
+            BOOST_REQUIRE(blowfish_cache_get(&cache, &ctx, (uint8_t*)k.c_str(), (int32_t)k.size()));
+            if (ci < keys_n)
+            {
+                BOOST_REQUIRE(blowfish_init(&expected, (uint8_t*)k.c_str(), (int32_t)k.size()));
+                BOOST_REQUIRE(!memcmp(&ctx, &expected, sizeof(ctx)));
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int ci = 0; ci < 4; ++ci)
+        threads.emplace_back(job);
+    for (auto& t : threads)
+        t.join();
+
+    BOOST_REQUIRE_EQUAL(blowfish_cache_get_hits(&cache) + blowfish_cache_get_misses(&cache), 4 * requests_n);
+    BOOST_REQUIRE_GE(blowfish_cache_get_misses(&cache), keys_n);
+    // concurrent misses for the same key are possible
+    BOOST_REQUIRE_LE(blowfish_cache_get_misses(&cache), 4 * keys_n);
+
+    BOOST_REQUIRE(blowfish_cache_destroy(&cache));
+}
+
+BOOST_AUTO_TEST_CASE(keys_export_check)
+{
+    std::vector<blowfish_ctx_t> ctxs(10);
+    for (size_t ci = 0; ci < ctxs.size(); ++ci)
+    {
+        auto k = std::to_string(ci);
+        BOOST_REQUIRE(blowfish_init(&ctxs[ci], (uint8_t*)k.c_str(), (int32_t)k.size()));
+    }
+
+    auto sz = blowfish_keys_get_export_length(ctxs.size());
+    std::vector<unsigned char> blob(sz);
+    BOOST_REQUIRE_EQUAL(blowfish_keys_export(ctxs.data(), ctxs.size(), blob.data(), sz - 1), -1);
+    BOOST_REQUIRE_EQUAL(blowfish_keys_export(ctxs.data(), ctxs.size(), blob.data(), sz), sz);
+
+    std::vector<blowfish_ctx_t> imported(ctxs.size() + 1);
+    BOOST_REQUIRE_EQUAL(blowfish_keys_import(blob.data(), sz, imported.data(), imported.size()), ctxs.size());
+    BOOST_REQUIRE(!memcmp(imported.data(), ctxs.data(), ctxs.size() * sizeof(blowfish_ctx_t)));
+
+    // truncated
+    BOOST_REQUIRE_EQUAL(blowfish_keys_import(blob.data(), sz - 1, imported.data(), imported.size()), -1);
+
+    size_t ctx_n = 0;
+    const blowfish_ctx_t* pview = blowfish_keys_view(blob.data(), sz, &ctx_n);
+    BOOST_REQUIRE(pview);
+    BOOST_REQUIRE_EQUAL(ctx_n, ctxs.size());
+    BOOST_REQUIRE(!memcmp(pview, ctxs.data(), ctxs.size() * sizeof(blowfish_ctx_t)));
+
+    // foreign byte order
+    auto pheader = reinterpret_cast<blowfish_keys_header_t*>(blob.data());
+    pheader->version = __builtin_bswap16(pheader->version);
+    pheader->byte_order = __builtin_bswap16(pheader->byte_order);
+    pheader->ctx_sz = __builtin_bswap32(pheader->ctx_sz);
+    pheader->ctx_n = __builtin_bswap64(pheader->ctx_n);
+    auto pwords = reinterpret_cast<uint32_t*>(blob.data() + BLOWFISH_KEYS_HEADER_SZ);
+    for (size_t ci = 0; ci < ctxs.size() * sizeof(blowfish_ctx_t) / sizeof(uint32_t); ++ci)
+        pwords[ci] = __builtin_bswap32(pwords[ci]);
+
+    BOOST_REQUIRE(!blowfish_keys_view(blob.data(), sz, &ctx_n));
+    bzero(imported.data(), imported.size() * sizeof(blowfish_ctx_t));
+    BOOST_REQUIRE_EQUAL(blowfish_keys_import(blob.data(), sz, imported.data(), imported.size()), ctxs.size());
+    BOOST_REQUIRE(!memcmp(imported.data(), ctxs.data(), ctxs.size() * sizeof(blowfish_ctx_t)));
+}
+
+BOOST_AUTO_TEST_CASE(keys_file_check)
+{
+    std::vector<blowfish_ctx_t> ctxs(1000);
+    for (size_t ci = 0; ci < ctxs.size(); ++ci)
+    {
+        auto k = std::to_string(ci);
+        BOOST_REQUIRE(blowfish_init(&ctxs[ci], (uint8_t*)k.c_str(), (int32_t)k.size()));
+    }
+
+    auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    BOOST_REQUIRE(blowfish_keys_save(path.c_str(), ctxs.data(), ctxs.size()));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::status(path).permissions(),
+                        boost::filesystem::owner_read | boost::filesystem::owner_write);
+
+    blowfish_keys_map_t map;
+    BOOST_REQUIRE(blowfish_keys_map(&map, path.c_str()));
+    BOOST_REQUIRE_EQUAL(map.ctx_n, ctxs.size());
+    BOOST_REQUIRE(!memcmp(map.pctxs, ctxs.data(), ctxs.size() * sizeof(blowfish_ctx_t)));
+
+    uint32_t L = 1, R = 2;
+    BOOST_REQUIRE(blowfish_encrypt_chunk(&map.pctxs[7], &L, &R));
+    BOOST_REQUIRE(blowfish_decrypt_chunk(&ctxs[7], &L, &R));
+    BOOST_REQUIRE_EQUAL(L, 1);
+    BOOST_REQUIRE_EQUAL(R, 2);
+
+    BOOST_REQUIRE(blowfish_keys_unmap(&map));
+    boost::filesystem::remove(path);
+    BOOST_REQUIRE(!blowfish_keys_map(&map, path.c_str()));
+}
+
+BOOST_AUTO_TEST_CASE(reader_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    const unsigned char nonce[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const std::string header = "blob header:";
+
+    std::vector<unsigned char> data(4 * 1024 * 1024 + 123);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 31 + ci / 4096);
+    std::vector<unsigned char> encrypted(data.size());
+    BOOST_REQUIRE_EQUAL(
+        blowfish_ctr_encrypt(&ctx, nonce, 0, data.data(), data.size(), encrypted.data(), encrypted.size()),
+        data.size());
+
+    auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        std::ofstream f(path.c_str(), std::ios::binary);
+        f.write(header.data(), header.size());
+        f.write((const char*)encrypted.data(), encrypted.size());
+    }
+
+    for (size_t cache_pages_n : { 0, 16 })
+    {
+        blowfish_reader_t reader;
+        BOOST_REQUIRE(blowfish_reader_open(&reader, path.c_str(), &ctx, nonce, header.size(), cache_pages_n));
+        BOOST_REQUIRE_EQUAL(blowfish_reader_get_length(&reader), data.size());
+
+        unsigned char output[10000];
+        for (size_t ci = 0; ci < 200; ++ci)
+        {
+            uint64_t offset = (ci * 104729 + ci * ci * 7) % data.size();
+            size_t sz = (ci * 37) % sizeof(output) + 1;
+            auto r = blowfish_reader_read(&reader, offset, output, sz);
+            BOOST_REQUIRE_EQUAL(r, std::min<size_t>(sz, data.size() - offset));
+            BOOST_REQUIRE(std::equal(output, output + r, data.begin() + offset));
+        }
+
+        // small reads near each other are served from cache
+        for (uint64_t offset = 1000000; offset < 1000000 + 8000; offset += 100)
+        {
+            BOOST_REQUIRE_EQUAL(blowfish_reader_read(&reader, offset, output, 50), 50);
+            BOOST_REQUIRE(std::equal(output, output + 50, data.begin() + offset));
+        }
+        if (cache_pages_n)
+            BOOST_REQUIRE_GT(blowfish_reader_get_hits(&reader), 70u);
+
+        // pages at the end are decrypted without the preceding data
+        for (size_t ci = 0; ci < 16; ++ci)
+        {
+            uint64_t offset = data.size() - 65536 - 123 + 4096 * ci;
+            BOOST_REQUIRE_EQUAL(blowfish_reader_read(&reader, offset, output, 4096), 4096);
+            BOOST_REQUIRE(std::equal(output, output + 4096, data.begin() + offset));
+        }
+
+        BOOST_REQUIRE_EQUAL(blowfish_reader_read(&reader, data.size() - 3, output, sizeof(output)), 3);
+        BOOST_REQUIRE(std::equal(output, output + 3, data.end() - 3));
+        BOOST_REQUIRE_EQUAL(blowfish_reader_read(&reader, data.size(), output, sizeof(output)), 0);
+
+        BOOST_REQUIRE(blowfish_reader_close(&reader));
+    }
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(arena_check)
+{
+    for (bool hugepages : { false, true })
+    {
+        const size_t capacity = 1000;
+        blowfish_arena_t arena;
+        BOOST_REQUIRE(blowfish_arena_init(&arena, capacity, hugepages));
+        BOOST_REQUIRE_EQUAL(blowfish_arena_get_capacity(&arena), capacity);
+
+        blowfish_ctx_t zero_ctx;
+        bzero(&zero_ctx, sizeof(zero_ctx));
+
+        std::vector<blowfish_ctx_t*> ctxs;
+        for (size_t ci = 0; ci < capacity; ++ci)
+        {
+            auto ctx = blowfish_arena_alloc(&arena);
+            BOOST_REQUIRE(ctx);
+            BOOST_REQUIRE_EQUAL((uintptr_t)ctx % BLOWFISH_ARENA_ALIGN_SZ, 0u);
+            BOOST_REQUIRE(!memcmp(ctx, &zero_ctx, sizeof(zero_ctx)));
+            ctxs.push_back(ctx);
+        }
+        BOOST_REQUIRE(!blowfish_arena_alloc(&arena));
+        BOOST_REQUIRE_EQUAL(blowfish_arena_get_allocated(&arena), capacity);
+
+        std::sort(ctxs.begin(), ctxs.end());
+        BOOST_REQUIRE(std::adjacent_find(ctxs.begin(), ctxs.end()) == ctxs.end());
+
+        char key[] = "session key";
+        auto ctx = ctxs[capacity / 2];
+        BOOST_REQUIRE(blowfish_init(ctx, (uint8_t*)key, sizeof(key)));
+        uint32_t L = 1, R = 2;
+        BOOST_REQUIRE(blowfish_encrypt_chunk(ctx, &L, &R));
+
+        // zeroized and reused
+        BOOST_REQUIRE(blowfish_arena_free(&arena, ctx));
+        BOOST_REQUIRE(!memcmp(ctx, &zero_ctx, sizeof(zero_ctx)));
+        BOOST_REQUIRE_EQUAL(blowfish_arena_alloc(&arena), ctx);
+
+        // foreign pointers and double release
+        BOOST_REQUIRE(!C_BOOL_RESULT(blowfish_arena_free(&arena, &zero_ctx)));
+        BOOST_REQUIRE(
+            !C_BOOL_RESULT(blowfish_arena_free(&arena, (blowfish_ctx_t*)((char*)ctx + BLOWFISH_ARENA_ALIGN_SZ))));
+        BOOST_REQUIRE(blowfish_arena_free(&arena, ctx));
+        BOOST_REQUIRE(!C_BOOL_RESULT(blowfish_arena_free(&arena, ctx)));
+        BOOST_REQUIRE_EQUAL(blowfish_arena_get_allocated(&arena), capacity - 1);
+
+        BOOST_REQUIRE(blowfish_arena_destroy(&arena));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(data_bulk_encryption_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    // not a multiple of vectorized lanes to check tail
+    const size_t data_sz = 1024 * 1024 + 8 * 5 + 3;
+    std::vector<unsigned char> data(data_sz);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 31);
+
+    auto enc_sz = blowfish_get_stream_output_length(data_sz);
+    std::vector<unsigned char> expected(enc_sz, 0);
+    memcpy(&expected[0], &data[0], data_sz);
+    for (size_t ci = 0; ci < enc_sz; ci += 8)
+    {
+        uint32_t LR[2];
+        memcpy(LR, &expected[ci], sizeof(LR));
+        BOOST_REQUIRE(blowfish_encrypt_chunk(&ctx, &LR[0], &LR[1]));
+        LR[0] = htonl(LR[0]);
+        LR[1] = htonl(LR[1]);
+        memcpy(&expected[ci], LR, sizeof(LR));
+    }
+
+    std::vector<unsigned char> encrypted(enc_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, &data[0], data_sz, &encrypted[0], enc_sz), enc_sz);
+    BOOST_REQUIRE(encrypted == expected);
+
+    std::vector<unsigned char> decrypted(enc_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_decrypt(&ctx, &encrypted[0], enc_sz, &decrypted[0], enc_sz), enc_sz);
+    decrypted.resize(data_sz);
+    BOOST_REQUIRE(decrypted == data);
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(batch_encryption_check)
+{
+    const size_t jobs_n = 1000;
+    std::vector<blowfish_ctx_t> ctxs(jobs_n);
+    std::vector<std::vector<unsigned char>> inputs(jobs_n);
+    std::vector<std::vector<unsigned char>> expected(jobs_n);
+    std::vector<long> expected_processed(jobs_n);
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        auto k = std::to_string(ci);
+        BOOST_REQUIRE(blowfish_init(&ctxs[ci], (uint8_t*)k.c_str(), (int32_t)k.size()));
+
+        inputs[ci].resize(1 + ci % 200, (unsigned char)ci);
+        // some outputs are not enough to process whole input
+        expected[ci].resize((ci % 7) ? blowfish_get_stream_output_length(inputs[ci].size()) : 16);
+    }
+
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        expected_processed[ci] = blowfish_stream_encrypt(&ctxs[ci], inputs[ci].data(), inputs[ci].size(),
+                                                         expected[ci].data(), expected[ci].size());
+    }
+
+    std::vector<std::vector<unsigned char>> outputs(jobs_n);
+    std::vector<blowfish_stream_job_t> jobs(jobs_n);
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        outputs[ci].resize(expected[ci].size());
+        jobs[ci] = { &ctxs[ci], inputs[ci].data(), inputs[ci].size(), outputs[ci].data(), outputs[ci].size(), 0 };
+    }
+    // wrong job
+    jobs[3].p_input = nullptr;
+    expected_processed[3] = -1;
+
+    BOOST_REQUIRE(blowfish_stream_encrypt_batch(jobs.data(), jobs.size()));
+
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        BOOST_REQUIRE_EQUAL(jobs[ci].processed, expected_processed[ci]);
+        if (jobs[ci].processed > 0)
+            BOOST_REQUIRE(outputs[ci] == expected[ci]);
+    }
+
+    std::vector<std::vector<unsigned char>> decrypted(jobs_n);
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        decrypted[ci].resize(outputs[ci].size());
+        jobs[ci] = { &ctxs[ci], outputs[ci].data(), outputs[ci].size(), decrypted[ci].data(), decrypted[ci].size(),
+                     0 };
+    }
+    BOOST_REQUIRE(blowfish_stream_decrypt_batch(jobs.data(), jobs.size()));
+
+    for (size_t ci = 0; ci < jobs_n; ++ci)
+    {
+        BOOST_REQUIRE_EQUAL(jobs[ci].processed, outputs[ci].size());
+        auto sz = std::min(inputs[ci].size(), decrypted[ci].size());
+        if (ci != 3)
+            BOOST_REQUIRE(!memcmp(decrypted[ci].data(), inputs[ci].data(), sz));
+    }
+}
+
+// per block loop how blowfish_stream_process worked before specialized bulk paths
+static long stream_process_by_chunks(blowfish_ctx_t* ctx,
+                                     const unsigned char* p_input,
+                                     const size_t sz,
+                                     unsigned char* p_output,
+                                     BOOL (*blowfish_process_f)(blowfish_ctx_t*, uint32_t*, uint32_t*),
+                                     BOOL ecrypt)
+{
+    for (size_t ci = 0; ci < sz; ci += 8)
+    {
+        uint32_t xl, xr;
+        memcpy(&xl, p_input + ci, sizeof(xl));
+        memcpy(&xr, p_input + ci + 4, sizeof(xr));
+        if (!ecrypt)
+        {
+            xl = ntohl(xl);
+            xr = ntohl(xr);
+        }
+        if (!blowfish_process_f(ctx, &xl, &xr))
+            return -1;
+        if (ecrypt)
+        {
+            xl = htonl(xl);
+            xr = htonl(xr);
+        }
+        memcpy(p_output + ci, &xl, sizeof(xl));
+        memcpy(p_output + ci + 4, &xr, sizeof(xr));
+    }
+    return (long)sz;
+}
+
+BOOST_AUTO_TEST_CASE(stream_encryption_by_chunks_check)
+{
+    char key[] = "password";
+    blowfish_ctx_t ctx;
+
+    BOOST_REQUIRE(blowfish_init(&ctx, (uint8_t*)key, sizeof(key)));
+
+    const size_t data_sz = 64 * 1024 + 8 * 3;
+    std::vector<unsigned char> data(data_sz);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 17);
+
+    std::vector<unsigned char> expected(data_sz);
+    BOOST_REQUIRE_EQUAL(
+        stream_process_by_chunks(&ctx, &data[0], data_sz, &expected[0], blowfish_encrypt_chunk, true), data_sz);
+
+    std::vector<unsigned char> encrypted(data_sz);
+    BOOST_REQUIRE_EQUAL(blowfish_stream_encrypt(&ctx, &data[0], data_sz, &encrypted[0], data_sz), data_sz);
+    BOOST_REQUIRE(encrypted == expected);
+
+    BOOST_REQUIRE_EQUAL(
+        stream_process_by_chunks(&ctx, &encrypted[0], data_sz, &expected[0], blowfish_decrypt_chunk, false), data_sz);
+    BOOST_REQUIRE(expected == data);
+
+    BOOST_REQUIRE_EQUAL(blowfish_stream_decrypt(&ctx, &encrypted[0], data_sz, &encrypted[0], data_sz), data_sz);
+    BOOST_REQUIRE(encrypted == data);
+
+    BOOST_REQUIRE(blowfish_destroy(&ctx));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace server_clib
@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+
+#include <server_clib/checksum.h>
+#include <server_clib/macro.h>
+
+#include <zlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace server_clib {
+
+// bitwise CRC32C for reference
+static uint32_t crc32c_reference(uint32_t crc, const unsigned char* p, size_t sz)
+{
+    crc = ~crc;
+    for (size_t ci = 0; ci < sz; ++ci)
+    {
+        crc ^= p[ci];
+        for (int k = 0; k < 8; ++k)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+    }
+    return ~crc;
+}
+
+static std::vector<unsigned char> make_data(const size_t sz)
+{
+    std::vector<unsigned char> data(sz);
+    uint32_t x = 0x12345678;
+    for (auto& b : data)
+    {
+        x = x * 1103515245 + 12345;
+        b = (unsigned char)(x >> 16);
+    }
+    return data;
+}
+
+BOOST_AUTO_TEST_SUITE(checksum_tests)
+
+BOOST_AUTO_TEST_CASE(check_values_check)
+{
+    const std::string check = "123456789";
+    BOOST_REQUIRE_EQUAL(checksum_crc32(0, check.data(), check.size()), 0xCBF43926u);
+    BOOST_REQUIRE_EQUAL(checksum_crc32c(0, check.data(), check.size()), 0xE3069283u);
+    BOOST_REQUIRE_EQUAL(checksum_crc32(0, nullptr, 0), 0u);
+    BOOST_REQUIRE_EQUAL(checksum_crc32c(0, nullptr, 0), 0u);
+
+    // RFC 3720 (iSCSI) test vectors
+    std::vector<unsigned char> data(32, 0);
+    BOOST_REQUIRE_EQUAL(checksum_crc32c(0, data.data(), data.size()), 0x8A9136AAu);
+    std::fill(data.begin(), data.end(), 0xff);
+    BOOST_REQUIRE_EQUAL(checksum_crc32c(0, data.data(), data.size()), 0x62A8AB43u);
+}
+
+BOOST_AUTO_TEST_CASE(reference_check)
+{
+    auto data = make_data(4096 + 64);
+
+    // all lengths and alignments for tails, vectorized and table-driven parts
+    for (size_t offset = 0; offset < 16; ++offset)
+    {
+        for (size_t sz = 0; sz < 600; sz += (sz < 300) ? 1 : 7)
+        {
+            const unsigned char* p = data.data() + offset;
+            BOOST_REQUIRE_EQUAL(checksum_crc32(0, p, sz), (uint32_t)crc32(0, p, (uInt)sz));
+            BOOST_REQUIRE_EQUAL(checksum_crc32c(0, p, sz), crc32c_reference(0, p, sz));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(checksum_crc32(0, data.data(), data.size()), (uint32_t)crc32(0, data.data(), (uInt)data.size()));
+    BOOST_REQUIRE_EQUAL(checksum_crc32c(0, data.data(), data.size()), crc32c_reference(0, data.data(), data.size()));
+}
+
+BOOST_AUTO_TEST_CASE(incremental_check)
+{
+    auto data = make_data(10000);
+    const uint32_t crc32_expected = checksum_crc32(0, data.data(), data.size());
+    const uint32_t crc32c_expected = checksum_crc32c(0, data.data(), data.size());
+
+    for (size_t chunk_sz : { 1, 7, 63, 64, 65, 1000, 4096 })
+    {
+        uint32_t crc32_value = 0;
+        uint32_t crc32c_value = 0;
+        for (size_t pos = 0; pos < data.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, data.size() - pos);
+            crc32_value = checksum_crc32(crc32_value, data.data() + pos, sz);
+            crc32c_value = checksum_crc32c(crc32c_value, data.data() + pos, sz);
+        }
+        BOOST_REQUIRE_EQUAL(crc32_value, crc32_expected);
+        BOOST_REQUIRE_EQUAL(crc32c_value, crc32c_expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(combine_check)
+{
+    auto data = make_data(100000);
+    const uint32_t crc32_expected = checksum_crc32(0, data.data(), data.size());
+    const uint32_t crc32c_expected = checksum_crc32c(0, data.data(), data.size());
+
+    for (size_t split : { (size_t)0, (size_t)1, (size_t)17, (size_t)4096, (size_t)99999, data.size() })
+    {
+        const size_t b_sz = data.size() - split;
+        BOOST_REQUIRE_EQUAL(checksum_crc32_combine(checksum_crc32(0, data.data(), split),
+                                                   checksum_crc32(0, data.data() + split, b_sz), b_sz),
+                            crc32_expected);
+        BOOST_REQUIRE_EQUAL(checksum_crc32c_combine(checksum_crc32c(0, data.data(), split),
+                                                    checksum_crc32c(0, data.data() + split, b_sz), b_sz),
+                            crc32c_expected);
+    }
+
+    // the same as zlib for chunks larger than 4 GB
+    const uint64_t large_sz = 5ull * 1024 * 1024 * 1024 + 3;
+    BOOST_REQUIRE_EQUAL(checksum_crc32_combine(0x12345678, 0x9abcdef0, large_sz),
+                        (uint32_t)crc32_combine64(0x12345678, 0x9abcdef0, (z_off64_t)large_sz));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+} // namespace server_clib
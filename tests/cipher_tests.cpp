@@ -0,0 +1,182 @@
+#include <boost/test/unit_test.hpp>
+
+#include "tests_common.h"
+
+#include <server_clib/cipher.h>
+#include <server_clib/chacha20.h>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+namespace server_clib {
+
+BOOST_AUTO_TEST_SUITE(cipher_tests)
+
+// RFC 8439 2.4.2
+BOOST_AUTO_TEST_CASE(chacha20_rfc_check)
+{
+    uint8_t key[CHACHA20_KEY_SZ];
+    for (size_t ci = 0; ci < sizeof(key); ++ci)
+        key[ci] = (uint8_t)ci;
+    const uint8_t nonce[CHACHA20_NONCE_SZ] = { 0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0 };
+
+    const char plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for "
+                             "the future, sunscreen would be it.";
+    const unsigned char expected[] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+        0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+        0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+        0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+        0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+        0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+        0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+        0x87, 0x4d
+    };
+    const size_t input_sz = sizeof(plaintext) - 1;
+    BOOST_REQUIRE_EQUAL(input_sz, sizeof(expected));
+
+    chacha20_ctx_t ctx;
+    BOOST_REQUIRE(chacha20_init(&ctx, key, nonce, 1));
+
+    unsigned char output[sizeof(expected)];
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, (const unsigned char*)plaintext, input_sz, output, sizeof(output)),
+                        input_sz);
+    BOOST_REQUIRE(std::equal(output, output + sizeof(output), expected));
+
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, output, sizeof(output), output, sizeof(output)), input_sz);
+    BOOST_REQUIRE(std::equal(output, output + sizeof(output), plaintext));
+
+    BOOST_REQUIRE(chacha20_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(chacha20_random_access_check)
+{
+    uint8_t key[CHACHA20_KEY_SZ] = { 7, 6, 5 };
+    uint8_t nonce[CHACHA20_NONCE_SZ] = { 1, 2, 3 };
+
+    chacha20_ctx_t ctx;
+    BOOST_REQUIRE(chacha20_init(&ctx, key, nonce, 0xFFFFFFD7)); // data ends at the last block
+
+    std::vector<unsigned char> data(64 * 40 + 17);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 13 + 1);
+
+    // vectorized kernels for whole data
+    std::vector<unsigned char> expected(data.size());
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, data.data(), data.size(), expected.data(), expected.size()),
+                        data.size());
+
+    // scalar code for small pieces
+    std::vector<unsigned char> encrypted(data.size());
+    for (size_t pos = 0; pos < data.size(); pos += 3)
+    {
+        auto sz = std::min<size_t>(3, data.size() - pos);
+        BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, pos, &data[pos], sz, &encrypted[pos], sz), sz);
+    }
+    BOOST_REQUIRE(encrypted == expected);
+
+    // not aligned ranges
+    for (size_t offset : { 1, 63, 64, 100, 640 })
+    {
+        std::vector<unsigned char> part(data.size() - offset);
+        BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, offset, &data[offset], part.size(), part.data(), part.size()),
+                            part.size());
+        BOOST_REQUIRE(std::equal(part.begin(), part.end(), expected.begin() + offset));
+    }
+
+    // stream by chunks
+    for (size_t chunk_sz : { 1, 7, 64, 129, 1000 })
+    {
+        chacha20_ctx_t stream;
+        BOOST_REQUIRE(chacha20_init(&stream, key, nonce, 0xFFFFFFD7));
+        for (size_t pos = 0; pos < data.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, data.size() - pos);
+            BOOST_REQUIRE_EQUAL(chacha20_stream_encrypt(&stream, &data[pos], sz, &encrypted[pos], sz), sz);
+        }
+        BOOST_REQUIRE(encrypted == expected);
+    }
+
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, data.data(), 0, encrypted.data(), encrypted.size()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(chacha20_counter_end_check)
+{
+    uint8_t key[CHACHA20_KEY_SZ] = { 7, 6, 5 };
+    uint8_t nonce[CHACHA20_NONCE_SZ] = { 1, 2, 3 };
+    unsigned char data[130] = {};
+    unsigned char output[sizeof(data)];
+
+    chacha20_ctx_t ctx;
+    BOOST_REQUIRE(chacha20_init(&ctx, key, nonce, 0xFFFFFFFE));
+
+    // the last two blocks
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, data, 128, output, sizeof(output)), 128);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 127, data, 1, output, sizeof(output)), 1);
+    // beyond the keystream
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 0, data, 129, output, sizeof(output)), -1);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 127, data, 2, output, sizeof(output)), -1);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, 128, data, 1, output, sizeof(output)), -1);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, (uint64_t)1 << 40, data, 1, output, sizeof(output)), -1);
+
+    // 256 GB for zero initial counter
+    const uint64_t keystream_sz = (uint64_t)CHACHA20_BLOCK_SZ << 32;
+    BOOST_REQUIRE(chacha20_init(&ctx, key, nonce, 0));
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, keystream_sz - 1, data, 1, output, sizeof(output)), 1);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, keystream_sz - 1, data, 2, output, sizeof(output)), -1);
+    BOOST_REQUIRE_EQUAL(chacha20_xor(&ctx, keystream_sz, data, 1, output, sizeof(output)), -1);
+
+    // stream stops at the end
+    BOOST_REQUIRE(chacha20_init(&ctx, key, nonce, 0xFFFFFFFF));
+    BOOST_REQUIRE_EQUAL(chacha20_stream_encrypt(&ctx, data, 60, output, sizeof(output)), 60);
+    BOOST_REQUIRE_EQUAL(chacha20_stream_encrypt(&ctx, data, 5, output, sizeof(output)), -1);
+    BOOST_REQUIRE_EQUAL(chacha20_stream_encrypt(&ctx, data, 4, output, sizeof(output)), 4);
+    BOOST_REQUIRE_EQUAL(chacha20_stream_encrypt(&ctx, data, 1, output, sizeof(output)), -1);
+
+    BOOST_REQUIRE(chacha20_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(cipher_check)
+{
+    const char input_data[] = "function1 function2 function3"
+                              "function4 function5 function6";
+    const uint8_t key[CHACHA20_KEY_SZ] = { 'p', 'a', 's', 's' };
+    const uint8_t nonce[CHACHA20_NONCE_SZ] = {};
+
+    for (auto name : { "blowfish", "chacha20" })
+    {
+        cipher_type_t type;
+        BOOST_REQUIRE(cipher_get_type_by_name(name, &type));
+
+        cipher_ctx_t encoder, decoder;
+        BOOST_REQUIRE(cipher_init(&encoder, type, key, sizeof(key), nonce));
+        BOOST_REQUIRE(cipher_init(&decoder, type, key, sizeof(key), nonce));
+        BOOST_REQUIRE_EQUAL(std::string{ cipher_get_name(&encoder) }, name);
+
+        auto enc_sz = cipher_get_output_length(&encoder, sizeof(input_data));
+        BOOST_REQUIRE_GE(enc_sz, sizeof(input_data));
+        std::vector<unsigned char> encrypted(enc_sz);
+        BOOST_REQUIRE_EQUAL(cipher_encrypt(&encoder, (const unsigned char*)input_data, sizeof(input_data),
+                                           encrypted.data(), encrypted.size()),
+                            enc_sz);
+
+        std::vector<unsigned char> decrypted(enc_sz);
+        BOOST_REQUIRE_EQUAL(cipher_decrypt(&decoder, encrypted.data(), encrypted.size(), decrypted.data(),
+                                           decrypted.size()),
+                            enc_sz);
+        BOOST_REQUIRE_EQUAL(std::string{ input_data }, std::string{ (char*)decrypted.data() });
+
+        BOOST_REQUIRE(cipher_destroy(&encoder));
+        BOOST_REQUIRE(cipher_destroy(&decoder));
+        BOOST_REQUIRE_EQUAL(cipher_encrypt(&encoder, encrypted.data(), encrypted.size(), encrypted.data(),
+                                           encrypted.size()),
+                            -1);
+    }
+
+    cipher_type_t type;
+    BOOST_REQUIRE(!C_BOOL_RESULT(cipher_get_type_by_name("des", &type)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace server_clib
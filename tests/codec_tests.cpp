@@ -0,0 +1,295 @@
+#include <boost/test/unit_test.hpp>
+
+#include "tests_common.h"
+
+#include <server_clib/codec.h>
+#include <server_clib/lz.h>
+#include <server_clib/zip.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+namespace server_clib {
+
+// log-like text: repeated words with changing numbers
+static std::vector<unsigned char> make_text_data(const size_t sz)
+{
+    static const char* words[] = { "request", "response", "session", "user_id=", "status=200", "GET /api/v1/items",
+                                   "\"name\": ", "timeout", "\n", " " };
+    std::mt19937 gen(5);
+    std::string data;
+    data.reserve(sz + 64);
+    while (data.size() < sz)
+    {
+        data.append(words[gen() % (sizeof(words) / sizeof(words[0]))]);
+        if (gen() % 3 == 0)
+            data.append(std::to_string(gen() % 100000));
+    }
+    data.resize(sz);
+    return std::vector<unsigned char>(data.begin(), data.end());
+}
+
+static std::vector<unsigned char> make_random_data(const size_t sz)
+{
+    std::mt19937 gen((unsigned)sz);
+    std::vector<unsigned char> data(sz);
+    for (auto& c : data)
+        c = (unsigned char)gen();
+    return data;
+}
+
+static std::vector<unsigned char> lz_pack_data(lz_ctx_t* pctx, const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> packed(lz_get_bound(data.size()));
+    long packed_sz = lz_pack(pctx, data.data(), data.size(), packed.data(), packed.size());
+    BOOST_REQUIRE_GT(packed_sz, 0);
+    BOOST_REQUIRE_LE((size_t)packed_sz, packed.size());
+    packed.resize(packed_sz);
+    return packed;
+}
+
+BOOST_AUTO_TEST_SUITE(codec_tests)
+
+BOOST_AUTO_TEST_CASE(lz_check)
+{
+    lz_ctx_t ctx;
+    std::vector<std::vector<unsigned char>> inputs;
+    for (size_t sz = 0; sz < 100; ++sz)
+        inputs.push_back(make_text_data(sz));
+    for (size_t sz : { 1000, 65536, 65537, 300000 })
+    {
+        inputs.push_back(make_text_data(sz));
+        inputs.push_back(make_random_data(sz));
+        inputs.push_back(std::vector<unsigned char>(sz, 'z'));
+    }
+    // short periods (overlapped matches) and long literals/matches
+    for (size_t period = 1; period < 20; ++period)
+    {
+        std::vector<unsigned char> data;
+        for (size_t ci = 0; ci < 5000; ++ci)
+            data.push_back((unsigned char)('a' + ci % period));
+        inputs.push_back(data);
+    }
+    std::vector<unsigned char> mixed = make_random_data(1000);
+    mixed.insert(mixed.end(), 70000, 0);
+    auto tail = make_random_data(100000);
+    mixed.insert(mixed.end(), tail.begin(), tail.end());
+    mixed.insert(mixed.end(), tail.begin(), tail.begin() + 5000);
+    inputs.push_back(mixed);
+
+    for (const auto& data : inputs)
+    {
+        auto packed = lz_pack_data(&ctx, data);
+        BOOST_REQUIRE_LE(packed.size(), lz_get_bound(data.size()));
+
+        std::vector<unsigned char> unpacked(data.size() + 1);
+        BOOST_REQUIRE_EQUAL(lz_unpack(packed.data(), packed.size(), unpacked.data(), data.size()), (long)data.size());
+        unpacked.resize(data.size());
+        BOOST_REQUIRE(unpacked == data);
+
+        if (!data.empty())
+        {
+            // output is too small
+            BOOST_REQUIRE_EQUAL(lz_unpack(packed.data(), packed.size(), unpacked.data(), data.size() - 1), -1);
+        }
+    }
+
+    // ratio
+    auto text = make_text_data(1000000);
+    auto packed = lz_pack_data(&ctx, text);
+    BOOST_REQUIRE_LT(packed.size(), text.size() / 2);
+    auto zeros = lz_pack_data(&ctx, std::vector<unsigned char>(1000000, 0));
+    BOOST_REQUIRE_LT(zeros.size(), 5000u);
+
+    // output is too small for packing
+    std::vector<unsigned char> small(packed.size() - 1);
+    BOOST_REQUIRE_EQUAL(lz_pack(&ctx, text.data(), text.size(), small.data(), small.size()), -1);
+
+    BOOST_REQUIRE_EQUAL(lz_pack(nullptr, text.data(), text.size(), small.data(), small.size()), -1);
+    BOOST_REQUIRE_EQUAL(lz_unpack(nullptr, 10, small.data(), small.size()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(lz_invalid_data_check)
+{
+    lz_ctx_t ctx;
+    auto data = make_text_data(20000);
+    auto packed = lz_pack_data(&ctx, data);
+    std::vector<unsigned char> unpacked(data.size() + 64);
+
+    // truncated block ends by match or by incomplete sequence
+    for (size_t sz = 1; sz < packed.size(); sz += 7)
+    {
+        long result = lz_unpack(packed.data(), sz, unpacked.data(), unpacked.size());
+        BOOST_REQUIRE_LT(result, (long)data.size());
+    }
+
+    // offset 0 and offset before the start of output
+    const unsigned char zero_offset[] = { 0x10, 'a', 0, 0, 0x50, 'a', 'b', 'c', 'd', 'e' };
+    BOOST_REQUIRE_EQUAL(lz_unpack(zero_offset, sizeof(zero_offset), unpacked.data(), unpacked.size()), -1);
+    const unsigned char far_offset[] = { 0x10, 'a', 2, 0, 0x50, 'a', 'b', 'c', 'd', 'e' };
+    BOOST_REQUIRE_EQUAL(lz_unpack(far_offset, sizeof(far_offset), unpacked.data(), unpacked.size()), -1);
+    const unsigned char valid[] = { 0x10, 'a', 1, 0, 0x50, 'a', 'b', 'c', 'd', 'e' };
+    BOOST_REQUIRE_EQUAL(lz_unpack(valid, sizeof(valid), unpacked.data(), unpacked.size()), 10);
+    BOOST_REQUIRE_EQUAL(std::string((const char*)unpacked.data(), 10), "aaaaaabcde");
+
+    // corrupted data is never unpacked out of output
+    std::mt19937 gen(17);
+    for (int ci = 0; ci < 2000; ++ci)
+    {
+        auto corrupted = packed;
+        for (int n = 0; n < 1 + ci % 4; ++n)
+            corrupted[gen() % corrupted.size()] = (unsigned char)gen();
+        std::fill(unpacked.begin(), unpacked.end(), 0xCC);
+        long result = lz_unpack(corrupted.data(), corrupted.size(), unpacked.data(), data.size());
+        BOOST_REQUIRE_LE(result, (long)data.size());
+        for (size_t pos = data.size(); pos < unpacked.size(); ++pos)
+            BOOST_REQUIRE_EQUAL(unpacked[pos], 0xCC);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(codec_check)
+{
+    codec_type_t type = CODEC_TYPES_N;
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_get_type_by_name("lz", &type)));
+    BOOST_REQUIRE_EQUAL(type, CODEC_LZ);
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_get_type_by_name("zlib", &type)));
+    BOOST_REQUIRE_EQUAL(type, CODEC_ZLIB);
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_get_type_by_name("none", &type)));
+    BOOST_REQUIRE_EQUAL(type, CODEC_NONE);
+    BOOST_REQUIRE(!C_BOOL_RESULT(codec_get_type_by_name("lz4", &type)));
+
+    codec_ctx_t ctx;
+    BOOST_REQUIRE(!C_BOOL_RESULT(codec_init(&ctx, CODEC_TYPES_N)));
+
+    auto data = make_text_data(100000);
+    for (codec_type_t type : { CODEC_NONE, CODEC_ZLIB, CODEC_LZ })
+    {
+        BOOST_REQUIRE(C_BOOL_RESULT(codec_init(&ctx, type)));
+        codec_type_t name_type = CODEC_TYPES_N;
+        BOOST_REQUIRE(C_BOOL_RESULT(codec_get_type_by_name(codec_get_name(&ctx), &name_type)));
+        BOOST_REQUIRE_EQUAL(name_type, type);
+
+        // context is reused
+        for (size_t sz : { data.size(), (size_t)1000, (size_t)1 })
+        {
+            std::vector<unsigned char> packed(codec_get_bound(&ctx, sz));
+            long packed_sz = codec_pack(&ctx, data.data(), sz, packed.data(), packed.size());
+            BOOST_REQUIRE_GT(packed_sz, 0);
+            if (type != CODEC_NONE && sz > 100)
+                BOOST_REQUIRE_LT((size_t)packed_sz, sz);
+
+            std::vector<unsigned char> unpacked(sz);
+            BOOST_REQUIRE_EQUAL(codec_unpack(&ctx, packed.data(), packed_sz, unpacked.data(), unpacked.size()),
+                                (long)sz);
+            BOOST_REQUIRE(std::equal(unpacked.begin(), unpacked.end(), data.begin()));
+        }
+        BOOST_REQUIRE(C_BOOL_RESULT(codec_destroy(&ctx)));
+    }
+
+    BOOST_REQUIRE(!C_BOOL_RESULT(codec_destroy(&ctx)));
+    BOOST_REQUIRE_EQUAL(codec_pack(&ctx, data.data(), data.size(), nullptr, 0), -1);
+}
+
+BOOST_AUTO_TEST_CASE(codec_frame_check)
+{
+    codec_ctx_t ctx_zlib, ctx_lz;
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_init(&ctx_zlib, CODEC_ZLIB)));
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_init(&ctx_lz, CODEC_LZ)));
+
+    // stream of frames: messages are packed by different codecs
+    std::vector<std::vector<unsigned char>> messages = { make_text_data(5000), make_random_data(3000),
+                                                         make_text_data(0), make_text_data(70000),
+                                                         make_text_data(10) };
+    std::vector<codec_type_t> expected_types = { CODEC_LZ, CODEC_NONE, CODEC_NONE, CODEC_ZLIB, CODEC_NONE };
+
+    std::vector<unsigned char> stream;
+    for (size_t ci = 0; ci < messages.size(); ++ci)
+    {
+        codec_ctx_t* pctx = (ci % 2) ? &ctx_zlib : &ctx_lz;
+        std::vector<unsigned char> frame(codec_frame_get_bound(pctx, messages[ci].size()));
+        long frame_sz = codec_frame_pack(pctx, messages[ci].data(), messages[ci].size(), frame.data(), frame.size());
+        BOOST_REQUIRE_GE(frame_sz, CODEC_FRAME_HEADER_SZ);
+        BOOST_REQUIRE_LE((size_t)frame_sz, CODEC_FRAME_HEADER_SZ + messages[ci].size());
+        stream.insert(stream.end(), frame.begin(), frame.begin() + frame_sz);
+    }
+
+    // any context (or none) unpacks all frames
+    for (codec_ctx_t* pctx : { &ctx_lz, &ctx_zlib, (codec_ctx_t*)nullptr })
+    {
+        size_t pos = 0;
+        for (size_t ci = 0; ci < messages.size(); ++ci)
+        {
+            codec_type_t type = CODEC_TYPES_N;
+            size_t unpacked_sz = 0, frame_sz = 0;
+            BOOST_REQUIRE(C_BOOL_RESULT(codec_frame_get_info(stream.data() + pos, stream.size() - pos, &type,
+                                                             &unpacked_sz, &frame_sz)));
+            BOOST_REQUIRE_EQUAL(type, expected_types[ci]);
+            BOOST_REQUIRE_EQUAL(unpacked_sz, messages[ci].size());
+
+            std::vector<unsigned char> unpacked(unpacked_sz + 10);
+            BOOST_REQUIRE_EQUAL(codec_frame_unpack(pctx, stream.data() + pos, stream.size() - pos, unpacked.data(),
+                                                   unpacked.size()),
+                                (long)unpacked_sz);
+            unpacked.resize(unpacked_sz);
+            BOOST_REQUIRE(unpacked == messages[ci]);
+            if (unpacked_sz)
+            {
+                BOOST_REQUIRE_EQUAL(codec_frame_unpack(pctx, stream.data() + pos, stream.size() - pos,
+                                                       unpacked.data(), unpacked_sz - 1),
+                                    -1);
+            }
+            pos += frame_sz;
+        }
+        BOOST_REQUIRE_EQUAL(pos, stream.size());
+    }
+
+    // invalid header and truncated frame
+    std::vector<unsigned char> unpacked(messages[0].size());
+    BOOST_REQUIRE(!C_BOOL_RESULT(codec_frame_get_info(stream.data(), CODEC_FRAME_HEADER_SZ - 1, nullptr, nullptr,
+                                                      nullptr)));
+    BOOST_REQUIRE_EQUAL(codec_frame_unpack(&ctx_lz, stream.data(), 100, unpacked.data(), unpacked.size()), -1);
+    auto invalid = stream;
+    invalid[0] = 'X';
+    BOOST_REQUIRE_EQUAL(codec_frame_unpack(&ctx_lz, invalid.data(), invalid.size(), unpacked.data(), unpacked.size()),
+                        -1);
+    invalid = stream;
+    invalid[2] = CODEC_TYPES_N;
+    BOOST_REQUIRE_EQUAL(codec_frame_unpack(&ctx_lz, invalid.data(), invalid.size(), unpacked.data(), unpacked.size()),
+                        -1);
+    invalid = stream;
+    invalid[2] = CODEC_ZLIB;
+    BOOST_REQUIRE_EQUAL(codec_frame_unpack(&ctx_lz, invalid.data(), invalid.size(), unpacked.data(), unpacked.size()),
+                        -1);
+
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_destroy(&ctx_zlib)));
+    BOOST_REQUIRE(C_BOOL_RESULT(codec_destroy(&ctx_lz)));
+}
+
+BOOST_AUTO_TEST_CASE(codec_large_data_check)
+{
+    const auto data = make_text_data(4 * 1024 * 1024 + 17);
+
+    for (codec_type_t type : { CODEC_LZ, CODEC_ZLIB })
+    {
+        codec_ctx_t ctx;
+        BOOST_REQUIRE(C_BOOL_RESULT(codec_init(&ctx, type)));
+
+        std::vector<unsigned char> packed(codec_get_bound(&ctx, data.size()));
+        long packed_sz = codec_pack(&ctx, data.data(), data.size(), packed.data(), packed.size());
+        BOOST_REQUIRE_GT(packed_sz, 0);
+        BOOST_REQUIRE_LT(packed_sz, (long)data.size());
+
+        std::vector<unsigned char> unpacked(data.size());
+        BOOST_REQUIRE_EQUAL(codec_unpack(&ctx, packed.data(), packed_sz, unpacked.data(), unpacked.size()),
+                            (long)data.size());
+        BOOST_REQUIRE(unpacked == data);
+
+        BOOST_REQUIRE(C_BOOL_RESULT(codec_destroy(&ctx)));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace server_clib
@@ -0,0 +1,104 @@
+#include <boost/test/unit_test.hpp>
+
+#include <server_clib/hash.h>
+#include <server_clib/rnd.h>
+#include <server_clib/macro.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+namespace server_clib {
+
+static std::vector<unsigned char> make_data(const size_t sz, const uint64_t seed)
+{
+    std::vector<unsigned char> data(sz);
+    for (size_t ci = 0; ci < sz; ++ci)
+        data[ci] = (unsigned char)create_pseudo_random(seed, ci);
+    return data;
+}
+
+BOOST_AUTO_TEST_SUITE(hash_tests)
+
+BOOST_AUTO_TEST_CASE(hash_check)
+{
+    const std::string key = "blowfish key";
+    BOOST_REQUIRE_EQUAL(hash64(key.data(), key.size(), 0), hash64(key.data(), key.size(), 0));
+    BOOST_REQUIRE_NE(hash64(key.data(), key.size(), 0), hash64(key.data(), key.size(), 1));
+    BOOST_REQUIRE_NE(hash64(key.data(), key.size(), 0), hash64(key.data(), key.size() - 1, 0));
+    BOOST_REQUIRE_NE(hash64(nullptr, 0, 0), hash64(nullptr, 0, 1));
+
+    // zero bytes of different length
+    std::vector<unsigned char> zeros(256, 0);
+    std::unordered_set<uint64_t> hashes;
+    for (size_t sz = 0; sz <= zeros.size(); ++sz)
+        hashes.insert(hash64(zeros.data(), sz, 0));
+    BOOST_REQUIRE_EQUAL(hashes.size(), zeros.size() + 1);
+
+    // sequential integer keys (no 64-bit collisions are expected)
+    hashes.clear();
+    for (uint64_t ci = 0; ci < 1000000; ++ci)
+        hashes.insert(hash64(&ci, sizeof(ci), 0));
+    BOOST_REQUIRE_EQUAL(hashes.size(), 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(stream_check)
+{
+    auto data = make_data(1000, 1);
+
+    for (size_t sz = 0; sz < data.size(); sz += (sz < 200) ? 1 : 37)
+    {
+        const uint64_t expected = hash64(data.data(), sz, 42);
+        for (size_t chunk_sz : { 1, 5, 16, 47, 48, 49, 100, 1000 })
+        {
+            hash64_stream_ctx_t ctx;
+            BOOST_REQUIRE(hash64_stream_init(&ctx, 42));
+            for (size_t pos = 0; pos < sz; pos += chunk_sz)
+                BOOST_REQUIRE(hash64_stream_update(&ctx, data.data() + pos, std::min(chunk_sz, sz - pos)));
+            BOOST_REQUIRE_EQUAL(hash64_stream_final(&ctx), expected);
+        }
+    }
+
+    // final does not change context
+    hash64_stream_ctx_t ctx;
+    BOOST_REQUIRE(hash64_stream_init(&ctx, 0));
+    BOOST_REQUIRE(hash64_stream_update(&ctx, data.data(), 100));
+    BOOST_REQUIRE_EQUAL(hash64_stream_final(&ctx), hash64(data.data(), 100, 0));
+    BOOST_REQUIRE(hash64_stream_update(&ctx, data.data() + 100, 100));
+    BOOST_REQUIRE_EQUAL(hash64_stream_final(&ctx), hash64(data.data(), 200, 0));
+}
+
+// SMHasher-like avalanche test: every input bit flip changes every output bit with probability near 0.5
+BOOST_AUTO_TEST_CASE(avalanche_check)
+{
+    const size_t samples_n = 1000;
+
+    for (size_t sz : { 3, 8, 16, 24, 64, 100 })
+    {
+        std::vector<size_t> flips(sz * 8 * 64, 0);
+        for (size_t sample = 0; sample < samples_n; ++sample)
+        {
+            auto key = make_data(sz, sample * 1000 + sz);
+            const uint64_t h = hash64(key.data(), sz, 0);
+            for (size_t bit = 0; bit < sz * 8; ++bit)
+            {
+                key[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+                uint64_t diff = h ^ hash64(key.data(), sz, 0);
+                key[bit / 8] ^= (unsigned char)(1 << (bit % 8));
+
+                for (size_t out = 0; out < 64; ++out)
+                    flips[bit * 64 + out] += (diff >> out) & 1;
+            }
+        }
+
+        double worst_bias = 0;
+        for (auto n : flips)
+            worst_bias = std::max(worst_bias, std::abs((double)n / samples_n - 0.5));
+        // 6 standard deviations for samples_n
+        BOOST_REQUIRE_LT(worst_bias, 0.1);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+} // namespace server_clib
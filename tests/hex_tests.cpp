@@ -1,9 +1,27 @@
 #include <boost/test/unit_test.hpp>
 
+#include "tests_common.h"
+
 #include <server_clib/hex.h>
 #include <server_clib/macro.h>
+#include <server_clib/rubber.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
 
 namespace server_clib {
+
+// the same layout of stream context for C library and C++ code
+static_assert(sizeof(hex_stream_ctx_t::strict) == sizeof(int) && sizeof(hex_stream_ctx_t::has_carry) == sizeof(int),
+              "hex_stream_ctx_t flags must not depend on BOOL");
+static_assert(offsetof(hex_stream_ctx_t, carry) == 2 * sizeof(int), "hex_stream_ctx_t carry offset");
+static_assert(offsetof(hex_stream_ctx_t, position)
+                  == (2 * sizeof(int) + 1 + alignof(size_t) - 1) / alignof(size_t) * alignof(size_t),
+              "hex_stream_ctx_t position offset");
+static_assert(sizeof(hex_stream_ctx_t) == offsetof(hex_stream_ctx_t, position) + sizeof(size_t),
+              "hex_stream_ctx_t size");
+
 BOOST_AUTO_TEST_SUITE(hex_tests)
 
 BOOST_AUTO_TEST_CASE(positive_convertion_check)
@@ -66,5 +84,182 @@ BOOST_AUTO_TEST_CASE(sanitize_from_hex_convertion_check)
     BOOST_REQUIRE_EQUAL(hex_stream_from_hex("0c", 2, (unsigned char*)buff, 1), 2);
 }
 
+static std::string to_hex_by_chars(const std::vector<unsigned char>& data)
+{
+    const char hex_abc[] = "0123456789abcdef";
+    std::string result;
+    for (auto ch : data)
+    {
+        result.push_back(hex_abc[ch >> 4]);
+        result.push_back(hex_abc[ch & 0x0f]);
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(vectorized_convertion_check)
+{
+    for (size_t data_sz = 1; data_sz < 300; data_sz += (data_sz < 70) ? 1 : 37)
+    {
+        std::vector<unsigned char> data(data_sz);
+        for (size_t ci = 0; ci < data.size(); ++ci)
+            data[ci] = (unsigned char)(ci * 97 + data_sz);
+
+        auto expected = to_hex_by_chars(data);
+
+        std::vector<char> buff(2 * data_sz + 1, 'x');
+        BOOST_REQUIRE_EQUAL(hex_stream_to_hex(data.data(), data.size(), buff.data(), buff.size()), data_sz);
+        BOOST_REQUIRE_EQUAL(std::string(buff.data()), expected);
+
+        // upper case is decoded too
+        for (size_t ci = 0; ci < buff.size(); ci += 3)
+            buff[ci] = (char)toupper(buff[ci]);
+
+        std::vector<unsigned char> decoded(data_sz);
+        BOOST_REQUIRE_EQUAL(hex_stream_from_hex(buff.data(), 2 * data_sz, decoded.data(), decoded.size()),
+                            2 * data_sz);
+        BOOST_REQUIRE(decoded == data);
+
+        size_t error_pos = 0;
+        BOOST_REQUIRE_EQUAL(
+            hex_stream_from_hex_strict(buff.data(), 2 * data_sz, decoded.data(), decoded.size(), &error_pos),
+            2 * data_sz);
+        BOOST_REQUIRE(decoded == data);
+
+        // the first invalid char
+        for (size_t bad_pos = 0; bad_pos < 2 * data_sz; bad_pos += 5)
+        {
+            auto invalid = buff;
+            invalid[bad_pos] = 'g';
+            if (bad_pos + 7 < 2 * data_sz)
+                invalid[bad_pos + 7] = ' ';
+
+            BOOST_REQUIRE_EQUAL(hex_stream_from_hex_strict(invalid.data(), 2 * data_sz, decoded.data(),
+                                                           decoded.size(), &error_pos),
+                                -1);
+            BOOST_REQUIRE_EQUAL(error_pos, bad_pos);
+
+            // invalid chars are decoded as 0
+            BOOST_REQUIRE_EQUAL(hex_stream_from_hex(invalid.data(), 2 * data_sz, decoded.data(), decoded.size()),
+                                2 * data_sz);
+            auto expected_decoded = data;
+            for (auto pos : { bad_pos, bad_pos + 7 })
+            {
+                if (pos < 2 * data_sz)
+                    expected_decoded[pos / 2] &= (pos % 2) ? 0xf0 : 0x0f;
+            }
+            BOOST_REQUIRE(decoded == expected_decoded);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stream_convertion_check)
+{
+    const std::string data = "0123456789abcdefABCDEF00ff7e";
+
+    std::vector<unsigned char> expected(data.size() / 2);
+    BOOST_REQUIRE_EQUAL(hex_stream_from_hex(data.data(), data.size(), expected.data(), expected.size()), data.size());
+
+    for (size_t chunk_sz = 1; chunk_sz < 8; ++chunk_sz)
+    {
+        hex_stream_ctx_t ctx;
+        BOOST_REQUIRE(hex_stream_ctx_init(&ctx, true));
+
+        std::vector<unsigned char> decoded;
+        unsigned char output[8];
+        for (size_t pos = 0; pos < data.size(); pos += chunk_sz)
+        {
+            auto sz = std::min(chunk_sz, data.size() - pos);
+            BOOST_REQUIRE_LE(hex_stream_ctx_get_output_length(&ctx, sz), sizeof(output));
+            auto r = hex_stream_ctx_from_hex(&ctx, data.data() + pos, sz, output, sizeof(output), nullptr);
+            BOOST_REQUIRE_GE(r, 0);
+            decoded.insert(decoded.end(), output, output + r);
+        }
+        BOOST_REQUIRE(hex_stream_ctx_finish(&ctx));
+        BOOST_REQUIRE(decoded == expected);
+    }
+
+    // invalid char offset in stream (the first char of pair is carried)
+    hex_stream_ctx_t ctx;
+    unsigned char output[8];
+    size_t error_pos = 0;
+    BOOST_REQUIRE(hex_stream_ctx_init(&ctx, true));
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "abc", 3, output, sizeof(output), &error_pos), 1);
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "x0", 2, output, sizeof(output), &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 3);
+    BOOST_REQUIRE(hex_stream_ctx_init(&ctx, true));
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "ab", 2, output, sizeof(output), &error_pos), 1);
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "cd0z", 4, output, sizeof(output), &error_pos), -1);
+    BOOST_REQUIRE_EQUAL(error_pos, 5);
+
+    // invalid chars are decoded as 0 by default
+    BOOST_REQUIRE(hex_stream_ctx_init(&ctx, false));
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "1", 1, output, sizeof(output), &error_pos), 0);
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "x", 1, output, sizeof(output), &error_pos), 1);
+    BOOST_REQUIRE_EQUAL(output[0], 0x10);
+
+    // odd input
+    BOOST_REQUIRE_EQUAL(hex_stream_ctx_from_hex(&ctx, "1", 1, output, sizeof(output), &error_pos), 0);
+    BOOST_REQUIRE(!C_BOOL_RESULT(hex_stream_ctx_finish(&ctx)));
+}
+
+BOOST_AUTO_TEST_CASE(hex_dump_check)
+{
+    const std::string data = std::string("Hello, hexdump!\n") + "This line is longer than 16 bytes"
+                             + std::string("\x00\x01\x7f\xff", 4);
+    const std::string expected
+        = "00000000  48 65 6c 6c 6f 2c 20 68  65 78 64 75 6d 70 21 0a  |Hello, hexdump!.|\n"
+          "00000010  54 68 69 73 20 6c 69 6e  65 20 69 73 20 6c 6f 6e  |This line is lon|\n"
+          "00000020  67 65 72 20 74 68 61 6e  20 31 36 20 62 79 74 65  |ger than 16 byte|\n"
+          "00000030  73 00 01 7f ff "
+          + std::string(34, ' ') + " |s....|\n"
+          + "00000035\n";
+
+    for (bool string_mode : { false, true })
+    {
+        char buff[100];
+        rubber_ctx_t rubber;
+        BOOST_REQUIRE(rubber_init_from_buff(&rubber, buff, sizeof(buff), 20, string_mode) > 0);
+
+        auto r = hex_dump((const unsigned char*)data.data(), data.size(), 0, &rubber);
+        BOOST_REQUIRE_EQUAL(r, expected.size());
+        BOOST_REQUIRE_EQUAL(std::string(rubber_get(&rubber)), expected);
+
+        // appended to text with offset
+        r = hex_dump((const unsigned char*)"abc", 3, 0x100, &rubber);
+        BOOST_REQUIRE_EQUAL(std::string(rubber_get(&rubber)),
+                            expected + "00000100  61 62 63 " + std::string(40, ' ') + " |abc|\n00000103\n");
+
+        BOOST_REQUIRE(rubber_destroy(&rubber) > 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hex_dump_reference_check)
+{
+    std::vector<unsigned char> data(64 * 1024);
+    for (size_t ci = 0; ci < data.size(); ++ci)
+        data[ci] = (unsigned char)(ci * 31);
+
+    rubber_ctx_t rubber;
+    BOOST_REQUIRE(rubber_init(&rubber, 64 * 1024, false) > 0);
+    BOOST_REQUIRE_GT(hex_dump(data.data(), data.size(), 0, &rubber), 0);
+
+    // snprintf based formatting
+    std::vector<char> buff(5 * data.size());
+    size_t pos = 0;
+    for (size_t ci = 0; ci < data.size(); ci += 16)
+    {
+        pos += snprintf(&buff[pos], buff.size() - pos, "%08zx  ", ci);
+        for (size_t cj = 0; cj < 16; ++cj)
+            pos += snprintf(&buff[pos], buff.size() - pos, (cj == 7) ? "%02x  " : "%02x ", data[ci + cj]);
+        pos += snprintf(&buff[pos], buff.size() - pos, " |");
+        for (size_t cj = 0; cj < 16; ++cj)
+            pos += snprintf(&buff[pos], buff.size() - pos, "%c", isprint(data[ci + cj]) ? data[ci + cj] : '.');
+        pos += snprintf(&buff[pos], buff.size() - pos, "|\n");
+    }
+    BOOST_REQUIRE(!memcmp(buff.data(), rubber_get(&rubber), pos));
+
+    BOOST_REQUIRE(rubber_destroy(&rubber) > 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace server_clib
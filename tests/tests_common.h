@@ -0,0 +1,4 @@
+#pragma once
+
+// BOOL is bool for C library and int for C++ code, only the low byte of result is defined
+#define C_BOOL_RESULT(result) ((result)&0xFF)
@@ -1,12 +1,21 @@
 #include <boost/test/unit_test.hpp>
 
+#include "tests_common.h"
+
 #include <server_clib/zip.h>
 #include <server_clib/zip_stream.h>
+#include <server_clib/zip_parallel.h>
+#include <server_clib/rubber.h>
 #include <server_clib/macro.h>
 
+#include <zlib.h>
+
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <vector>
+#include <thread>
+#include <functional>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -518,5 +527,607 @@ BOOST_FIXTURE_TEST_CASE(create_gzip_file_check, zip_files_tests)
     BOOST_CHECK_EQUAL(std::string { INPUT_ZIP_DATA }, std::string { (char*)&unpacked_data[0] });
 }
 
+static std::vector<unsigned char> stream_pack(zip_stream_ctx_t* pctx, const unsigned char* p_input, const size_t input_sz)
+{
+    std::vector<unsigned char> packed(input_sz + 100);
+    long processed = zip_stream_start_pack_chunk(pctx, p_input, input_sz, packed.data(), packed.size());
+    BOOST_REQUIRE(processed >= 0);
+    long finished = zip_stream_finish_pack(pctx, packed.data() + processed, packed.size() - processed);
+    BOOST_REQUIRE(finished > 0);
+    packed.resize(processed + finished);
+    return packed;
+}
+
+BOOST_AUTO_TEST_CASE(data_stream_allocator_check)
+{
+    struct counter_t
+    {
+        size_t allocated_n = 0;
+        size_t freed_n = 0;
+    } counter;
+
+    zip_allocator_t allocator;
+    allocator.alloc_f = [](void* opaque, unsigned int items_n, unsigned int item_sz) -> void* {
+        ++((counter_t*)opaque)->allocated_n;
+        return calloc(items_n, item_sz);
+    };
+    allocator.free_f = [](void* opaque, void* p) {
+        ++((counter_t*)opaque)->freed_n;
+        free(p);
+    };
+    allocator.opaque = &counter;
+
+    zip_stream_ctx_t ctx;
+    BOOST_REQUIRE(zip_stream_pack_init_with_allocator(&ctx, &allocator));
+    BOOST_REQUIRE_GT(counter.allocated_n, 0);
+    auto packed = stream_pack(&ctx, (const unsigned char*)INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA));
+    BOOST_REQUIRE(zip_stream_pack_destroy(&ctx));
+    BOOST_REQUIRE_EQUAL(counter.allocated_n, counter.freed_n);
+
+    BOOST_REQUIRE(zip_stream_unpack_init_with_allocator(&ctx, &allocator));
+    std::vector<unsigned char> unpacked(sizeof(INPUT_ZIP_DATA));
+    BOOST_REQUIRE_EQUAL(zip_stream_start_unpack_chuck(&ctx, packed.data(), packed.size(), unpacked.data(), unpacked.size()),
+                        sizeof(INPUT_ZIP_DATA));
+    BOOST_REQUIRE(zip_stream_unpack_destroy(&ctx));
+    BOOST_REQUIRE_EQUAL(counter.allocated_n, counter.freed_n);
+    BOOST_REQUIRE_EQUAL(std::string((const char*)unpacked.data()), std::string(INPUT_ZIP_DATA));
+
+    // allocation failure
+    allocator.alloc_f = [](void*, unsigned int, unsigned int) -> void* { return nullptr; };
+    BOOST_REQUIRE(!C_BOOL_RESULT(zip_stream_pack_init_with_allocator(&ctx, &allocator)));
+    allocator.alloc_f = nullptr;
+    BOOST_REQUIRE(!C_BOOL_RESULT(zip_stream_unpack_init_with_allocator(&ctx, &allocator)));
+}
+
+BOOST_AUTO_TEST_CASE(data_stream_fixed_memory_check)
+{
+    std::vector<unsigned char> pack_mem(ZIP_STREAM_PACK_MEMORY_SZ);
+    std::vector<unsigned char> unpack_mem(ZIP_STREAM_UNPACK_MEMORY_SZ);
+
+    zip_fixed_memory_t pack_memory, unpack_memory;
+    zip_allocator_t pack_allocator, unpack_allocator;
+    BOOST_REQUIRE(zip_fixed_memory_init(&pack_memory, pack_mem.data() + 1, pack_mem.size() - 1));
+    BOOST_REQUIRE(zip_fixed_memory_get_allocator(&pack_memory, &pack_allocator));
+    BOOST_REQUIRE(zip_fixed_memory_init(&unpack_memory, unpack_mem.data(), unpack_mem.size()));
+    BOOST_REQUIRE(zip_fixed_memory_get_allocator(&unpack_memory, &unpack_allocator));
+
+    // memory is reused for next streams
+    for (int ci = 0; ci < 3; ++ci)
+    {
+        zip_stream_ctx_t ctx;
+        BOOST_REQUIRE(zip_stream_pack_init_with_allocator(&ctx, &pack_allocator));
+        auto packed = stream_pack(&ctx, (const unsigned char*)INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA));
+        PRINT_ZIP("gzip fixed memory " + std::to_string(pack_memory.used_sz), sizeof(INPUT_ZIP_DATA), packed.size())
+        BOOST_REQUIRE(zip_stream_pack_destroy(&ctx));
+        BOOST_REQUIRE_EQUAL(pack_memory.used_sz, 0);
+
+        BOOST_REQUIRE(zip_stream_unpack_init_with_allocator(&ctx, &unpack_allocator));
+        std::vector<unsigned char> unpacked(sizeof(INPUT_ZIP_DATA));
+        BOOST_REQUIRE_EQUAL(
+            zip_stream_start_unpack_chuck(&ctx, packed.data(), packed.size(), unpacked.data(), unpacked.size()),
+            sizeof(INPUT_ZIP_DATA));
+        BOOST_REQUIRE_GT(unpack_memory.used_sz, 0);
+        BOOST_REQUIRE(zip_stream_unpack_destroy(&ctx));
+        BOOST_REQUIRE_EQUAL(unpack_memory.used_sz, 0);
+        BOOST_REQUIRE_EQUAL(std::string((const char*)unpacked.data()), std::string(INPUT_ZIP_DATA));
+    }
+
+    // not enough memory
+    zip_fixed_memory_t small_memory;
+    zip_allocator_t small_allocator;
+    BOOST_REQUIRE(zip_fixed_memory_init(&small_memory, pack_mem.data(), 64 * 1024));
+    BOOST_REQUIRE(zip_fixed_memory_get_allocator(&small_memory, &small_allocator));
+    zip_stream_ctx_t ctx;
+    BOOST_REQUIRE(!C_BOOL_RESULT(zip_stream_pack_init_with_allocator(&ctx, &small_allocator)));
+    BOOST_REQUIRE_EQUAL(small_memory.used_sz, 0);
+}
+
+BOOST_AUTO_TEST_CASE(zip_ctx_check)
+{
+    zip_ctx_t ctx;
+    BOOST_REQUIRE(zip_ctx_init(&ctx));
+
+    std::string message;
+    for (int ci = 0; ci < 20; ++ci)
+    {
+        message.append(INPUT_ZIP_DATA, 1 + (size_t)ci * 37 % sizeof(INPUT_ZIP_DATA));
+
+        // the same output as for new zlib state each time
+        std::vector<unsigned char> expected(message.size() + 100);
+        size_t expected_sz = expected.size();
+        unsigned char* p_expected = expected.data();
+        auto zip_f = (ci % 3) ? zip_pack_best_speed : zip_pack_best_size;
+        auto zip_ctx_f = (ci % 3) ? zip_ctx_pack_best_speed : zip_ctx_pack_best_size;
+        BOOST_REQUIRE(zip_f((const unsigned char*)message.data(), message.size(), &p_expected, &expected_sz, false));
+
+        unsigned char* pzip_data = nullptr;
+        size_t zip_sz = 0;
+        BOOST_REQUIRE(
+            zip_ctx_f(&ctx, (const unsigned char*)message.data(), message.size(), &pzip_data, &zip_sz, true));
+        BOOST_REQUIRE_EQUAL(zip_sz, expected_sz);
+        BOOST_REQUIRE(!memcmp(pzip_data, expected.data(), zip_sz));
+
+        unsigned char* punzip_data = nullptr;
+        size_t unzip_sz = message.size();
+        BOOST_REQUIRE(zip_ctx_unpack(&ctx, pzip_data, zip_sz, &punzip_data, &unzip_sz, true));
+        BOOST_REQUIRE_EQUAL(std::string((const char*)punzip_data, unzip_sz), message);
+        free(punzip_data);
+
+        // too small buffer does not break context
+        std::vector<unsigned char> small(message.size() / 2);
+        unsigned char* psmall = small.data();
+        size_t small_sz = small.size();
+        BOOST_REQUIRE(!C_BOOL_RESULT(zip_ctx_unpack(&ctx, pzip_data, zip_sz, &psmall, &small_sz, false)));
+        BOOST_REQUIRE(!C_BOOL_RESULT(zip_ctx_unpack(&ctx, pzip_data, zip_sz / 2, &psmall, &small_sz, false)));
+
+        free(pzip_data);
+    }
+
+    BOOST_REQUIRE(zip_ctx_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(zip_tls_check)
+{
+    auto job = [](const size_t shift, BOOL* presult) {
+        *presult = false;
+        for (size_t ci = 0; ci < 100; ++ci)
+        {
+            auto sz = 1 + (ci * 37 + shift) % sizeof(INPUT_ZIP_DATA);
+            unsigned char* pzip_data = nullptr;
+            size_t zip_sz = 0;
+            if (!zip_pack_best_speed_tls((const unsigned char*)INPUT_ZIP_DATA, sz, &pzip_data, &zip_sz, true))
+                return;
+            std::vector<unsigned char> unzip_data(sz);
+            unsigned char* punzip_data = unzip_data.data();
+            size_t unzip_sz = unzip_data.size();
+            BOOL result = zip_unpack_tls(pzip_data, zip_sz, &punzip_data, &unzip_sz, false);
+            free(pzip_data);
+            if (!result || unzip_sz != sz || memcmp(unzip_data.data(), INPUT_ZIP_DATA, sz))
+                return;
+        }
+        zip_tls_release();
+        *presult = true;
+    };
+
+    BOOL results[4];
+    std::vector<std::thread> threads;
+    for (size_t ci = 0; ci < 4; ++ci)
+        threads.emplace_back(job, ci, &results[ci]);
+    for (auto& thread : threads)
+        thread.join();
+    for (auto result : results)
+        BOOST_REQUIRE(result);
+}
+
+BOOST_AUTO_TEST_CASE(zip_rubber_check)
+{
+    // highly compressible data to check growth from small buffer
+    std::string data;
+    while (data.size() < 4 * 1024 * 1024)
+        data.append(INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA) - 1);
+
+    zip_ctx_t ctx;
+    BOOST_REQUIRE(zip_ctx_init(&ctx));
+
+    for (int ci = 0; ci < 2; ++ci)
+    {
+        zip_ctx_t* pctx = (ci) ? &ctx : nullptr;
+
+        // two packed messages one after another
+        char buff[64];
+        rubber_ctx_t packed;
+        BOOST_REQUIRE(rubber_init_from_buff(&packed, buff, sizeof(buff), 16, false) > 0);
+        long first_sz = (pctx) ? zip_ctx_pack_best_speed_to_rubber(pctx, (const unsigned char*)data.data(),
+                                                                     data.size(), &packed)
+                               : zip_pack_best_speed_to_rubber((const unsigned char*)data.data(), data.size(), &packed);
+        BOOST_REQUIRE_GT(first_sz, 0);
+        long second_sz
+            = (pctx) ? zip_ctx_pack_best_size_to_rubber(pctx, (const unsigned char*)INPUT_ZIP_DATA,
+                                                        sizeof(INPUT_ZIP_DATA), &packed)
+                     : zip_pack_best_size_to_rubber((const unsigned char*)INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA), &packed);
+        BOOST_REQUIRE_GT(second_sz, 0);
+        BOOST_REQUIRE_EQUAL(packed.written, (size_t)(first_sz + second_sz));
+        PRINT_ZIP("zip to rubber", data.size(), first_sz)
+
+        const unsigned char* p_packed = (const unsigned char*)rubber_get(&packed);
+
+        rubber_ctx_t unpacked;
+        BOOST_REQUIRE(rubber_init(&unpacked, 1024, false) > 0);
+        long unpacked_sz = (pctx) ? zip_ctx_unpack_to_rubber(pctx, p_packed, first_sz, &unpacked)
+                                  : zip_unpack_to_rubber(p_packed, first_sz, &unpacked);
+        BOOST_REQUIRE_EQUAL(unpacked_sz, data.size());
+        unpacked_sz = (pctx) ? zip_ctx_unpack_to_rubber(pctx, p_packed + first_sz, second_sz, &unpacked)
+                             : zip_unpack_to_rubber(p_packed + first_sz, second_sz, &unpacked);
+        BOOST_REQUIRE_EQUAL(unpacked_sz, sizeof(INPUT_ZIP_DATA));
+        BOOST_REQUIRE_EQUAL(unpacked.written, data.size() + sizeof(INPUT_ZIP_DATA));
+        BOOST_REQUIRE(!memcmp(rubber_get(&unpacked), data.data(), data.size()));
+        BOOST_REQUIRE_EQUAL(std::string(rubber_get(&unpacked) + data.size()), std::string(INPUT_ZIP_DATA));
+
+        // truncated and invalid data
+        BOOST_REQUIRE_EQUAL(zip_unpack_to_rubber(p_packed, first_sz / 2, &unpacked), -1);
+        BOOST_REQUIRE_EQUAL(zip_unpack_to_rubber((const unsigned char*)INPUT_ZIP_DATA, 100, &unpacked), -1);
+
+        BOOST_REQUIRE(rubber_destroy(&unpacked) > 0);
+        BOOST_REQUIRE(rubber_destroy(&packed) > 0);
+    }
+
+    // text mode is not supported
+    rubber_ctx_t text;
+    BOOST_REQUIRE(rubber_init(&text, 1024, true) > 0);
+    BOOST_REQUIRE_EQUAL(zip_pack_best_speed_to_rubber((const unsigned char*)INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA), &text),
+                        -1);
+    BOOST_REQUIRE(rubber_destroy(&text) > 0);
+
+    BOOST_REQUIRE(zip_ctx_destroy(&ctx));
+}
+
+// whole gzip stream by zlib (single member)
+static std::string gunzip(const unsigned char* p_input, const size_t input_sz, const size_t output_sz)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    BOOST_REQUIRE_EQUAL(inflateInit2(&strm, 15 + 16), Z_OK);
+    std::string output(output_sz + 1, '\0');
+    strm.next_in = (Bytef*)p_input;
+    strm.avail_in = (uInt)input_sz;
+    strm.next_out = (Bytef*)&output[0];
+    strm.avail_out = (uInt)output.size();
+    BOOST_REQUIRE_EQUAL(inflate(&strm, Z_FINISH), Z_STREAM_END);
+    BOOST_REQUIRE_EQUAL(strm.avail_in, 0);
+    output.resize(strm.total_out);
+    inflateEnd(&strm);
+    return output;
+}
+
+static std::string make_zip_data(const size_t sz)
+{
+    std::string data;
+    data.reserve(sz);
+    for (size_t ci = 0; data.size() < sz; ++ci)
+    {
+        data.append(INPUT_ZIP_DATA + ci % 100, 50 + ci % 200);
+        data.append(std::to_string(ci * 2654435761u));
+    }
+    data.resize(sz);
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(zip_parallel_pack_check)
+{
+    const std::string data = make_zip_data(3 * 1024 * 1024 + 123);
+
+    for (int level : { 1, 6, 9 })
+    {
+        for (size_t block_sz : { (size_t)0, (size_t)1000, (size_t)100000 })
+        {
+            for (size_t threads_n : { 1, 3 })
+            {
+                rubber_ctx_t packed;
+                BOOST_REQUIRE(rubber_init(&packed, 4096, false) > 0);
+                long packed_sz = zip_parallel_pack_to_rubber((const unsigned char*)data.data(), data.size(), level,
+                                                             block_sz, threads_n, &packed);
+                BOOST_REQUIRE_GT(packed_sz, 0);
+                BOOST_REQUIRE_EQUAL(packed.written, (size_t)packed_sz);
+                BOOST_REQUIRE(gunzip((const unsigned char*)rubber_get(&packed), packed_sz, data.size()) == data);
+                if (!block_sz && threads_n == 1)
+                    PRINT_ZIP("parallel gzip level " + std::to_string(level), data.size(), packed_sz)
+                BOOST_REQUIRE(rubber_destroy(&packed) > 0);
+            }
+        }
+    }
+
+    // empty input
+    rubber_ctx_t packed;
+    BOOST_REQUIRE(rubber_init(&packed, 4096, false) > 0);
+    long packed_sz = zip_parallel_pack_to_rubber(nullptr, 0, 6, 0, 0, &packed);
+    BOOST_REQUIRE_GT(packed_sz, 0);
+    BOOST_REQUIRE(gunzip((const unsigned char*)rubber_get(&packed), packed_sz, 0).empty());
+    BOOST_REQUIRE_EQUAL(zip_parallel_pack_to_rubber((const unsigned char*)data.data(), data.size(), 10, 0, 0, &packed),
+                        -1);
+    BOOST_REQUIRE(rubber_destroy(&packed) > 0);
+}
+
+static void append_to_rubber(rubber_ctx_t* prubber, const std::vector<unsigned char>& data)
+{
+    if (rubber_get_rest(prubber) <= data.size())
+        BOOST_REQUIRE(rubber_enlarge(prubber, data.size() + 1) > 0);
+    memcpy(rubber_get_pos(prubber), data.data(), data.size());
+    int written = (int)data.size();
+    BOOST_REQUIRE(rubber_pos(prubber, &written));
+}
+
+BOOST_AUTO_TEST_CASE(zip_parallel_unpack_check)
+{
+    const std::string data = make_zip_data(2 * 1024 * 1024 + 77);
+
+    // members of different size by parallel and stream packing
+    rubber_ctx_t packed;
+    BOOST_REQUIRE(rubber_init(&packed, 4096, false) > 0);
+    size_t members_n = 0;
+    for (size_t pos = 0; pos < data.size(); ++members_n)
+    {
+        const size_t sz = std::min(data.size() - pos, (size_t)(1 + members_n * 7919 % 300000));
+        if (members_n % 2)
+        {
+            BOOST_REQUIRE_GT(zip_parallel_pack_to_rubber((const unsigned char*)data.data() + pos, sz,
+                                                         1 + members_n % 9, 0, 1, &packed),
+                             0);
+        }
+        else
+        {
+            zip_stream_ctx_t ctx;
+            BOOST_REQUIRE(zip_stream_pack_init(&ctx));
+            append_to_rubber(&packed, stream_pack(&ctx, (const unsigned char*)data.data() + pos, sz));
+            BOOST_REQUIRE(zip_stream_pack_destroy(&ctx));
+        }
+        pos += sz;
+    }
+    BOOST_REQUIRE_GT(members_n, 10);
+    const unsigned char* p_packed = (const unsigned char*)rubber_get(&packed);
+
+    for (size_t threads_n : { 1, 4 })
+    {
+        rubber_ctx_t unpacked;
+        BOOST_REQUIRE(rubber_init(&unpacked, 1024, false) > 0);
+        BOOST_REQUIRE_EQUAL(zip_parallel_unpack_to_rubber(p_packed, packed.written, threads_n, &unpacked), data.size());
+        BOOST_REQUIRE_EQUAL(unpacked.written, data.size());
+        BOOST_REQUIRE(!memcmp(rubber_get(&unpacked), data.data(), data.size()));
+
+        // truncated, corrupted and with garbage at the end
+        BOOST_REQUIRE_EQUAL(zip_parallel_unpack_to_rubber(p_packed, packed.written - 1, threads_n, &unpacked), -1);
+        std::vector<unsigned char> corrupted(p_packed, p_packed + packed.written);
+        corrupted[corrupted.size() / 2] ^= 0x55;
+        BOOST_REQUIRE_EQUAL(zip_parallel_unpack_to_rubber(corrupted.data(), corrupted.size(), threads_n, &unpacked), -1);
+        corrupted.assign(p_packed, p_packed + packed.written);
+        corrupted.push_back(0);
+        BOOST_REQUIRE_EQUAL(zip_parallel_unpack_to_rubber(corrupted.data(), corrupted.size(), threads_n, &unpacked), -1);
+
+        BOOST_REQUIRE(rubber_destroy(&unpacked) > 0);
+    }
+
+    // member signature inside of stored data
+    std::vector<unsigned char> tricky(p_packed, p_packed + packed.written);
+    const unsigned char signature[] = { 0x1f, 0x8b, 0x08, 0x00, 0x1f, 0x8b, 0x08 };
+    rubber_ctx_t stored;
+    BOOST_REQUIRE(rubber_init(&stored, 4096, false) > 0);
+    BOOST_REQUIRE_GT(zip_parallel_pack_to_rubber(signature, sizeof(signature), 0, 0, 1, &stored), 0);
+    BOOST_REQUIRE_GT(zip_parallel_pack_to_rubber(tricky.data(), tricky.size(), 0, 0, 1, &stored), 0);
+    rubber_ctx_t unpacked;
+    BOOST_REQUIRE(rubber_init(&unpacked, 1024, false) > 0);
+    BOOST_REQUIRE_EQUAL(zip_parallel_unpack_to_rubber((const unsigned char*)rubber_get(&stored), stored.written, 0,
+                                                      &unpacked),
+                        sizeof(signature) + tricky.size());
+    BOOST_REQUIRE(!memcmp(rubber_get(&unpacked), signature, sizeof(signature)));
+    BOOST_REQUIRE(!memcmp(rubber_get(&unpacked) + sizeof(signature), tricky.data(), tricky.size()));
+    BOOST_REQUIRE(rubber_destroy(&unpacked) > 0);
+    BOOST_REQUIRE(rubber_destroy(&stored) > 0);
+
+    BOOST_REQUIRE(rubber_destroy(&packed) > 0);
+}
+
+// repetitive JSON messages of 200-2000 bytes
+static std::string make_json_message(const size_t i)
+{
+    static const char* names[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel" };
+    std::string message = "{\"id\":" + std::to_string(i * 7919 % 100000) + ",\"type\":\"session_update\",\"items\":[";
+    const size_t items_n = 2 + i * 31 % 25;
+    for (size_t ci = 0; ci < items_n; ++ci)
+    {
+        if (ci)
+            message += ",";
+        message += "{\"name\":\"" + std::string(names[(i + ci) % 8]) + "\",\"enabled\":"
+                   + ((i + ci) % 3 ? "true" : "false") + ",\"timestamp\":" + std::to_string(1600000000 + i * 13 + ci)
+                   + ",\"status\":\"active\"}";
+    }
+    message += "],\"version\":\"1.2." + std::to_string(i % 10) + "\"}";
+    return message;
+}
+
+BOOST_AUTO_TEST_CASE(zip_dictionary_check)
+{
+    std::vector<std::string> samples;
+    std::vector<const unsigned char*> samples_p;
+    std::vector<size_t> samples_sz;
+    for (size_t ci = 0; ci < 2000; ++ci)
+        samples.push_back(make_json_message(ci));
+    for (auto& sample : samples)
+    {
+        samples_p.push_back((const unsigned char*)sample.data());
+        samples_sz.push_back(sample.size());
+    }
+
+    std::vector<unsigned char> dict(ZIP_DICTIONARY_MAX_SZ);
+    size_t dict_sz = zip_build_dictionary(samples_p.data(), samples_sz.data(), samples.size(), dict.data(), dict.size());
+    BOOST_REQUIRE_GT(dict_sz, 0);
+    BOOST_REQUIRE_LE(dict_sz, dict.size());
+
+    // other messages
+    size_t input_total = 0, zip_total = 0, zip_dict_total = 0;
+    zip_ctx_t ctx;
+    BOOST_REQUIRE(zip_ctx_init(&ctx));
+    BOOST_REQUIRE(zip_ctx_set_dictionary(&ctx, dict.data(), dict_sz));
+    for (size_t ci = 100000; ci < 100500; ++ci)
+    {
+        const std::string message = make_json_message(ci);
+        input_total += message.size();
+
+        std::vector<unsigned char> zip_data(message.size() + 100);
+        unsigned char* p_zip = zip_data.data();
+        size_t zip_sz = zip_data.size();
+        BOOST_REQUIRE(zip_pack_best_speed((const unsigned char*)message.data(), message.size(), &p_zip, &zip_sz, false));
+        zip_total += zip_sz;
+
+        zip_sz = zip_data.size();
+        BOOST_REQUIRE(zip_pack_best_speed_with_dictionary((const unsigned char*)message.data(), message.size(), &p_zip,
+                                                          &zip_sz, false, dict.data(), dict_sz));
+        zip_dict_total += zip_sz;
+
+        // the same output for context
+        std::vector<unsigned char> ctx_data(message.size() + 100);
+        unsigned char* p_ctx = ctx_data.data();
+        size_t ctx_sz = ctx_data.size();
+        BOOST_REQUIRE(zip_ctx_pack_best_speed(&ctx, (const unsigned char*)message.data(), message.size(), &p_ctx,
+                                              &ctx_sz, false));
+        BOOST_REQUIRE_EQUAL(ctx_sz, zip_sz);
+        BOOST_REQUIRE(!memcmp(ctx_data.data(), zip_data.data(), zip_sz));
+
+        std::vector<unsigned char> unzip_data(message.size());
+        unsigned char* p_unzip = unzip_data.data();
+        size_t unzip_sz = unzip_data.size();
+        BOOST_REQUIRE(zip_unpack_with_dictionary(p_zip, zip_sz, &p_unzip, &unzip_sz, false, dict.data(), dict_sz));
+        BOOST_REQUIRE_EQUAL(std::string((const char*)p_unzip, unzip_sz), message);
+        unzip_sz = unzip_data.size();
+        BOOST_REQUIRE(zip_ctx_unpack(&ctx, p_zip, zip_sz, &p_unzip, &unzip_sz, false));
+        BOOST_REQUIRE_EQUAL(std::string((const char*)p_unzip, unzip_sz), message);
+
+        // dictionary is required
+        unzip_sz = unzip_data.size();
+        BOOST_REQUIRE(!C_BOOL_RESULT(zip_unpack(p_zip, zip_sz, &p_unzip, &unzip_sz, false)));
+        unzip_sz = unzip_data.size();
+        BOOST_REQUIRE(!C_BOOL_RESULT(
+            zip_unpack_with_dictionary(p_zip, zip_sz, &p_unzip, &unzip_sz, false, dict.data(), dict_sz - 1)));
+    }
+    BOOST_REQUIRE(zip_ctx_destroy(&ctx));
+
+    PRINT_ZIP("zip", input_total, zip_total)
+    PRINT_ZIP("zip with dictionary", input_total, zip_dict_total)
+    BOOST_REQUIRE_LT(zip_dict_total * 10, zip_total * 7);
+}
+
+BOOST_AUTO_TEST_CASE(zip_short_samples_dictionary_check)
+{
+    // messages of 200-255 bytes (shorter than dictionary segment)
+    std::vector<std::string> samples;
+    std::vector<const unsigned char*> samples_p;
+    std::vector<size_t> samples_sz;
+    for (size_t ci = 0; ci < 2000; ++ci)
+        samples.push_back(make_json_message(ci).substr(0, 200 + ci % 56));
+    for (auto& sample : samples)
+    {
+        samples_p.push_back((const unsigned char*)sample.data());
+        samples_sz.push_back(sample.size());
+    }
+
+    std::vector<unsigned char> dict(ZIP_DICTIONARY_MAX_SZ);
+    size_t dict_sz = zip_build_dictionary(samples_p.data(), samples_sz.data(), samples.size(), dict.data(), dict.size());
+    BOOST_REQUIRE_GT(dict_sz, 0);
+    BOOST_REQUIRE_LE(dict_sz, dict.size());
+
+    size_t zip_total = 0, zip_dict_total = 0;
+    for (size_t ci = 100000; ci < 100100; ++ci)
+    {
+        const std::string message = make_json_message(ci).substr(0, 200 + ci % 56);
+
+        std::vector<unsigned char> zip_data(message.size() + 100);
+        unsigned char* p_zip = zip_data.data();
+        size_t zip_sz = zip_data.size();
+        BOOST_REQUIRE(zip_pack_best_speed((const unsigned char*)message.data(), message.size(), &p_zip, &zip_sz, false));
+        zip_total += zip_sz;
+
+        zip_sz = zip_data.size();
+        BOOST_REQUIRE(zip_pack_best_speed_with_dictionary((const unsigned char*)message.data(), message.size(), &p_zip,
+                                                          &zip_sz, false, dict.data(), dict_sz));
+        zip_dict_total += zip_sz;
+
+        std::vector<unsigned char> unzip_data(message.size());
+        unsigned char* p_unzip = unzip_data.data();
+        size_t unzip_sz = unzip_data.size();
+        BOOST_REQUIRE(zip_unpack_with_dictionary(p_zip, zip_sz, &p_unzip, &unzip_sz, false, dict.data(), dict_sz));
+        BOOST_REQUIRE_EQUAL(std::string((const char*)p_unzip, unzip_sz), message);
+    }
+    BOOST_REQUIRE_LT(zip_dict_total * 2, zip_total);
+
+    // shorter than k-mer
+    const unsigned char tiny[] = "{}";
+    const unsigned char* p_tiny = tiny;
+    size_t tiny_sz = sizeof(tiny);
+    BOOST_REQUIRE_EQUAL(zip_build_dictionary(&p_tiny, &tiny_sz, 1, dict.data(), dict.size()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(data_stream_dictionary_check)
+{
+    std::vector<unsigned char> dict((const unsigned char*)INPUT_ZIP_DATA,
+                                    (const unsigned char*)INPUT_ZIP_DATA + sizeof(INPUT_ZIP_DATA));
+    const std::string message = std::string(INPUT_ZIP_DATA + 100, 500);
+
+    zip_stream_ctx_t ctx;
+    BOOST_REQUIRE(zip_stream_pack_init_with_dictionary(&ctx, dict.data(), dict.size(), nullptr));
+    auto packed = stream_pack(&ctx, (const unsigned char*)message.data(), message.size());
+    BOOST_REQUIRE(zip_stream_pack_destroy(&ctx));
+    PRINT_ZIP("zlib stream with dictionary", message.size(), packed.size())
+    BOOST_REQUIRE_LT(packed.size(), 30);
+
+    // chunked unpacking
+    BOOST_REQUIRE(zip_stream_unpack_init_with_dictionary(&ctx, dict.data(), dict.size(), nullptr));
+    std::vector<unsigned char> chunk(64);
+    std::string unpacked;
+    long processed = zip_stream_start_unpack_chuck(&ctx, packed.data(), packed.size(), chunk.data(), chunk.size());
+    BOOST_REQUIRE(processed > 0);
+    unpacked.append((const char*)chunk.data(), processed);
+    while (processed == (long)chunk.size())
+    {
+        processed = zip_stream_unpack_chuck(&ctx, chunk.data(), chunk.size());
+        BOOST_REQUIRE(processed >= 0);
+        unpacked.append((const char*)chunk.data(), processed);
+    }
+    BOOST_REQUIRE(zip_stream_unpack_destroy(&ctx));
+    BOOST_REQUIRE_EQUAL(unpacked, message);
+
+    // wrong dictionary
+    dict[dict.size() - 10] ^= 1;
+    BOOST_REQUIRE(zip_stream_unpack_init_with_dictionary(&ctx, dict.data(), dict.size(), nullptr));
+    BOOST_REQUIRE_EQUAL(zip_stream_start_unpack_chuck(&ctx, packed.data(), packed.size(), chunk.data(), chunk.size()),
+                        -1);
+    BOOST_REQUIRE(zip_stream_unpack_destroy(&ctx));
+}
+
+BOOST_AUTO_TEST_CASE(zip_ctx_messages_check)
+{
+    // many small messages (1-16 KB)
+    std::string data;
+    while (data.size() < 16 * 1024)
+        data.append(INPUT_ZIP_DATA, sizeof(INPUT_ZIP_DATA) - 1);
+    const size_t messages_n = 200;
+
+    std::vector<unsigned char> zip_buff(compressBound(data.size()));
+    std::vector<unsigned char> unzip_buff(data.size());
+
+    auto run = [&](const std::function<BOOL(const unsigned char*, size_t, unsigned char**, size_t*)>& pack_f,
+                   const std::function<BOOL(const unsigned char*, size_t, unsigned char**, size_t*)>& unpack_f) {
+        size_t failed_n = 0;
+        for (size_t ci = 0; ci < messages_n; ++ci)
+        {
+            const size_t sz = 1024 + (ci * 7919) % (15 * 1024);
+            unsigned char* pzip = zip_buff.data();
+            size_t zip_sz = zip_buff.size();
+            unsigned char* punzip = unzip_buff.data();
+            size_t unzip_sz = unzip_buff.size();
+            if (!pack_f((const unsigned char*)data.data(), sz, &pzip, &zip_sz)
+                || !unpack_f(pzip, zip_sz, &punzip, &unzip_sz) || unzip_sz != sz || memcmp(punzip, data.data(), sz))
+                ++failed_n;
+        }
+        BOOST_REQUIRE_EQUAL(failed_n, 0);
+    };
+
+    run(
+        [](const unsigned char* p, size_t sz, unsigned char** pp, size_t* psz) {
+            return zip_pack_best_speed(p, sz, pp, psz, false);
+        },
+        [](const unsigned char* p, size_t sz, unsigned char** pp, size_t* psz) {
+            return zip_unpack(p, sz, pp, psz, false);
+        });
+
+    zip_ctx_t ctx;
+    BOOST_REQUIRE(zip_ctx_init(&ctx));
+    run(
+        [&ctx](const unsigned char* p, size_t sz, unsigned char** pp, size_t* psz) {
+            return zip_ctx_pack_best_speed(&ctx, p, sz, pp, psz, false);
+        },
+        [&ctx](const unsigned char* p, size_t sz, unsigned char** pp, size_t* psz) {
+            return zip_ctx_unpack(&ctx, p, sz, pp, psz, false);
+        });
+    BOOST_REQUIRE(zip_ctx_destroy(&ctx));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace server_clib